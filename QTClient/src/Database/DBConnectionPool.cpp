@@ -0,0 +1,164 @@
+//
+// Created by deanprangenberg on 14.07.25.
+//
+
+#include "DBConnectionPool.h"
+
+#include <algorithm>
+
+DBConnectionPool::Lease::~Lease() {
+  release();
+}
+
+DBConnectionPool::Lease::Lease(Lease &&other) noexcept
+  : pool(other.pool), connection(other.connection) {
+  other.pool = nullptr;
+  other.connection = nullptr;
+}
+
+DBConnectionPool::Lease &DBConnectionPool::Lease::operator=(Lease &&other) noexcept {
+  if (this != &other) {
+    release();
+    pool = other.pool;
+    connection = other.connection;
+    other.pool = nullptr;
+    other.connection = nullptr;
+  }
+  return *this;
+}
+
+sqlite3 *DBConnectionPool::Lease::get() const {
+  return connection ? connection->handle : nullptr;
+}
+
+StatementCache::Statement DBConnectionPool::Lease::prepare(const std::string &sql) const {
+  if (!connection) return {};
+  return connection->statements->get(sql);
+}
+
+void DBConnectionPool::Lease::release() {
+  if (pool && connection) {
+    pool->giveBack(connection);
+  }
+  pool = nullptr;
+  connection = nullptr;
+}
+
+DBConnectionPool::DBConnectionPool(OpenFunction openFunction, CloseFunction closeFunction, size_t maxConnections,
+                                   size_t statementCacheSize)
+  : openFunction(std::move(openFunction)), closeFunction(std::move(closeFunction)),
+    maxConnections(std::max<size_t>(1, maxConnections)), statementCacheSize(statementCacheSize) {
+  stats.maxConnections = this->maxConnections;
+}
+
+DBConnectionPool::~DBConnectionPool() {
+  std::lock_guard lock(poolMutex);
+  for (auto &connection: all) {
+    // Statements have to be finalized before the handle can be closed
+    connection->statements.reset();
+    closeFunction(connection->handle);
+  }
+  all.clear();
+  idle.clear();
+}
+
+DBConnectionPool::Lease DBConnectionPool::acquire() {
+  using Clock = std::chrono::steady_clock;
+
+  std::unique_lock lock(poolMutex);
+  stats.acquisitions++;
+
+  const auto waitStart = Clock::now();
+  bool waited = false;
+
+  auto recordWait = [&] {
+    if (!waited) return;
+    auto waitNs = static_cast<uint64_t>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - waitStart).count());
+    stats.totalWaitNs += waitNs;
+    stats.maxWaitNs = std::max(stats.maxWaitNs, waitNs);
+  };
+
+  while (true) {
+    if (!idle.empty()) {
+      // Prefer the handle this thread used last, its page cache is still warm for our queries
+      const auto self = std::this_thread::get_id();
+      auto it = std::find_if(idle.begin(), idle.end(), [&](const Connection *conn) {
+        return conn->lastThread == self;
+      });
+      if (it == idle.end()) it = idle.end() - 1;
+
+      Connection *connection = *it;
+      idle.erase(it);
+      recordWait();
+      return Lease(this, connection);
+    }
+
+    if (all.size() + opening < maxConnections) {
+      opening++;
+      lock.unlock();
+
+      sqlite3 *handle = nullptr;
+      bool ok = openFunction(handle);
+      if (!ok && handle) {
+        closeFunction(handle);
+        handle = nullptr;
+      }
+
+      lock.lock();
+      opening--;
+      if (!ok) {
+        connectionReturned.notify_one();
+        return {};
+      }
+
+      auto connection = std::make_unique<Connection>();
+      connection->handle = handle;
+      connection->statements = std::make_unique<StatementCache>(handle, statementCacheSize);
+      all.push_back(std::move(connection));
+      recordWait();
+      return Lease(this, all.back().get());
+    }
+
+    if (!waited) {
+      waited = true;
+      stats.waits++;
+    }
+    connectionReturned.wait(lock);
+  }
+}
+
+void DBConnectionPool::giveBack(Connection *connection) {
+  // A caller that bailed out inside a transaction must not hand it on to the next lease
+  if (!sqlite3_get_autocommit(connection->handle)) {
+    sqlite3_exec(connection->handle, "ROLLBACK", nullptr, nullptr, nullptr);
+  }
+
+  {
+    std::lock_guard lock(poolMutex);
+    connection->lastThread = std::this_thread::get_id();
+    idle.push_back(connection);
+  }
+  connectionReturned.notify_one();
+}
+
+DBConnectionPool::Stats DBConnectionPool::getStats() const {
+  std::lock_guard lock(poolMutex);
+  Stats out = stats;
+  out.openConnections = all.size();
+  out.idleConnections = idle.size();
+  return out;
+}
+
+StatementCache::Stats DBConnectionPool::getStatementStats() const {
+  std::lock_guard lock(poolMutex);
+  StatementCache::Stats total;
+  for (const auto &connection: all) {
+    auto stats = connection->statements->getStats();
+    total.hits += stats.hits;
+    total.misses += stats.misses;
+    total.evictions += stats.evictions;
+    total.cached += stats.cached;
+  }
+  return total;
+}
@@ -0,0 +1,101 @@
+//
+// Created by deanprangenberg on 14.07.25.
+//
+
+#ifndef DBCONNECTIONPOOL_H
+#define DBCONNECTIONPOOL_H
+
+#include <sqlcipher/sqlite3.h>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "StatementCache.h"
+
+class DBConnectionPool {
+  struct Connection;
+
+public:
+  // Opens and keys a new handle, returns false on failure
+  using OpenFunction = std::function<bool(sqlite3 *&handle)>;
+  using CloseFunction = std::function<void(sqlite3 *handle)>;
+
+  struct Stats {
+    size_t maxConnections = 0;
+    size_t openConnections = 0;
+    size_t idleConnections = 0;
+    uint64_t acquisitions = 0;
+    uint64_t waits = 0;
+    uint64_t totalWaitNs = 0;
+    uint64_t maxWaitNs = 0;
+  };
+
+  // RAII handle, gives the connection back to the pool when destroyed
+  class Lease {
+  public:
+    Lease() = default;
+    ~Lease();
+
+    Lease(Lease &&other) noexcept;
+    Lease &operator=(Lease &&other) noexcept;
+    Lease(const Lease &) = delete;
+    Lease &operator=(const Lease &) = delete;
+
+    sqlite3 *get() const;
+    explicit operator bool() const { return connection != nullptr; }
+
+    // Cached prepared statement of this connection, reset again when the returned object dies
+    StatementCache::Statement prepare(const std::string &sql) const;
+
+    // Returns the connection early, e.g. before calling another method that acquires one itself
+    void release();
+
+  private:
+    friend class DBConnectionPool;
+    Lease(DBConnectionPool *pool, Connection *connection) : pool(pool), connection(connection) {}
+
+    DBConnectionPool *pool = nullptr;
+    Connection *connection = nullptr;
+  };
+
+  static constexpr size_t defaultStatementCacheSize = 32;
+
+  DBConnectionPool(OpenFunction openFunction, CloseFunction closeFunction, size_t maxConnections,
+                   size_t statementCacheSize = defaultStatementCacheSize);
+  ~DBConnectionPool();
+
+  DBConnectionPool(const DBConnectionPool &) = delete;
+  DBConnectionPool &operator=(const DBConnectionPool &) = delete;
+
+  Lease acquire();
+  Stats getStats() const;
+  StatementCache::Stats getStatementStats() const;
+
+private:
+  struct Connection {
+    sqlite3 *handle;
+    std::unique_ptr<StatementCache> statements;
+    std::thread::id lastThread;
+  };
+
+  void giveBack(Connection *connection);
+
+  OpenFunction openFunction;
+  CloseFunction closeFunction;
+  size_t maxConnections;
+  size_t statementCacheSize;
+
+  mutable std::mutex poolMutex;
+  std::condition_variable connectionReturned;
+  std::vector<Connection *> idle;
+  std::vector<std::unique_ptr<Connection> > all;
+  size_t opening = 0;
+  Stats stats;
+};
+
+#endif //DBCONNECTIONPOOL_H
@@ -4,16 +4,32 @@
 
 #include "LocalDatabase.h"
 
+#include <algorithm>
+#include <openssl/crypto.h>
+
 #include "../../../Shared/Crypto/KDF/KDFEnv.h"
 
-LocalDatabase::LocalDatabase(const fs::path &dbPath, const std::string &password, bool debugMode)
+LocalDatabase::LocalDatabase(const fs::path &dbPath, const std::string &password, bool debugMode, size_t poolSize)
     : dbPath(dbPath), password(password), debugMode(debugMode) {
   if (dbPath.empty() || (!debugMode && password.empty())) {
     throw std::runtime_error("DB path or password empty in encrypted mode");
   }
   if (!debugMode) {
     loadOrCreateSalt();
+    // HKDF runs once here instead of on every connection open
+    dbKey = deriveKey();
   }
+
+  pool = std::make_unique<DBConnectionPool>(
+    [this](sqlite3 *&handle) { return openConnection(handle); },
+    [this](sqlite3 *handle) { closeConnection(handle); },
+    poolSize);
+}
+
+LocalDatabase::~LocalDatabase() {
+  pool.reset();
+  OPENSSL_cleanse(dbKey.data(), dbKey.size());
+  OPENSSL_cleanse(password.data(), password.size());
 }
 
 void LocalDatabase::loadOrCreateSalt() {
@@ -58,22 +74,38 @@ std::vector<uint8_t> LocalDatabase::deriveKey() const {
 bool LocalDatabase::openConnection(sqlite3 *&handle) const {
   int rc;
 
+  // A pooled handle is only ever used by one thread at a time, so SQLite's own mutex is not needed
+  const int flags = SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE | SQLITE_OPEN_NOMUTEX;
+
   if (debugMode) {
     // Open database in debug mode (unencrypted)
-    rc = sqlite3_open_v2(dbPath.c_str(), &handle,
-                        SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE,
-                        nullptr);
+    rc = sqlite3_open_v2(dbPath.c_str(), &handle, flags, nullptr);
     std::cout << "Opening database in DEBUG mode (unencrypted)" << std::endl;
   } else {
     // Open database in encrypted mode
-    rc = sqlite3_open_v2(dbPath.c_str(), &handle,
-                        SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE,
-                        nullptr);
+    rc = sqlite3_open_v2(dbPath.c_str(), &handle, flags, nullptr);
     if (rc != SQLITE_OK) return false;
 
-    auto key = deriveKey();
-    rc = sqlite3_key(handle, key.data(), static_cast<int>(key.size()));
-    std::fill(key.begin(), key.end(), 0);
+    rc = sqlite3_key(handle, dbKey.data(), static_cast<int>(dbKey.size()));
+  }
+  if (rc != SQLITE_OK) return false;
+
+  sqlite3_busy_timeout(handle, 5000);
+
+  // WAL lets readers on other pooled connections run while the writer holds the write lock
+  rc = sqlite3_exec(handle,
+                    "PRAGMA journal_mode = WAL;"
+                    "PRAGMA synchronous = NORMAL;"
+                    "PRAGMA cache_size = -8000;"
+                    "PRAGMA temp_store = MEMORY;",
+                    nullptr, nullptr, nullptr);
+  if (rc == SQLITE_OK) {
+    // Touch the schema once so the key is verified and the first pages are cached
+    // before the handle is handed out
+    rc = sqlite3_exec(handle, "SELECT count(*) FROM sqlite_master;", nullptr, nullptr, nullptr);
+  }
+  if (rc != SQLITE_OK) {
+    std::cerr << "Could not open database connection: " << sqlite3_errmsg(handle) << std::endl;
   }
 
   return rc == SQLITE_OK;
@@ -83,28 +115,49 @@ void LocalDatabase::closeConnection(sqlite3 *handle) const {
   sqlite3_close(handle);
 }
 
+DBConnectionPool::Lease LocalDatabase::acquireConnection() {
+  auto conn = pool->acquire();
+  if (!conn) {
+    setLastError("Could not acquire database connection");
+  }
+  return conn;
+}
+
+DBConnectionPool::Stats LocalDatabase::getPoolStats() const {
+  return pool->getStats();
+}
+
+StatementCache::Stats LocalDatabase::getStatementCacheStats() const {
+  return pool->getStatementStats();
+}
+
+void LocalDatabase::setLastError(const std::string &error) {
+  std::lock_guard lock(errorMutex);
+  lastError = error;
+}
+
 bool LocalDatabase::execute(const std::string &sql) {
-  sqlite3 *handle = nullptr;
-  if (!openConnection(handle)) return false;
+  auto conn = acquireConnection();
+  if (!conn) return false;
 
   char *errMsg = nullptr;
-  int rc = sqlite3_exec(handle, sql.c_str(), nullptr, nullptr, &errMsg);
+  int rc = sqlite3_exec(conn.get(), sql.c_str(), nullptr, nullptr, &errMsg);
   if (rc != SQLITE_OK) {
     std::cerr << "SQL-error: " << errMsg << std::endl;
+    setLastError(errMsg ? errMsg : "unknown error");
     sqlite3_free(errMsg);
   }
 
-  closeConnection(handle);
   return rc == SQLITE_OK;
 }
 
 bool LocalDatabase::query(const std::string &sql,
                           std::vector<std::vector<std::string> > &result) {
-  sqlite3 *handle = nullptr;
-  if (!openConnection(handle)) return false;
+  auto conn = acquireConnection();
+  if (!conn) return false;
 
   char *errMsg = nullptr;
-  int rc = sqlite3_exec(handle, sql.c_str(),
+  int rc = sqlite3_exec(conn.get(), sql.c_str(),
                         [](void *data, int argc, char **argv, char **azColName) -> int {
                           auto *res = reinterpret_cast<std::vector<std::vector<std::string> > *>(data);
                           std::vector<std::string> row;
@@ -117,13 +170,83 @@ bool LocalDatabase::query(const std::string &sql,
 
   if (rc != SQLITE_OK) {
     std::cerr << "SQL-error: " << errMsg << std::endl;
+    setLastError(errMsg ? errMsg : "unknown error");
     sqlite3_free(errMsg);
   }
 
-  closeConnection(handle);
   return rc == SQLITE_OK;
 }
 
+int LocalDatabase::getSchemaVersion() {
+  auto conn = acquireConnection();
+  if (!conn) return -1;
+  return readSchemaVersion(conn.get());
+}
+
+int LocalDatabase::readSchemaVersion(sqlite3 *handle) {
+  sqlite3_stmt *stmt = nullptr;
+  if (sqlite3_prepare_v2(handle, "PRAGMA user_version;", -1, &stmt, nullptr) != SQLITE_OK) return -1;
+  const int version = sqlite3_step(stmt) == SQLITE_ROW ? sqlite3_column_int(stmt, 0) : -1;
+  sqlite3_finalize(stmt);
+  return version;
+}
+
+bool LocalDatabase::runMigrations(std::vector<SchemaMigration> migrations) {
+  std::sort(migrations.begin(), migrations.end(), [](const SchemaMigration &a, const SchemaMigration &b) {
+    return a.version < b.version;
+  });
+
+  const int currentVersion = getSchemaVersion();
+  if (currentVersion < 0) return false;
+
+  auto conn = acquireConnection();
+  if (!conn) return false;
+  sqlite3 *handle = conn.get();
+
+  for (const auto &migration: migrations) {
+    if (migration.version <= currentVersion) continue;
+
+    // IMMEDIATE takes the write lock before the version is read again, a second process that
+    // migrated in the meantime is seen here and its migrations are skipped
+    if (sqlite3_exec(handle, "BEGIN IMMEDIATE;", nullptr, nullptr, nullptr) != SQLITE_OK) {
+      setLastError(sqlite3_errmsg(handle));
+      return false;
+    }
+
+    const int lockedVersion = readSchemaVersion(handle);
+    if (lockedVersion < 0) {
+      setLastError(sqlite3_errmsg(handle));
+      sqlite3_exec(handle, "ROLLBACK;", nullptr, nullptr, nullptr);
+      return false;
+    }
+    if (migration.version <= lockedVersion) {
+      sqlite3_exec(handle, "ROLLBACK;", nullptr, nullptr, nullptr);
+      continue;
+    }
+
+    const std::string setVersion = "PRAGMA user_version = " + std::to_string(migration.version) + ";";
+    if (!migration.apply(handle) || sqlite3_exec(handle, setVersion.c_str(), nullptr, nullptr, nullptr) != SQLITE_OK) {
+      std::string error = "Migration " + std::to_string(migration.version) + " (" + migration.description +
+                          ") failed: " + sqlite3_errmsg(handle);
+      std::cerr << error << std::endl;
+      setLastError(error);
+      sqlite3_exec(handle, "ROLLBACK;", nullptr, nullptr, nullptr);
+      return false;
+    }
+
+    if (sqlite3_exec(handle, "COMMIT;", nullptr, nullptr, nullptr) != SQLITE_OK) {
+      setLastError(sqlite3_errmsg(handle));
+      sqlite3_exec(handle, "ROLLBACK;", nullptr, nullptr, nullptr);
+      return false;
+    }
+
+    std::cout << "Applied DB migration " << migration.version << ": " << migration.description << std::endl;
+  }
+
+  return true;
+}
+
 std::string LocalDatabase::getLastError() const {
-  return sqlite3_errmsg(nullptr); // wenn nötig, kann man letzten Handle cachen
+  std::lock_guard lock(errorMutex);
+  return lastError;
 }
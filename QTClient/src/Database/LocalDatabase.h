@@ -12,31 +12,62 @@
 #include <sqlcipher/sqlite3.h>
 #include <openssl/rand.h>
 #include <fstream>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include "DBConnectionPool.h"
 #include "../../../Shared/Crypto/KeyEnv/KeyEnv.h"
 
 namespace fs = std::filesystem;
 
+// One step of the schema, applied once and recorded in PRAGMA user_version
+struct SchemaMigration {
+  int version;
+  std::string description;
+  std::function<bool(sqlite3 *handle)> apply;
+};
+
 class LocalDatabase {
 protected:
   fs::path dbPath;
   std::string password;
   std::vector<uint8_t> salt;     // 16-Byte Salt
+  std::vector<uint8_t> dbKey;    // derived once, wiped in destructor
   bool debugMode;
+  std::unique_ptr<DBConnectionPool> pool;
+  mutable std::mutex errorMutex;
+  std::string lastError;
 
   // Helper methods
   void loadOrCreateSalt();
   std::vector<uint8_t> deriveKey() const;
   bool openConnection(sqlite3*& handle) const;
   void closeConnection(sqlite3* handle) const;
+  DBConnectionPool::Lease acquireConnection();
+  void setLastError(const std::string& error);
   bool createChatTables();
+  // Applies every migration above the stored user_version in ascending order,
+  // each one inside its own transaction
+  bool runMigrations(std::vector<SchemaMigration> migrations);
+  int getSchemaVersion();
+  static int readSchemaVersion(sqlite3* handle);
 
 public:
-  LocalDatabase(const fs::path& dbPath, const std::string& password, bool debugMode = false);
+  static constexpr size_t defaultPoolSize = 4;
+
+  LocalDatabase(const fs::path& dbPath, const std::string& password, bool debugMode = false,
+                size_t poolSize = defaultPoolSize);
+  virtual ~LocalDatabase();
+
+  LocalDatabase(const LocalDatabase&) = delete;
+  LocalDatabase& operator=(const LocalDatabase&) = delete;
 
   bool execute(const std::string& sql);
   bool query(const std::string& sql, std::vector<std::vector<std::string>>& result);
   std::string getLastError() const;
   bool isInDebugMode() const { return debugMode; }
+  DBConnectionPool::Stats getPoolStats() const;
+  StatementCache::Stats getStatementCacheStats() const;
 };
 
 #endif // LOCALDATABASE_H
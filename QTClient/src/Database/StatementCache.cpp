@@ -0,0 +1,124 @@
+//
+// Created by deanprangenberg on 15.07.25.
+//
+
+#include "StatementCache.h"
+
+#include <algorithm>
+#include <iostream>
+#include <iterator>
+
+StatementCache::Statement::~Statement() {
+  release();
+}
+
+void StatementCache::Statement::release() {
+  if (!stmt) return;
+
+  if (borrowed) {
+    sqlite3_reset(stmt);
+    sqlite3_clear_bindings(stmt);
+    *borrowed = false;
+  } else {
+    sqlite3_finalize(stmt);
+  }
+  stmt = nullptr;
+  borrowed = nullptr;
+}
+
+StatementCache::Statement::Statement(Statement &&other) noexcept : stmt(other.stmt), borrowed(other.borrowed) {
+  other.stmt = nullptr;
+  other.borrowed = nullptr;
+}
+
+StatementCache::Statement &StatementCache::Statement::operator=(Statement &&other) noexcept {
+  if (this != &other) {
+    release();
+    stmt = other.stmt;
+    borrowed = other.borrowed;
+    other.stmt = nullptr;
+    other.borrowed = nullptr;
+  }
+  return *this;
+}
+
+StatementCache::StatementCache(sqlite3 *handle, size_t capacity)
+  : handle(handle), capacity(std::max<size_t>(1, capacity)) {
+}
+
+StatementCache::~StatementCache() {
+  clear();
+}
+
+StatementCache::Statement StatementCache::get(const std::string &sql) {
+  if (auto it = index.find(sql); it != index.end()) {
+    Entry &entry = *it->second;
+    if (entry.borrowed) {
+      // Resetting it would pull the rows out from under the current borrower
+      return prepareUncached(sql);
+    }
+    hits++;
+    lru.splice(lru.begin(), lru, it->second);
+    sqlite3_reset(entry.stmt);
+    sqlite3_clear_bindings(entry.stmt);
+    entry.borrowed = true;
+    return Statement(entry.stmt, &entry.borrowed);
+  }
+
+  // Least recently used entry that is not borrowed right now
+  auto victim = std::find_if(lru.rbegin(), lru.rend(), [](const Entry &entry) { return !entry.borrowed; });
+  if (lru.size() >= capacity && victim == lru.rend()) {
+    return prepareUncached(sql);
+  }
+
+  misses++;
+  sqlite3_stmt *stmt = nullptr;
+  if (sqlite3_prepare_v3(handle, sql.c_str(), static_cast<int>(sql.size() + 1),
+                         SQLITE_PREPARE_PERSISTENT, &stmt, nullptr) != SQLITE_OK) {
+    std::cerr << "SQL-prepare-error: " << sqlite3_errmsg(handle) << std::endl;
+    sqlite3_finalize(stmt);
+    return {};
+  }
+
+  if (lru.size() >= capacity) {
+    auto victimIt = std::prev(victim.base());
+    sqlite3_finalize(victimIt->stmt);
+    index.erase(victimIt->sql);
+    lru.erase(victimIt);
+    evictions++;
+  }
+
+  lru.push_front({sql, stmt, true});
+  index.emplace(sql, lru.begin());
+  cachedCount = index.size();
+  return Statement(stmt, &lru.front().borrowed);
+}
+
+StatementCache::Statement StatementCache::prepareUncached(const std::string &sql) {
+  misses++;
+  sqlite3_stmt *stmt = nullptr;
+  if (sqlite3_prepare_v2(handle, sql.c_str(), static_cast<int>(sql.size() + 1), &stmt, nullptr) != SQLITE_OK) {
+    std::cerr << "SQL-prepare-error: " << sqlite3_errmsg(handle) << std::endl;
+    sqlite3_finalize(stmt);
+    return {};
+  }
+  return Statement(stmt, nullptr);
+}
+
+StatementCache::Stats StatementCache::getStats() const {
+  Stats stats;
+  stats.hits = hits.load();
+  stats.misses = misses.load();
+  stats.evictions = evictions.load();
+  stats.cached = cachedCount.load();
+  return stats;
+}
+
+void StatementCache::clear() {
+  for (auto &entry: lru) {
+    sqlite3_finalize(entry.stmt);
+  }
+  lru.clear();
+  index.clear();
+  cachedCount = 0;
+}
@@ -0,0 +1,83 @@
+//
+// Created by deanprangenberg on 15.07.25.
+//
+
+#ifndef STATEMENTCACHE_H
+#define STATEMENTCACHE_H
+
+#include <sqlcipher/sqlite3.h>
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <string>
+#include <unordered_map>
+
+// LRU cache of prepared statements for a single connection, keyed by SQL text.
+// Not thread safe on its own, the owning connection is only used by one thread at a time.
+class StatementCache {
+public:
+  struct Stats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t evictions = 0;
+    size_t cached = 0;
+  };
+
+  // Borrowed statement, reset and unbound again when it goes out of scope. A statement that
+  // could not be borrowed from the cache is owned instead and finalized.
+  class Statement {
+  public:
+    Statement() = default;
+    Statement(sqlite3_stmt *stmt, bool *borrowed) : stmt(stmt), borrowed(borrowed) {}
+    ~Statement();
+
+    Statement(Statement &&other) noexcept;
+    Statement &operator=(Statement &&other) noexcept;
+    Statement(const Statement &) = delete;
+    Statement &operator=(const Statement &) = delete;
+
+    sqlite3_stmt *get() const { return stmt; }
+    explicit operator bool() const { return stmt != nullptr; }
+
+  private:
+    void release();
+
+    sqlite3_stmt *stmt = nullptr;
+    // Entry::borrowed of the cached statement, nullptr if the statement is owned
+    bool *borrowed = nullptr;
+  };
+
+  StatementCache(sqlite3 *handle, size_t capacity);
+  ~StatementCache();
+
+  StatementCache(const StatementCache &) = delete;
+  StatementCache &operator=(const StatementCache &) = delete;
+
+  // Returns a reset statement with cleared bindings, prepares it on a miss. If the cached
+  // statement is still borrowed, e.g. by an outer loop over the same query, an uncached one is
+  // prepared. Borrowed statements are never evicted, all of them must be gone before clear().
+  Statement get(const std::string &sql);
+  Stats getStats() const;
+  void clear();
+
+private:
+  struct Entry {
+    std::string sql;
+    sqlite3_stmt *stmt;
+    bool borrowed = false;
+  };
+
+  Statement prepareUncached(const std::string &sql);
+
+  sqlite3 *handle;
+  size_t capacity;
+  std::list<Entry> lru; // front = most recently used
+  std::unordered_map<std::string, std::list<Entry>::iterator> index;
+
+  std::atomic<uint64_t> hits{0};
+  std::atomic<uint64_t> misses{0};
+  std::atomic<uint64_t> evictions{0};
+  std::atomic<size_t> cachedCount{0};
+};
+
+#endif //STATEMENTCACHE_H
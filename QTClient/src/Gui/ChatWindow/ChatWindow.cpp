@@ -4,12 +4,11 @@
 
 #include "ChatWindow.h"
 
+#include <QScrollBar>
+#include <utility>
+
 namespace Gui {
   ChatWindow::ChatWindow(const QString chatUUIDIn, QWidget *parent) : QWidget(parent) {
-    messageContainer = new QWidget(this);
-    messageContainer->setObjectName("ChatWindowContainer");
-    messageContainerLayout = new QVBoxLayout(messageContainer);
-
     WindowLayout = new QVBoxLayout(this);
     WindowLayout->setContentsMargins(0, 0, 0, 0);
 
@@ -17,17 +16,37 @@ namespace Gui {
     chatInputBar->setObjectName("ChatWindowChatInputBar");
     chatInputBar->setMaximumHeight(50);
 
-    chatArea = new QScrollArea(this);
-    chatArea->setObjectName("ChatWindowScrollChatArea");
-    chatArea->setWidget(messageContainer);
-    chatArea->setWidgetResizable(true);
-    chatArea->setVerticalScrollBarPolicy(Qt::ScrollBarAlwaysOn);
-    chatArea->setHorizontalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
+    messageModel = new MessageListModel(this);
+    messageDelegate = new MessageDelegate(this);
+
+    // Only the visible rows get painted, row heights are laid out in batches in the background
+    messageView = new QListView(this);
+    messageView->setObjectName("ChatWindowMessageView");
+    messageView->setModel(messageModel);
+    messageView->setItemDelegate(messageDelegate);
+    messageView->setUniformItemSizes(false);
+    messageView->setLayoutMode(QListView::Batched);
+    messageView->setBatchSize(200);
+    messageView->setResizeMode(QListView::Adjust);
+    messageView->setVerticalScrollMode(QAbstractItemView::ScrollPerPixel);
+    messageView->setSelectionMode(QAbstractItemView::NoSelection);
+    messageView->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    messageView->setFocusPolicy(Qt::NoFocus);
+    messageView->setVerticalScrollBarPolicy(Qt::ScrollBarAlwaysOn);
+    messageView->setHorizontalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
+
+    // Everything appended during one event loop tick becomes a single row insert
+    flushTimer = new QTimer(this);
+    flushTimer->setSingleShot(true);
+    flushTimer->setInterval(0);
+    connect(flushTimer, &QTimer::timeout, this, &ChatWindow::flushPendingMessages);
 
     chatUUID = chatUUIDIn;
 
-    // Add chatArea to WindowLayout first, then chatInputBar
-    WindowLayout->addWidget(chatArea);
+    connect(messageView->verticalScrollBar(), &QScrollBar::valueChanged, this, &ChatWindow::onScrollValueChanged);
+
+    // Add messageView to WindowLayout first, then chatInputBar
+    WindowLayout->addWidget(messageView);
     WindowLayout->addWidget(chatInputBar);
 
     setContentsMargins(0, 0, 0, 0);
@@ -35,40 +54,88 @@ namespace Gui {
   }
 
   ChatWindow::~ChatWindow() {
-    messageList.clear();
-    delete messageContainer;
-    delete messageContainerLayout;
+    delete messageView;
+    delete messageDelegate;
+    delete messageModel;
     delete WindowLayout;
-    delete chatArea;
     delete chatInputBar;
   }
 
   void ChatWindow::setChatHistory(const QList<MessageContainer> &messageListIn) {
-    messageList = messageListIn;  // Now copying the list
-    updateDisplayedMessage();     // Update the display after setting
+    flushTimer->stop();
+    pendingMessages.clear();
+    messageDelegate->clearCache();
+    messageModel->setMessages(messageListIn);
+    messageView->scrollToBottom();
+  }
+
+  const QList<MessageContainer> &ChatWindow::getChatHistory() {
+    flushPendingMessages();
+    return messageModel->messages();
   }
 
-  QList<MessageContainer> &ChatWindow::getChatHistory() {
-    return messageList;
+  bool ChatWindow::isScrolledToBottom() const {
+    const auto *scrollBar = messageView->verticalScrollBar();
+    return scrollBar->value() >= scrollBar->maximum();
   }
 
   void ChatWindow::addNewMessages(QList<MessageContainer> messageContainers) {
-    messageList.append(messageContainers);
-    updateDisplayedMessage();
+    if (messageContainers.isEmpty()) return;
+
+    pendingMessages.append(std::move(messageContainers));
+    if (!flushTimer->isActive()) {
+      flushTimer->start();
+    }
+  }
+
+  void ChatWindow::flushPendingMessages() {
+    flushTimer->stop();
+    if (pendingMessages.isEmpty()) return;
+
+    // Follow the conversation only if the user has not scrolled up to read
+    const bool followNewest = isScrolledToBottom();
+    messageModel->appendMessages(std::exchange(pendingMessages, {}));
+    if (followNewest) {
+      messageView->scrollToBottom();
+    }
   }
 
   void ChatWindow::addOldMessages(QList<MessageContainer> messageContainers) {
-    messageList.append(messageContainers);
-    updateDisplayedMessage();
+    olderMessagesPending = false;
+    if (messageContainers.isEmpty()) return;
+    flushPendingMessages();
+
+    // Keep the first visible message in place while the older page is inserted above it
+    const QModelIndex anchor = messageView->indexAt(QPoint(0, 0));
+    const int anchorRow = anchor.isValid() ? anchor.row() : 0;
+
+    messageModel->prependMessages(messageContainers);
+    messageView->scrollTo(messageModel->index(anchorRow + static_cast<int>(messageContainers.size())),
+                          QAbstractItemView::PositionAtTop);
   }
 
-  void ChatWindow::updateDisplayedMessage() {
-    GuiHelper::clearLayout(messageContainerLayout);
-    for (const auto &messageContent: messageList) {
-      Message *msg = new Message(messageContent, messageContainer);
-      msg->setObjectName("ChatWindowMessage");
-      messageContainerLayout->addWidget(msg);
-    }
-    messageContainerLayout->addStretch(1);
+  bool ChatWindow::removeMessage(const QString &messageUUID) {
+    flushPendingMessages();
+    messageDelegate->forgetMessage(messageUUID);
+    return messageModel->removeMessage(messageUUID);
+  }
+
+  bool ChatWindow::updateMessage(const MessageContainer &newContent) {
+    flushPendingMessages();
+    messageDelegate->forgetMessage(newContent.messageUUID);
+    return messageModel->updateMessage(newContent);
+  }
+
+  void ChatWindow::setHistoryComplete(bool complete) {
+    historyComplete = complete;
+    olderMessagesPending = false;
+  }
+
+  void ChatWindow::onScrollValueChanged(int value) {
+    if (historyComplete || olderMessagesPending || messageModel->rowCount() == 0) return;
+    if (value != messageView->verticalScrollBar()->minimum()) return;
+
+    olderMessagesPending = true;
+    emit olderMessagesRequested(chatUUID);
   }
 } // Gui
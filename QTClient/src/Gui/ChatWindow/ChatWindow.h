@@ -9,10 +9,12 @@
 #include <QLineEdit>
 #include <QPushButton>
 #include <QLabel>
-#include <QScrollArea>
+#include <QListView>
+#include <QTimer>
 
 #include "ChatInputBar.h"
-#include "Message.h"
+#include "MessageDelegate.h"
+#include "MessageListModel.h"
 #include "../GuiHelper/GuiHelper.h"
 
 namespace Gui {
@@ -23,18 +25,32 @@ namespace Gui {
     explicit ChatWindow(const QString chatUUIDIn, QWidget *parent = nullptr);
     ~ChatWindow() override;
     void setChatHistory(const QList<MessageContainer> &messageListIn);
-    QList<MessageContainer>& getChatHistory();
+    const QList<MessageContainer> &getChatHistory();
+    // Queued and inserted together on the next event loop tick
     void addNewMessages(QList<MessageContainer> messageContainers);
+    void flushPendingMessages();
     void addOldMessages(QList<MessageContainer> messageContainers);
+    bool removeMessage(const QString &messageUUID);
+    bool updateMessage(const MessageContainer &newContent);
+    // Stops asking for older pages once the database has nothing left
+    void setHistoryComplete(bool complete);
     QString chatUUID;
-    QList<MessageContainer> messageList;
+
+  signals:
+    // Scrolled to the top, the next older page should be loaded
+    void olderMessagesRequested(const QString &chatUUID);
 
   private:
-    void updateDisplayedMessage();
-    QWidget* messageContainer;
-    QVBoxLayout *messageContainerLayout;
+    void onScrollValueChanged(int value);
+    bool isScrolledToBottom() const;
+    bool historyComplete = false;
+    bool olderMessagesPending = false;
+    QList<MessageContainer> pendingMessages;
+    QTimer *flushTimer;
     QVBoxLayout *WindowLayout;
-    QScrollArea *chatArea;
+    QListView *messageView;
+    MessageListModel *messageModel;
+    MessageDelegate *messageDelegate;
     ChatInputBar *chatInputBar;
   };
 } // Gui
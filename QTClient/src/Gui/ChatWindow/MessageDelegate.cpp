@@ -0,0 +1,105 @@
+//
+// Created by deanprangenberg on 20.07.25.
+//
+
+#include "MessageDelegate.h"
+
+#include <algorithm>
+#include <QAbstractItemView>
+#include <QFontMetrics>
+#include <QPainter>
+
+#include "MessageListModel.h"
+
+namespace Gui {
+  MessageDelegate::MessageDelegate(QObject *parent) : QStyledItemDelegate(parent) {
+  }
+
+  const MessageContainer *MessageDelegate::messageFor(const QModelIndex &index) {
+    const auto *model = qobject_cast<const MessageListModel *>(index.model());
+    if (!model || !index.isValid() || index.row() >= model->rowCount()) return nullptr;
+    return &model->messageAt(index.row());
+  }
+
+  int MessageDelegate::rowWidth(const QStyleOptionViewItem &option) {
+    // QListView asks for size hints with an empty rect, the viewport decides the width
+    if (const auto *view = qobject_cast<const QAbstractItemView *>(option.widget)) {
+      return view->viewport()->width();
+    }
+    return option.rect.width();
+  }
+
+  int MessageDelegate::textHeight(const MessageContainer &message, const QFontMetrics &metrics, int textWidth) const {
+    if (const CachedHeight *cached = heightCache.object(message.messageUUID); cached && cached->textWidth == textWidth) {
+      return cached->height;
+    }
+
+    const int height = metrics.boundingRect(QRect(0, 0, textWidth, 0), Qt::TextWordWrap, message.message).height();
+    heightCache.insert(message.messageUUID, new CachedHeight{textWidth, height});
+    return height;
+  }
+
+  QPixmap MessageDelegate::scaledAvatar(const QImage &avatar) const {
+    if (avatar.isNull()) return {};
+
+    const qint64 key = avatar.cacheKey();
+    if (auto it = avatarCache.constFind(key); it != avatarCache.constEnd()) {
+      return it.value();
+    }
+
+    QPixmap scaled = QPixmap::fromImage(
+      avatar.scaled(avatarSize, avatarSize, Qt::KeepAspectRatio, Qt::SmoothTransformation));
+    avatarCache.insert(key, scaled);
+    return scaled;
+  }
+
+  QSize MessageDelegate::sizeHint(const QStyleOptionViewItem &option, const QModelIndex &index) const {
+    const MessageContainer *message = messageFor(index);
+    if (!message) return QStyledItemDelegate::sizeHint(option, index);
+
+    const int width = rowWidth(option);
+    const int textWidth = std::max(1, width - 2 * rowPadding - avatarSize - spacing);
+    const int contentHeight = (message->isFollowUp ? 0 : topRowHeight) +
+                              textHeight(*message, QFontMetrics(option.font), textWidth);
+
+    return {width, std::max(avatarSize, contentHeight) + rowPadding};
+  }
+
+  void MessageDelegate::paint(QPainter *painter, const QStyleOptionViewItem &option, const QModelIndex &index) const {
+    const MessageContainer *message = messageFor(index);
+    if (!message) return;
+
+    painter->save();
+    painter->setFont(option.font);
+    painter->setPen(option.palette.color(QPalette::Text));
+
+    const QRect row = option.rect.adjusted(rowPadding, rowPadding / 2, -rowPadding, -rowPadding / 2);
+    const QRect avatarRect(row.left(), row.top(), avatarSize, avatarSize);
+    QRect contentRect(avatarRect.right() + 1 + spacing, row.top(),
+                      row.width() - avatarSize - spacing, row.height());
+
+    if (!message->isFollowUp) {
+      const QPixmap avatar = scaledAvatar(message->avatar);
+      if (!avatar.isNull()) {
+        painter->drawPixmap(avatarRect.topLeft(), avatar);
+      }
+
+      const QRect topRow(contentRect.left(), contentRect.top(), contentRect.width(), topRowHeight);
+      painter->drawText(topRow, Qt::AlignLeft | Qt::AlignVCenter, message->senderName);
+      painter->drawText(topRow, Qt::AlignRight | Qt::AlignVCenter, message->time);
+      contentRect.setTop(contentRect.top() + topRowHeight);
+    }
+
+    painter->drawText(contentRect, Qt::TextWordWrap | Qt::AlignLeft | Qt::AlignTop, message->message);
+    painter->restore();
+  }
+
+  void MessageDelegate::forgetMessage(const QString &messageUUID) {
+    heightCache.remove(messageUUID);
+  }
+
+  void MessageDelegate::clearCache() {
+    heightCache.clear();
+    avatarCache.clear();
+  }
+} // Gui
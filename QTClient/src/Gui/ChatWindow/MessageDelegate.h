@@ -0,0 +1,55 @@
+//
+// Created by deanprangenberg on 20.07.25.
+//
+
+#ifndef MESSAGEDELEGATE_H
+#define MESSAGEDELEGATE_H
+
+#include <QCache>
+#include <QHash>
+#include <QPixmap>
+#include <QStyledItemDelegate>
+
+#include "../Gui_Structs_Enums.h"
+
+namespace Gui {
+  // Paints a message row without creating any widgets
+  class MessageDelegate : public QStyledItemDelegate {
+    Q_OBJECT
+
+  public:
+    explicit MessageDelegate(QObject *parent = nullptr);
+
+    void paint(QPainter *painter, const QStyleOptionViewItem &option, const QModelIndex &index) const override;
+    QSize sizeHint(const QStyleOptionViewItem &option, const QModelIndex &index) const override;
+
+    // Drops the cached height of a message whose text changed or which was removed
+    void forgetMessage(const QString &messageUUID);
+    void clearCache();
+
+  private:
+    static constexpr int avatarSize = 40;
+    static constexpr int spacing = 8;
+    static constexpr int topRowHeight = 16;
+    static constexpr int rowPadding = 6;
+    // Least recently used heights beyond this are dropped, well above the rows a chat keeps loaded
+    static constexpr int maxCachedHeights = 10000;
+
+    static const MessageContainer *messageFor(const QModelIndex &index);
+    static int rowWidth(const QStyleOptionViewItem &option);
+    int textHeight(const MessageContainer &message, const QFontMetrics &metrics, int textWidth) const;
+    QPixmap scaledAvatar(const QImage &avatar) const;
+
+    struct CachedHeight {
+      int textWidth;
+      int height;
+    };
+
+    // sizeHint runs for every row during layout, word wrapping is the expensive part
+    mutable QCache<QString, CachedHeight> heightCache{maxCachedHeights};
+    // keyed by QImage::cacheKey of the original avatar
+    mutable QHash<qint64, QPixmap> avatarCache;
+  };
+} // Gui
+
+#endif //MESSAGEDELEGATE_H
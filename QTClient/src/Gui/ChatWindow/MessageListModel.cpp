@@ -0,0 +1,91 @@
+//
+// Created by deanprangenberg on 20.07.25.
+//
+
+#include "MessageListModel.h"
+
+namespace Gui {
+  MessageListModel::MessageListModel(QObject *parent) : QAbstractListModel(parent) {
+  }
+
+  int MessageListModel::rowCount(const QModelIndex &parent) const {
+    return parent.isValid() ? 0 : static_cast<int>(messageList.size());
+  }
+
+  QVariant MessageListModel::data(const QModelIndex &index, int role) const {
+    if (!index.isValid() || index.row() >= messageList.size()) return {};
+
+    const auto &message = messageList.at(index.row());
+    switch (role) {
+      case Qt::DisplayRole:
+        return message.message;
+      case Qt::ToolTipRole:
+        return message.time;
+      default:
+        return {};
+    }
+  }
+
+  const MessageContainer &MessageListModel::messageAt(int row) const {
+    return messageList.at(row);
+  }
+
+  const QList<MessageContainer> &MessageListModel::messages() const {
+    return messageList;
+  }
+
+  int MessageListModel::rowOf(const QString &messageUUID) const {
+    // Edits and deletes are rare and mostly hit the newest messages
+    for (int row = static_cast<int>(messageList.size()) - 1; row >= 0; --row) {
+      if (messageList.at(row).messageUUID == messageUUID) return row;
+    }
+    return -1;
+  }
+
+  void MessageListModel::setMessages(const QList<MessageContainer> &messageListIn) {
+    beginResetModel();
+    messageList = messageListIn;
+    endResetModel();
+  }
+
+  void MessageListModel::appendMessages(const QList<MessageContainer> &messageContainers) {
+    if (messageContainers.isEmpty()) return;
+
+    const int first = static_cast<int>(messageList.size());
+    beginInsertRows(QModelIndex(), first, first + static_cast<int>(messageContainers.size()) - 1);
+    messageList.append(messageContainers);
+    endInsertRows();
+  }
+
+  void MessageListModel::prependMessages(const QList<MessageContainer> &messageContainers) {
+    if (messageContainers.isEmpty()) return;
+
+    beginInsertRows(QModelIndex(), 0, static_cast<int>(messageContainers.size()) - 1);
+    QList<MessageContainer> merged;
+    merged.reserve(messageContainers.size() + messageList.size());
+    merged.append(messageContainers);
+    merged.append(messageList);
+    messageList = std::move(merged);
+    endInsertRows();
+  }
+
+  bool MessageListModel::removeMessage(const QString &messageUUID) {
+    const int row = rowOf(messageUUID);
+    if (row < 0) return false;
+
+    beginRemoveRows(QModelIndex(), row, row);
+    messageList.removeAt(row);
+    endRemoveRows();
+    return true;
+  }
+
+  bool MessageListModel::updateMessage(const MessageContainer &newContent) {
+    const int row = rowOf(newContent.messageUUID);
+    if (row < 0) return false;
+
+    messageList.replace(row, newContent);
+    const QModelIndex changed = index(row);
+    emit dataChanged(changed, changed);
+    return true;
+  }
+} // Gui
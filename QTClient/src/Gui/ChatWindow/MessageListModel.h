@@ -0,0 +1,39 @@
+//
+// Created by deanprangenberg on 20.07.25.
+//
+
+#ifndef MESSAGELISTMODEL_H
+#define MESSAGELISTMODEL_H
+
+#include <QAbstractListModel>
+#include <QList>
+
+#include "../Gui_Structs_Enums.h"
+
+namespace Gui {
+  // Backing list of a ChatWindow, the view only creates painters for visible rows
+  class MessageListModel : public QAbstractListModel {
+    Q_OBJECT
+
+  public:
+    explicit MessageListModel(QObject *parent = nullptr);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role) const override;
+
+    const MessageContainer &messageAt(int row) const;
+    const QList<MessageContainer> &messages() const;
+    int rowOf(const QString &messageUUID) const;
+
+    void setMessages(const QList<MessageContainer> &messageListIn);
+    void appendMessages(const QList<MessageContainer> &messageContainers);
+    void prependMessages(const QList<MessageContainer> &messageContainers);
+    bool removeMessage(const QString &messageUUID);
+    bool updateMessage(const MessageContainer &newContent);
+
+  private:
+    QList<MessageContainer> messageList;
+  };
+} // Gui
+
+#endif //MESSAGELISTMODEL_H
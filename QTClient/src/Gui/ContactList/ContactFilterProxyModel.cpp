@@ -0,0 +1,296 @@
+//
+// Created by deanprangenberg on 23.07.25.
+//
+
+#include "ContactFilterProxyModel.h"
+
+#include <algorithm>
+
+namespace Gui {
+  namespace {
+    // More scattered changes than this are signalled as one reset, the view relayouts once
+    constexpr qsizetype maxIncrementalEdits = 64;
+  }
+
+  ContactFilterProxyModel::ContactFilterProxyModel(QObject *parent) : QAbstractProxyModel(parent) {
+  }
+
+  void ContactFilterProxyModel::setContactModel(ContactListModel *model) {
+    beginResetModel();
+    if (contactModel) disconnect(contactModel, nullptr, this, nullptr);
+    contactModel = model;
+    setSourceModel(model);
+
+    if (contactModel) {
+      connect(contactModel, &QAbstractItemModel::rowsInserted, this, &ContactFilterProxyModel::onRowsInserted);
+      connect(contactModel, &QAbstractItemModel::rowsAboutToBeRemoved, this,
+              &ContactFilterProxyModel::onRowsAboutToBeRemoved);
+      connect(contactModel, &QAbstractItemModel::rowsRemoved, this, &ContactFilterProxyModel::onRowsRemoved);
+      connect(contactModel, &QAbstractItemModel::dataChanged, this, &ContactFilterProxyModel::onDataChanged);
+      connect(contactModel, &QAbstractItemModel::modelAboutToBeReset, this, [this]() { beginResetModel(); });
+      connect(contactModel, &QAbstractItemModel::modelReset, this, [this]() {
+        rebuild();
+        endResetModel();
+      });
+    }
+    rebuild();
+    endResetModel();
+  }
+
+  void ContactFilterProxyModel::setSearchText(const QString &text) {
+    const QString trimmed = text.trimmed();
+    if (trimmed == searchText) return;
+
+    const bool wasEmpty = searchText.isEmpty();
+    searchText = trimmed;
+    foldedSearchText = searchText.toCaseFolded();
+    if (!contactModel) return;
+
+    // Starting or clearing a search swaps the whole list, comparing it row by row would be O(N)
+    if (wasEmpty || searchText.isEmpty()) {
+      beginResetModel();
+      rebuild();
+      endResetModel();
+      return;
+    }
+    applyRows(matchingRows());
+  }
+
+  void ContactFilterProxyModel::setSortMode(SortMode mode) {
+    if (mode == sortMode) return;
+
+    emit layoutAboutToBeChanged({}, QAbstractItemModel::VerticalSortHint);
+    const QModelIndexList oldIndexes = persistentIndexList();
+    QList<int> persistentRows;
+    persistentRows.reserve(oldIndexes.size());
+    for (const auto &oldIndex: oldIndexes) {
+      persistentRows.append(visibleRows.at(oldIndex.row()));
+    }
+
+    sortMode = mode;
+    std::sort(visibleRows.begin(), visibleRows.end(), [this](int left, int right) {
+      return sortsBefore(left, right);
+    });
+
+    QModelIndexList newIndexes;
+    newIndexes.reserve(persistentRows.size());
+    for (int sourceRow: persistentRows) {
+      newIndexes.append(mapFromSource(contactModel->index(sourceRow)));
+    }
+    changePersistentIndexList(oldIndexes, newIndexes);
+    emit layoutChanged({}, QAbstractItemModel::VerticalSortHint);
+  }
+
+  QModelIndex ContactFilterProxyModel::index(int row, int column, const QModelIndex &parent) const {
+    if (parent.isValid() || column != 0 || row < 0 || row >= visibleRows.size()) return {};
+    return createIndex(row, column);
+  }
+
+  QModelIndex ContactFilterProxyModel::parent(const QModelIndex &child) const {
+    Q_UNUSED(child);
+    return {};
+  }
+
+  int ContactFilterProxyModel::rowCount(const QModelIndex &parent) const {
+    return parent.isValid() ? 0 : static_cast<int>(visibleRows.size());
+  }
+
+  int ContactFilterProxyModel::columnCount(const QModelIndex &parent) const {
+    return parent.isValid() ? 0 : 1;
+  }
+
+  QModelIndex ContactFilterProxyModel::mapToSource(const QModelIndex &proxyIndex) const {
+    if (!contactModel || !proxyIndex.isValid() || proxyIndex.row() >= visibleRows.size()) return {};
+    return contactModel->index(visibleRows.at(proxyIndex.row()));
+  }
+
+  QModelIndex ContactFilterProxyModel::mapFromSource(const QModelIndex &sourceIndex) const {
+    if (!sourceIndex.isValid()) return {};
+
+    const int sourceRow = sourceIndex.row();
+    auto it = std::lower_bound(visibleRows.begin(), visibleRows.end(), sourceRow, [this](int left, int right) {
+      return sortsBefore(left, right);
+    });
+    if (it == visibleRows.end() || *it != sourceRow) return {};
+    return createIndex(static_cast<int>(it - visibleRows.begin()), 0);
+  }
+
+  bool ContactFilterProxyModel::accepts(int sourceRow) const {
+    return searchText.isEmpty() || contactModel->sortNameAt(sourceRow).contains(foldedSearchText);
+  }
+
+  bool ContactFilterProxyModel::sortsBefore(int leftRow, int rightRow) const {
+    if (sortMode != SortMode::Normal) {
+      const QString &left = contactModel->sortNameAt(leftRow);
+      const QString &right = contactModel->sortNameAt(rightRow);
+      if (left != right) {
+        return sortMode == SortMode::AToZ ? left < right : right < left;
+      }
+    }
+    // Equal names keep the insertion order, so every row has exactly one place
+    return contactModel->contactIdAt(leftRow) < contactModel->contactIdAt(rightRow);
+  }
+
+  QList<int> ContactFilterProxyModel::matchingRows() const {
+    QList<int> rows;
+    if (!contactModel) return rows;
+
+    if (searchText.isEmpty()) {
+      rows.reserve(contactModel->rowCount());
+      for (int row = 0; row < contactModel->rowCount(); ++row) rows.append(row);
+      // Rows are in insertion order already
+      if (sortMode == SortMode::Normal) return rows;
+    } else {
+      const QSet<int> contactIds = contactModel->matchContacts(searchText);
+      rows.reserve(contactIds.size());
+      for (int contactId: contactIds) {
+        const int row = contactModel->rowOfContactId(contactId);
+        if (row >= 0) rows.append(row);
+      }
+    }
+
+    std::sort(rows.begin(), rows.end(), [this](int left, int right) { return sortsBefore(left, right); });
+    return rows;
+  }
+
+  void ContactFilterProxyModel::applyRows(const QList<int> &rows) {
+    struct Edit {
+      qsizetype position;
+      qsizetype from; // first entry of rows to insert, -1 for a removal
+      qsizetype count;
+    };
+
+    // Both lists are in display order, a merge of the two yields the runs to remove and insert
+    QList<Edit> edits;
+    qsizetype position = 0;
+    qsizetype oldIndex = 0;
+    qsizetype newIndex = 0;
+    while (oldIndex < visibleRows.size() || newIndex < rows.size()) {
+      if (oldIndex < visibleRows.size() && newIndex < rows.size() && visibleRows.at(oldIndex) == rows.at(newIndex)) {
+        ++oldIndex;
+        ++newIndex;
+        ++position;
+      } else if (oldIndex < visibleRows.size() &&
+                 (newIndex == rows.size() || sortsBefore(visibleRows.at(oldIndex), rows.at(newIndex)))) {
+        const qsizetype first = oldIndex;
+        while (oldIndex < visibleRows.size() &&
+               (newIndex == rows.size() || sortsBefore(visibleRows.at(oldIndex), rows.at(newIndex)))) {
+          ++oldIndex;
+        }
+        edits.append({position, -1, oldIndex - first});
+      } else {
+        const qsizetype first = newIndex;
+        while (newIndex < rows.size() &&
+               (oldIndex == visibleRows.size() || sortsBefore(rows.at(newIndex), visibleRows.at(oldIndex)))) {
+          ++newIndex;
+        }
+        edits.append({position, first, newIndex - first});
+        position += newIndex - first;
+      }
+
+      if (edits.size() > maxIncrementalEdits) {
+        beginResetModel();
+        visibleRows = rows;
+        endResetModel();
+        return;
+      }
+    }
+
+    for (const auto &edit: edits) {
+      const int firstRow = static_cast<int>(edit.position);
+      const int lastRow = static_cast<int>(edit.position + edit.count - 1);
+      if (edit.from < 0) {
+        beginRemoveRows(QModelIndex(), firstRow, lastRow);
+        visibleRows.remove(edit.position, edit.count);
+        endRemoveRows();
+      } else {
+        beginInsertRows(QModelIndex(), firstRow, lastRow);
+        visibleRows.insert(edit.position, edit.count, 0);
+        std::copy_n(rows.begin() + edit.from, edit.count, visibleRows.begin() + edit.position);
+        endInsertRows();
+      }
+    }
+  }
+
+  void ContactFilterProxyModel::insertVisible(int sourceRow) {
+    auto it = std::lower_bound(visibleRows.begin(), visibleRows.end(), sourceRow, [this](int left, int right) {
+      return sortsBefore(left, right);
+    });
+    const int position = static_cast<int>(it - visibleRows.begin());
+    beginInsertRows(QModelIndex(), position, position);
+    visibleRows.insert(position, sourceRow);
+    endInsertRows();
+  }
+
+  void ContactFilterProxyModel::removeVisibleAt(int position) {
+    beginRemoveRows(QModelIndex(), position, position);
+    visibleRows.removeAt(position);
+    endRemoveRows();
+  }
+
+  void ContactFilterProxyModel::rebuild() {
+    visibleRows = matchingRows();
+  }
+
+  void ContactFilterProxyModel::onRowsInserted(const QModelIndex &parent, int first, int last) {
+    if (parent.isValid()) return;
+
+    const int count = last - first + 1;
+    for (int &row: visibleRows) {
+      if (row >= first) row += count;
+    }
+    for (int row = first; row <= last; ++row) {
+      if (accepts(row)) insertVisible(row);
+    }
+  }
+
+  void ContactFilterProxyModel::onRowsAboutToBeRemoved(const QModelIndex &parent, int first, int last) {
+    if (parent.isValid()) return;
+
+    for (int row = first; row <= last; ++row) {
+      const QModelIndex proxyIndex = mapFromSource(contactModel->index(row));
+      if (proxyIndex.isValid()) removeVisibleAt(proxyIndex.row());
+    }
+  }
+
+  void ContactFilterProxyModel::onRowsRemoved(const QModelIndex &parent, int first, int last) {
+    if (parent.isValid()) return;
+
+    // The removed rows left visibleRows already, only the ones behind them move up
+    const int count = last - first + 1;
+    for (int &row: visibleRows) {
+      if (row > last) row -= count;
+    }
+  }
+
+  void ContactFilterProxyModel::onDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight,
+                                              const QList<int> &roles) {
+    for (int row = topLeft.row(); row <= bottomRight.row(); ++row) {
+      // A rename changes the sort key, so look the row up by value instead of by its old place
+      const int position = static_cast<int>(visibleRows.indexOf(row));
+      if (position < 0) {
+        if (accepts(row)) insertVisible(row);
+        continue;
+      }
+      if (!accepts(row)) {
+        removeVisibleAt(position);
+        continue;
+      }
+
+      visibleRows.removeAt(position);
+      auto it = std::lower_bound(visibleRows.begin(), visibleRows.end(), row, [this](int left, int right) {
+        return sortsBefore(left, right);
+      });
+      const int target = static_cast<int>(it - visibleRows.begin());
+      visibleRows.insert(position, row);
+
+      if (target != position) {
+        beginMoveRows(QModelIndex(), position, position, QModelIndex(), target > position ? target + 1 : target);
+        visibleRows.move(position, target);
+        endMoveRows();
+      }
+      const QModelIndex changed = index(target, 0);
+      emit dataChanged(changed, changed, roles);
+    }
+  }
+} // Gui
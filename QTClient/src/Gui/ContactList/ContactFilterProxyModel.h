@@ -0,0 +1,64 @@
+//
+// Created by deanprangenberg on 23.07.25.
+//
+
+#ifndef CONTACTFILTERPROXYMODEL_H
+#define CONTACTFILTERPROXYMODEL_H
+
+#include <QAbstractProxyModel>
+#include <QList>
+
+#include "ContactListModel.h"
+
+namespace Gui {
+  // Filters the contact list through the model's search index and applies the selected sort order.
+  // Keeps the visible source rows in display order, a new search only inserts and removes the rows
+  // that differ from the previous result instead of filtering every contact again.
+  class ContactFilterProxyModel : public QAbstractProxyModel {
+    Q_OBJECT
+
+  public:
+    enum class SortMode {
+      Normal,
+      AToZ,
+      ZToA
+    };
+
+    explicit ContactFilterProxyModel(QObject *parent = nullptr);
+
+    void setContactModel(ContactListModel *model);
+    void setSearchText(const QString &text);
+    void setSortMode(SortMode mode);
+
+    QModelIndex index(int row, int column, const QModelIndex &parent = QModelIndex()) const override;
+    QModelIndex parent(const QModelIndex &child) const override;
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+    QModelIndex mapToSource(const QModelIndex &proxyIndex) const override;
+    QModelIndex mapFromSource(const QModelIndex &sourceIndex) const override;
+
+  private:
+    bool accepts(int sourceRow) const;
+    bool sortsBefore(int leftRow, int rightRow) const;
+    // Source rows passing the current search, in display order
+    QList<int> matchingRows() const;
+    // Replaces visibleRows by rows, signalling only the rows that differ
+    void applyRows(const QList<int> &rows);
+    void insertVisible(int sourceRow);
+    void removeVisibleAt(int position);
+    void rebuild();
+
+    void onRowsInserted(const QModelIndex &parent, int first, int last);
+    void onRowsAboutToBeRemoved(const QModelIndex &parent, int first, int last);
+    void onRowsRemoved(const QModelIndex &parent, int first, int last);
+    void onDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight, const QList<int> &roles);
+
+    ContactListModel *contactModel = nullptr;
+    QString searchText;
+    QString foldedSearchText;
+    QList<int> visibleRows;
+    SortMode sortMode = SortMode::Normal;
+  };
+} // Gui
+
+#endif //CONTACTFILTERPROXYMODEL_H
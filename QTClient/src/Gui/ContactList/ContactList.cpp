@@ -4,34 +4,40 @@
 
 #include "ContactList.h"
 
-#include "../GuiHelper/GuiHelper.h"
-
 namespace Gui {
   ContactList::ContactList(QWidget *parent) : QWidget(parent) {
-    containerWidget = new QWidget(this);
-    containerWidget->setObjectName("ContactListWidget");
-    containerWidget->setContentsMargins(0, 0, 0, 0);
-
-    contactsLayout = new QVBoxLayout(containerWidget);
-    contactsLayout->setAlignment(Qt::AlignTop);
-    contactsLayout->setContentsMargins(0, 0, 0, 0);
-    containerWidget->setLayout(contactsLayout);
+    contactModel = new ContactListModel(this);
+    contactProxy = new ContactFilterProxyModel(this);
+    contactProxy->setContactModel(contactModel);
+
+    // Every row has the same height, so the view never has to measure more than one item
+    contactView = new QListView(this);
+    contactView->setObjectName("ContactListView");
+    contactView->setModel(contactProxy);
+    contactView->setUniformItemSizes(true);
+    contactView->setIconSize(QSize(ContactListModel::avatarSize, ContactListModel::avatarSize));
+    contactView->setSelectionMode(QAbstractItemView::SingleSelection);
+    contactView->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    contactView->setVerticalScrollMode(QAbstractItemView::ScrollPerPixel);
+    contactView->setVerticalScrollBarPolicy(Qt::ScrollBarAlwaysOn);
+    contactView->setHorizontalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
 
     contactListSearch = new ContactListSearch(this);
-    contactListSearch->connectSearchAndSortToList(&contactButtonList);
 
-    scrollArea = new QScrollArea(this);
-    scrollArea->setObjectName("ContactListScrollArea");
-    scrollArea->setWidget(containerWidget);
-    scrollArea->setWidgetResizable(true);
-    scrollArea->setVerticalScrollBarPolicy(Qt::ScrollBarAlwaysOn);
-    scrollArea->setHorizontalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
+    connect(contactListSearch, &ContactListSearch::searchTextChanged, contactProxy,
+            &ContactFilterProxyModel::setSearchText);
+    connect(contactListSearch, &ContactListSearch::sortModeChanged, this, [this](int mode) {
+      contactProxy->setSortMode(static_cast<ContactFilterProxyModel::SortMode>(mode));
+    });
+    connect(contactView, &QListView::clicked, this, [this](const QModelIndex &index) {
+      emit contactSelected(index.data(ContactListModel::ChatUUIDRole).toString());
+    });
 
     contactListWidgetLayout = new QVBoxLayout(this);
     contactListWidgetLayout->setContentsMargins(0, 0, 0, 0);
     contactListWidgetLayout->setSpacing(0);
     contactListWidgetLayout->addWidget(contactListSearch);
-    contactListWidgetLayout->addWidget(scrollArea);
+    contactListWidgetLayout->addWidget(contactView);
     setLayout(contactListWidgetLayout);
     setContentsMargins(0, 0, 0, 0);
 
@@ -39,67 +45,44 @@ namespace Gui {
     setSizePolicy(QSizePolicy::Minimum, QSizePolicy::Expanding);
   }
 
-  ContactButton *ContactList::getContactButtonPointer(const QString &uuid) {
-    for (auto *contact: contactButtonList) {
-      if (contact->chatUUID == uuid) {
-        return contact;
-      }
-    }
-    return nullptr;
+  bool ContactList::addContact(const QString &name, const QString &chatUUID, const QPixmap &avatar) {
+    return contactModel->addContact(name, chatUUID, avatar) >= 0;
   }
 
-  void ContactList::addContact(const QString &name, const QString &chatUUID, const QPixmap &avatar) {
-    auto *newContact = new ContactButton(name, chatUUID, avatar, containerWidget);
-    newContact->setObjectName("ContactListContactButton");
-    contactButtonList.push_back(newContact);
-
-    // Clear layout
-    QLayoutItem *item;
-    while ((item = contactsLayout->takeAt(1)) != nullptr) {
-      if (auto *widget = item->widget()) {
-        widget->setParent(nullptr);
-      }
-      delete item;
-    }
+  void ContactList::removeContact(const QString &chatUUID) {
+    contactModel->removeContact(chatUUID);
+  }
 
-    // Add all buttons and find max width
-    int maxWidth = 0;
-    for (auto *contact: contactButtonList) {
-      contact->adjustSize();
-      int width = contact->sizeHint().width() + 40;
-      maxWidth = qMax(maxWidth, width);
-      contactsLayout->addWidget(contact);
-    }
+  void ContactList::removeAllContacts() {
+    contactModel->clear();
+  }
 
-    // Set minimum width for scroll area and container
-    scrollArea->setMinimumWidth(maxWidth + 30);
-    containerWidget->setMinimumWidth(maxWidth);
+  bool ContactList::updateContact(const QString &chatUUID, const QString &name, const QPixmap &avatar) {
+    // The proxy re-checks the renamed row itself
+    return contactModel->updateContact(chatUUID, name, avatar);
+  }
 
-    // Update the layout
-    adjustSize();
-    if (parentWidget()) {
-      parentWidget()->adjustSize();
-    }
+  bool ContactList::hasContact(const QString &chatUUID) const {
+    return contactModel->rowOf(chatUUID) >= 0;
+  }
 
-    updateButtonsIcons();
+  QString ContactList::contactName(const QString &chatUUID) const {
+    return contactModel->nameOf(chatUUID);
   }
 
-  void ContactList::removeContact(const QString &chatUUID) {
-    auto it = std::remove_if(contactButtonList.begin(), contactButtonList.end(),
-                             [&chatUUID](ContactButton *contact) {
-                               return contact->chatUUID == chatUUID;
-                             });
-
-    if (it != contactButtonList.end()) {
-      delete *it;
-      contactButtonList.erase(it);
-      updateButtonsIcons();
-    }
+  QPixmap ContactList::contactAvatar(const QString &chatUUID) const {
+    return contactModel->avatarOf(chatUUID);
   }
 
-  void ContactList::updateButtonsIcons() {
-    for (auto contact: contactButtonList) {
-      GuiHelper::updateContactIcon(contact);
+  void ContactList::setCurrentContact(const QString &chatUUID) {
+    const int row = contactModel->rowOf(chatUUID);
+    if (row < 0) return;
+
+    const QModelIndex proxyIndex = contactProxy->mapFromSource(contactModel->index(row));
+    if (proxyIndex.isValid()) {
+      contactView->setCurrentIndex(proxyIndex);
+    } else {
+      contactView->clearSelection();
     }
   }
 } // Gui
@@ -7,9 +7,10 @@
 
 #include <QWidget>
 #include <QVBoxLayout>
-#include <QScrollArea>
+#include <QListView>
 
-#include "ContactButton.h"
+#include "ContactFilterProxyModel.h"
+#include "ContactListModel.h"
 #include "ContactListSearch.h"
 
 namespace Gui {
@@ -19,17 +20,24 @@ namespace Gui {
   public:
     explicit ContactList(QWidget *parent = nullptr);
 
-    ContactButton* getContactButtonPointer(const QString& uuid);
-    void addContact(const QString &name, const QString &chatUUID, const QPixmap &avatar);
+    bool addContact(const QString &name, const QString &chatUUID, const QPixmap &avatar);
     void removeContact(const QString &chatUUID);
-    QList<ContactButton *> contactButtonList;
+    void removeAllContacts();
+    bool updateContact(const QString &chatUUID, const QString &name, const QPixmap &avatar);
+    bool hasContact(const QString &chatUUID) const;
+    QString contactName(const QString &chatUUID) const;
+    QPixmap contactAvatar(const QString &chatUUID) const;
+    // Highlights the contact without emitting contactSelected
+    void setCurrentContact(const QString &chatUUID);
+
+  signals:
+    void contactSelected(const QString &chatUUID);
 
   private:
-    void updateButtonsIcons();
-    QVBoxLayout *contactsLayout;
     QVBoxLayout *contactListWidgetLayout;
-    QWidget *containerWidget;
-    QScrollArea *scrollArea;
+    QListView *contactView;
+    ContactListModel *contactModel;
+    ContactFilterProxyModel *contactProxy;
     ContactListSearch *contactListSearch;
   };
 } // namespace Gui
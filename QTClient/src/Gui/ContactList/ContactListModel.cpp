@@ -0,0 +1,142 @@
+//
+// Created by deanprangenberg on 23.07.25.
+//
+
+#include "ContactListModel.h"
+
+#include <QSize>
+#include <algorithm>
+
+namespace Gui {
+  ContactListModel::ContactListModel(QObject *parent) : QAbstractListModel(parent) {
+  }
+
+  QPixmap ContactListModel::scaledIcon(const QPixmap &avatar) {
+    if (avatar.isNull()) return {};
+    return avatar.scaled(avatarSize, avatarSize, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+  }
+
+  int ContactListModel::rowCount(const QModelIndex &parent) const {
+    return parent.isValid() ? 0 : static_cast<int>(contacts.size());
+  }
+
+  QVariant ContactListModel::data(const QModelIndex &index, int role) const {
+    if (!index.isValid() || index.row() >= contacts.size()) return {};
+
+    const auto &contact = contacts.at(index.row());
+    switch (role) {
+      case Qt::DisplayRole:
+      case Qt::ToolTipRole:
+        return contact.name;
+      case Qt::DecorationRole:
+        return contact.icon;
+      case Qt::SizeHintRole:
+        return QSize(0, rowHeight);
+      case ChatUUIDRole:
+        return contact.chatUUID;
+      case ContactIdRole:
+        return contact.id;
+      case SortNameRole:
+        return contact.sortName;
+      default:
+        return {};
+    }
+  }
+
+  int ContactListModel::addContact(const QString &name, const QString &chatUUID, const QPixmap &avatar) {
+    if (rowByChatUUID.contains(chatUUID)) return -1;
+
+    const int row = static_cast<int>(contacts.size());
+    const int contactId = nextContactId++;
+
+    searchIndex.add(contactId, name);
+
+    beginInsertRows(QModelIndex(), row, row);
+    contacts.append({contactId, chatUUID, name, name.toCaseFolded(), avatar, scaledIcon(avatar)});
+    rowByChatUUID.insert(chatUUID, row);
+    endInsertRows();
+
+    return contactId;
+  }
+
+  int ContactListModel::removeContact(const QString &chatUUID) {
+    const int row = rowOf(chatUUID);
+    if (row < 0) return -1;
+
+    const int contactId = contacts.at(row).id;
+    searchIndex.remove(contactId);
+
+    beginRemoveRows(QModelIndex(), row, row);
+    contacts.removeAt(row);
+    rowByChatUUID.remove(chatUUID);
+    // Rows behind the removed one moved up, removing a single chat is rare enough for this
+    for (int i = row; i < contacts.size(); ++i) {
+      rowByChatUUID.insert(contacts.at(i).chatUUID, i);
+    }
+    endRemoveRows();
+
+    return contactId;
+  }
+
+  void ContactListModel::clear() {
+    beginResetModel();
+    contacts.clear();
+    rowByChatUUID.clear();
+    searchIndex.clear();
+    endResetModel();
+  }
+
+  bool ContactListModel::updateContact(const QString &chatUUID, const QString &name, const QPixmap &avatar) {
+    const int row = rowOf(chatUUID);
+    if (row < 0) return false;
+
+    auto &contact = contacts[row];
+    searchIndex.add(contact.id, name);
+    contact.name = name;
+    contact.sortName = name.toCaseFolded();
+    contact.avatar = avatar;
+    contact.icon = scaledIcon(avatar);
+
+    const QModelIndex changed = index(row);
+    emit dataChanged(changed, changed);
+    return true;
+  }
+
+  int ContactListModel::rowOf(const QString &chatUUID) const {
+    return rowByChatUUID.value(chatUUID, -1);
+  }
+
+  int ContactListModel::rowOfContactId(int contactId) const {
+    auto it = std::lower_bound(contacts.begin(), contacts.end(), contactId, [](const Contact &contact, int id) {
+      return contact.id < id;
+    });
+    if (it == contacts.end() || it->id != contactId) return -1;
+    return static_cast<int>(it - contacts.begin());
+  }
+
+  int ContactListModel::contactIdAt(int row) const {
+    return contacts.at(row).id;
+  }
+
+  const QString &ContactListModel::sortNameAt(int row) const {
+    return contacts.at(row).sortName;
+  }
+
+  QSet<int> ContactListModel::matchContacts(const QString &query) const {
+    return searchIndex.match(query);
+  }
+
+  QString ContactListModel::chatUUIDAt(int row) const {
+    return contacts.at(row).chatUUID;
+  }
+
+  QString ContactListModel::nameOf(const QString &chatUUID) const {
+    const int row = rowOf(chatUUID);
+    return row < 0 ? QString() : contacts.at(row).name;
+  }
+
+  QPixmap ContactListModel::avatarOf(const QString &chatUUID) const {
+    const int row = rowOf(chatUUID);
+    return row < 0 ? QPixmap() : contacts.at(row).avatar;
+  }
+} // Gui
@@ -0,0 +1,71 @@
+//
+// Created by deanprangenberg on 23.07.25.
+//
+
+#ifndef CONTACTLISTMODEL_H
+#define CONTACTLISTMODEL_H
+
+#include <QAbstractListModel>
+#include <QHash>
+#include <QList>
+#include <QPixmap>
+
+#include "ContactSearchIndex.h"
+
+namespace Gui {
+  class ContactListModel : public QAbstractListModel {
+    Q_OBJECT
+
+  public:
+    enum Roles {
+      ChatUUIDRole = Qt::UserRole + 1,
+      ContactIdRole, // stable id in insertion order, used for the "Normal" sort
+      SortNameRole
+    };
+
+    static constexpr int rowHeight = 50;
+    static constexpr int avatarSize = 34;
+
+    explicit ContactListModel(QObject *parent = nullptr);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role) const override;
+
+    // Returns the new contact id, or -1 if the chat is already listed
+    int addContact(const QString &name, const QString &chatUUID, const QPixmap &avatar);
+    // Returns the id of the removed contact, or -1
+    int removeContact(const QString &chatUUID);
+    // One model reset instead of a row removal per contact
+    void clear();
+    bool updateContact(const QString &chatUUID, const QString &name, const QPixmap &avatar);
+
+    int rowOf(const QString &chatUUID) const;
+    // Rows are in contact id order, so this is a binary search. -1 if the contact is gone
+    int rowOfContactId(int contactId) const;
+    int contactIdAt(int row) const;
+    const QString &sortNameAt(int row) const;
+    QSet<int> matchContacts(const QString &query) const;
+    QString chatUUIDAt(int row) const;
+    QString nameOf(const QString &chatUUID) const;
+    QPixmap avatarOf(const QString &chatUUID) const;
+
+  private:
+    struct Contact {
+      int id;
+      QString chatUUID;
+      QString name;
+      QString sortName;
+      QPixmap avatar;
+      QPixmap icon; // avatar scaled once for painting
+    };
+
+    static QPixmap scaledIcon(const QPixmap &avatar);
+
+    QList<Contact> contacts;
+    QHash<QString, int> rowByChatUUID;
+    ContactSearchIndex searchIndex;
+    int nextContactId = 0;
+  };
+} // Gui
+
+#endif //CONTACTLISTMODEL_H
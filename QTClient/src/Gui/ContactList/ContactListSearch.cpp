@@ -25,6 +25,16 @@ namespace Gui {
     sortInBox->addItem("Normal");
     sortInBox->addItem("A -> Z");
     sortInBox->addItem("Z -> A");
+
+    searchDebounce = new QTimer(this);
+    searchDebounce->setSingleShot(true);
+    searchDebounce->setInterval(searchDebounceMs);
+
+    connect(SearchInField, &QLineEdit::textChanged, searchDebounce, qOverload<>(&QTimer::start));
+    connect(searchDebounce, &QTimer::timeout, this, [this]() {
+      emit searchTextChanged(SearchInField->text());
+    });
+    connect(sortInBox, QOverload<int>::of(&QComboBox::currentIndexChanged), this, &ContactListSearch::sortModeChanged);
   }
 
   ContactListSearch::~ContactListSearch() {
@@ -32,47 +42,4 @@ namespace Gui {
     delete SearchInField;
     delete SearchLayout;
   }
-
-  void ContactListSearch::connectSearchAndSortToList(const QList<ContactButton *> *ContactButtonList) {
-    // Search functionality
-    connect(SearchInField, &QLineEdit::textChanged, this, [ContactButtonList, this]() {
-      QString searchText = SearchInField->text();
-      for (ContactButton *btn: *ContactButtonList) {
-        bool match = btn->nameLabel->text().contains(searchText, Qt::CaseInsensitive);
-        btn->setVisible(match);
-      }
-    });
-
-    // Sort functionality
-    connect(sortInBox, QOverload<int>::of(&QComboBox::currentIndexChanged),
-            this, [ContactButtonList](int index) {
-              QList<ContactButton *> tempList = *ContactButtonList;
-
-              switch (index) {
-                case 1: // A -> Z
-                  std::sort(tempList.begin(), tempList.end(),
-                            [](ContactButton *a, ContactButton *b) {
-                              return a->nameLabel->text() < b->nameLabel->text();
-                            });
-                  break;
-                case 2: // Z -> A
-                  std::sort(tempList.begin(), tempList.end(),
-                            [](ContactButton *a, ContactButton *b) {
-                              return a->nameLabel->text() > b->nameLabel->text();
-                            });
-                  break;
-                default: // Normal
-                  break;
-              }
-
-              if (QLayout *parentLayout = tempList[0]->parentWidget()->layout()) {
-                for (ContactButton *btn: tempList) {
-                  parentLayout->removeWidget(btn);
-                }
-                for (ContactButton *btn: tempList) {
-                  parentLayout->addWidget(btn);
-                }
-              }
-            });
-  }
 } // Gui
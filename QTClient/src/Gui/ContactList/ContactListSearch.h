@@ -11,8 +11,7 @@
 #include <QHBoxLayout>
 #include <QComboBox>
 #include <QCompleter>
-
-#include "ContactButton.h"
+#include <QTimer>
 
 namespace Gui {
 class ContactListSearch : public QWidget {
@@ -21,9 +20,17 @@ Q_OBJECT
 public:
     explicit ContactListSearch(QWidget *parent = nullptr);
     ~ContactListSearch() override;
-    void connectSearchAndSortToList(const QList<ContactButton*>* ContactButtonList);
+
+    static constexpr int searchDebounceMs = 150;
+
+signals:
+    // Emitted once typing pauses for searchDebounceMs
+    void searchTextChanged(const QString &text);
+    // 0 = Normal, 1 = A -> Z, 2 = Z -> A
+    void sortModeChanged(int mode);
 
 private:
+    QTimer *searchDebounce;
     QLineEdit *SearchInField;
     QComboBox *sortInBox;
     QHBoxLayout *SearchLayout;
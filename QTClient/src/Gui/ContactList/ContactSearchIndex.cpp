@@ -0,0 +1,69 @@
+//
+// Created by deanprangenberg on 23.07.25.
+//
+
+#include "ContactSearchIndex.h"
+
+namespace Gui {
+  void ContactSearchIndex::add(int contactId, const QString &name) {
+    remove(contactId);
+
+    const QString folded = name.toCaseFolded();
+    foldedNames.insert(contactId, folded);
+
+    for (int length = 1; length <= maxGramLength; ++length) {
+      for (int pos = 0; pos + length <= folded.size(); ++pos) {
+        postings[folded.mid(pos, length)].insert(contactId);
+      }
+    }
+  }
+
+  void ContactSearchIndex::remove(int contactId) {
+    auto it = foldedNames.find(contactId);
+    if (it == foldedNames.end()) return;
+
+    const QString folded = it.value();
+    foldedNames.erase(it);
+
+    for (int length = 1; length <= maxGramLength; ++length) {
+      for (int pos = 0; pos + length <= folded.size(); ++pos) {
+        auto posting = postings.find(folded.mid(pos, length));
+        if (posting == postings.end()) continue;
+        posting->remove(contactId);
+        if (posting->isEmpty()) {
+          postings.erase(posting);
+        }
+      }
+    }
+  }
+
+  void ContactSearchIndex::clear() {
+    postings.clear();
+    foldedNames.clear();
+  }
+
+  QSet<int> ContactSearchIndex::match(const QString &query) const {
+    const QString folded = query.toCaseFolded();
+    if (folded.size() <= maxGramLength) {
+      return postings.value(folded);
+    }
+
+    // Start from the rarest trigram of the query, every hit must contain all of them
+    const QSet<int> *rarest = nullptr;
+    for (int pos = 0; pos + maxGramLength <= folded.size(); ++pos) {
+      auto posting = postings.constFind(folded.mid(pos, maxGramLength));
+      if (posting == postings.constEnd()) return {};
+      if (!rarest || posting->size() < rarest->size()) {
+        rarest = &posting.value();
+      }
+    }
+
+    QSet<int> result;
+    for (int contactId: *rarest) {
+      if (foldedNames.value(contactId).contains(folded)) {
+        result.insert(contactId);
+      }
+    }
+    return result;
+  }
+} // Gui
@@ -0,0 +1,32 @@
+//
+// Created by deanprangenberg on 23.07.25.
+//
+
+#ifndef CONTACTSEARCHINDEX_H
+#define CONTACTSEARCHINDEX_H
+
+#include <QHash>
+#include <QSet>
+#include <QString>
+
+namespace Gui {
+  // Case insensitive substring search over contact names. Every 1-, 2- and 3-gram of a name
+  // points to the contacts containing it, longer queries only verify the candidates of their
+  // rarest trigram.
+  class ContactSearchIndex {
+  public:
+    void add(int contactId, const QString &name);
+    void remove(int contactId);
+    void clear();
+
+    QSet<int> match(const QString &query) const;
+
+  private:
+    static constexpr int maxGramLength = 3;
+
+    QHash<QString, QSet<int> > postings;
+    QHash<int, QString> foldedNames;
+  };
+} // Gui
+
+#endif //CONTACTSEARCHINDEX_H
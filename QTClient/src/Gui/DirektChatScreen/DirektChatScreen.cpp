@@ -11,7 +11,6 @@ namespace Gui {
     // Clean up maps
     qDeleteAll(chatWindowMap);
     chatWindowMap.clear();
-    ButtonMap.clear();
 
     delete chatScreenLayout;
     delete contactList;
@@ -30,6 +29,7 @@ namespace Gui {
     contactList->setMinimumWidth(250);
     contactList->setMaximumWidth(350);
     contactList->setSizePolicy(QSizePolicy::Minimum, QSizePolicy::Expanding);
+    connect(contactList, &ContactList::contactSelected, this, &DirektChatScreen::showChatbyID);
 
     // Initialize chat window stack
     chatWindowStack = new QStackedWidget(this);
@@ -51,10 +51,7 @@ namespace Gui {
       return;
     }
 
-    // Uncheck all buttons and check the selected one
-    for (auto *button: ButtonMap.values()) {
-      button->setChecked(button->chatUUID == chatUUID);
-    }
+    contactList->setCurrentContact(chatUUID);
 
     chatWindowStack->setCurrentWidget(chatWindow);
   }
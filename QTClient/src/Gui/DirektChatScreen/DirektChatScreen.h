@@ -5,13 +5,14 @@
 #ifndef DIREKTCHATSCREEN_H
 #define DIREKTCHATSCREEN_H
 
+#include <QHash>
 #include <QStackedWidget>
 #include <QWidget>
 #include <QMutexLocker>
 #include "../ChatWindow/ChatWindow.h"
 #include "../ContactList/ContactList.h"
 #include "../../../../Shared/Crypto/IDs/GenerateID.h"
-#include "../../ThreadPool/ThreadPool.h"
+#include "../../../../Shared/ThreadPool/ThreadPool.h"
 #include "../Gui_Structs_Enums.h"
 #include "../../Logic/GuiUpdates/DMChatGuiManager.h"
 
@@ -31,8 +32,7 @@ namespace Gui {
     void initializeLayout();
     void showChatbyID(const QString &chatUUID);
 
-    QMap<QString, ContactButton *> ButtonMap;
-    QMap<QString, ChatWindow *> chatWindowMap;
+    QHash<QString, ChatWindow *> chatWindowMap;
     QHBoxLayout *chatScreenLayout;
     ContactList *contactList;
     QStackedWidget *chatWindowStack;
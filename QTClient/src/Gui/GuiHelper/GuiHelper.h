@@ -7,14 +7,12 @@
 
 #include <QPushButton>
 #include <QIcon>
-
-#include "../ContactList/ContactButton.h"
+#include <QLayout>
 
 namespace Gui {
   class GuiHelper {
   public:
     static void updateButtonIcon(QPushButton *button);
-    static void updateContactIcon(ContactButton *contactButton);
     static void clearLayout(QLayout* layout);
 
   private:
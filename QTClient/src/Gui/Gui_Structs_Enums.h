@@ -5,6 +5,7 @@
 #ifndef STRUCTS_ENUMS_H
 #define STRUCTS_ENUMS_H
 
+#include <QImage>
 #include <QPixmap>
 
 
@@ -16,15 +17,17 @@ namespace Gui {
     QString time;
     QString senderName;
     QString senderUUID;
-    QPixmap avatar;
+    // QImage, messages and chats are handed to the DB writer thread where QPixmap is not allowed
+    QImage avatar;
     bool isFollowUp;
+    qint64 timestamp = 0; // ms since epoch, 0 = derive from time
   };
 
   struct chatData {
     QList<MessageContainer> messageContainerList;
     QString name;
     QString chatUUID;
-    QPixmap avatar;
+    QImage avatar;
   };
 
   struct UserData {
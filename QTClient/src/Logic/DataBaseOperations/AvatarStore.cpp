@@ -0,0 +1,229 @@
+//
+// Created by deanprangenberg on 18.07.25.
+//
+
+#include "AvatarStore.h"
+
+#include <algorithm>
+#include <iostream>
+
+#include "../../../../Shared/Crypto/Hash/HashingEnv.h"
+
+namespace Logic {
+  namespace {
+    const char *insertAvatarSql = "INSERT OR IGNORE INTO avatars (hash, data) VALUES (?, ?);";
+    const char *selectAvatarIdSql = "SELECT avatar_id FROM avatars WHERE hash = ?;";
+    const char *selectAvatarDataSql = "SELECT data FROM avatars WHERE avatar_id = ?;";
+    const char *avatarExistsSql = "SELECT 1 FROM avatars WHERE avatar_id = ?;";
+    const char *deleteUnreferencedSql =
+        "DELETE FROM avatars WHERE avatar_id = ?1 "
+        "AND NOT EXISTS (SELECT 1 FROM messages WHERE sender_avatar_id = ?1);";
+  }
+
+  bool AvatarStore::hashPng(const QByteArray &png, std::vector<uint8_t> &hash) {
+    Crypto::HashingEnv hashing(Crypto::HashAlgorithm::BLAKE2s256);
+    hashing.plainData.assign(png.constData(), png.constData() + png.size());
+    if (!hashing.startHashing()) {
+      std::cerr << "Could not hash avatar" << std::endl;
+      return false;
+    }
+    hash = std::move(hashing.hashValue);
+    return true;
+  }
+
+  int64_t AvatarStore::storePng(sqlite3_stmt *insert, sqlite3_stmt *select, const QByteArray &png) {
+    std::vector<uint8_t> hash;
+    if (png.isEmpty() || !hashPng(png, hash)) return noAvatar;
+
+    sqlite3_reset(insert);
+    sqlite3_bind_blob(insert, 1, hash.data(), static_cast<int>(hash.size()), SQLITE_TRANSIENT);
+    sqlite3_bind_blob(insert, 2, png.constData(), png.size(), SQLITE_TRANSIENT);
+    if (sqlite3_step(insert) != SQLITE_DONE) return noAvatar;
+
+    // INSERT OR IGNORE does not report the id of an existing row
+    sqlite3_reset(select);
+    sqlite3_bind_blob(select, 1, hash.data(), static_cast<int>(hash.size()), SQLITE_TRANSIENT);
+    int64_t avatarId = noAvatar;
+    if (sqlite3_step(select) == SQLITE_ROW) {
+      avatarId = sqlite3_column_int64(select, 0);
+    }
+    sqlite3_reset(select);
+    return avatarId;
+  }
+
+  void AvatarStore::cacheLocked(qint64 cacheKey, int64_t avatarId, const QImage &image) {
+    if (imageById.size() >= maxCachedAvatars) {
+      idByCacheKey.clear();
+      imageById.clear();
+    }
+    idByCacheKey.insert(cacheKey, avatarId);
+    imageById.insert(avatarId, image);
+  }
+
+  int64_t AvatarStore::internAvatar(const DBConnectionPool::Lease &conn, const QImage &avatar, Pending &pending) {
+    if (avatar.isNull()) return noAvatar;
+
+    const qint64 cacheKey = avatar.cacheKey();
+    if (auto it = pending.idByCacheKey.constFind(cacheKey); it != pending.idByCacheKey.constEnd()) {
+      return it.value();
+    }
+
+    int64_t cachedId = noAvatar;
+    {
+      std::lock_guard lock(cacheMutex);
+      cachedId = idByCacheKey.value(cacheKey, noAvatar);
+    }
+    if (cachedId != noAvatar) {
+      // A delete may have removed the row since, inside our transaction the answer holds
+      auto exists = conn.prepare(avatarExistsSql);
+      if (!exists) return noAvatar;
+      sqlite3_bind_int64(exists.get(), 1, cachedId);
+      if (sqlite3_step(exists.get()) == SQLITE_ROW) return cachedId;
+      forget({cachedId});
+    }
+
+    QByteArray png;
+    QBuffer buffer(&png);
+    buffer.open(QIODevice::WriteOnly);
+    avatar.save(&buffer, "PNG");
+    buffer.close();
+
+    auto insert = conn.prepare(insertAvatarSql);
+    auto select = conn.prepare(selectAvatarIdSql);
+    if (!insert || !select) return noAvatar;
+
+    const int64_t avatarId = storePng(insert.get(), select.get(), png);
+    if (avatarId != noAvatar) {
+      pending.idByCacheKey.insert(cacheKey, avatarId);
+      pending.imageById.insert(avatarId, avatar);
+    }
+    return avatarId;
+  }
+
+  void AvatarStore::publish(Pending &pending) {
+    std::lock_guard lock(cacheMutex);
+    for (auto it = pending.idByCacheKey.constBegin(); it != pending.idByCacheKey.constEnd(); ++it) {
+      cacheLocked(it.key(), it.value(), pending.imageById.value(it.value()));
+    }
+    pending.idByCacheKey.clear();
+    pending.imageById.clear();
+  }
+
+  QImage AvatarStore::loadAvatar(const DBConnectionPool::Lease &conn, int64_t avatarId) {
+    if (avatarId == noAvatar) return {};
+
+    {
+      std::lock_guard lock(cacheMutex);
+      if (auto it = imageById.constFind(avatarId); it != imageById.constEnd()) {
+        return it.value();
+      }
+    }
+
+    auto statement = conn.prepare(selectAvatarDataSql);
+    sqlite3_stmt *stmt = statement.get();
+    if (!stmt) return {};
+
+    sqlite3_bind_int64(stmt, 1, avatarId);
+    QImage image;
+    if (sqlite3_step(stmt) == SQLITE_ROW) {
+      const void *blob = sqlite3_column_blob(stmt, 0);
+      int blobSize = sqlite3_column_bytes(stmt, 0);
+      if (blob && blobSize > 0) {
+        image.loadFromData(QByteArray(static_cast<const char *>(blob), blobSize), "PNG");
+      }
+    }
+
+    if (!image.isNull()) {
+      std::lock_guard lock(cacheMutex);
+      cacheLocked(image.cacheKey(), avatarId, image);
+    }
+    return image;
+  }
+
+  bool AvatarStore::deleteUnreferenced(const DBConnectionPool::Lease &conn, const std::vector<int64_t> &candidates) {
+    if (candidates.empty()) return true;
+
+    auto statement = conn.prepare(deleteUnreferencedSql);
+    sqlite3_stmt *stmt = statement.get();
+    if (!stmt) return false;
+
+    for (int64_t avatarId: candidates) {
+      sqlite3_reset(stmt);
+      sqlite3_bind_int64(stmt, 1, avatarId);
+      if (sqlite3_step(stmt) != SQLITE_DONE) return false;
+    }
+    return true;
+  }
+
+  void AvatarStore::forget(const std::vector<int64_t> &avatarIds) {
+    if (avatarIds.empty()) return;
+
+    std::lock_guard lock(cacheMutex);
+    for (int64_t avatarId: avatarIds) {
+      imageById.remove(avatarId);
+    }
+    idByCacheKey.removeIf([&](const QHash<qint64, int64_t>::iterator &it) {
+      return std::find(avatarIds.begin(), avatarIds.end(), it.value()) != avatarIds.end();
+    });
+  }
+
+  bool AvatarStore::backfillMessages(sqlite3 *handle) {
+    std::vector<int64_t> rowIds;
+    sqlite3_stmt *listRows = nullptr;
+    sqlite3_stmt *readAvatar = nullptr;
+    sqlite3_stmt *insert = nullptr;
+    sqlite3_stmt *select = nullptr;
+    sqlite3_stmt *update = nullptr;
+
+    bool success =
+        sqlite3_prepare_v2(handle, "SELECT rowid FROM messages WHERE length(sender_avatar) > 0;", -1, &listRows,
+                           nullptr) == SQLITE_OK &&
+        sqlite3_prepare_v2(handle, "SELECT sender_avatar FROM messages WHERE rowid = ?;", -1, &readAvatar,
+                           nullptr) == SQLITE_OK &&
+        sqlite3_prepare_v2(handle, insertAvatarSql, -1, &insert, nullptr) == SQLITE_OK &&
+        sqlite3_prepare_v2(handle, selectAvatarIdSql, -1, &select, nullptr) == SQLITE_OK &&
+        sqlite3_prepare_v2(handle, "UPDATE messages SET sender_avatar_id = ?, sender_avatar = NULL WHERE rowid = ?;",
+                           -1, &update, nullptr) == SQLITE_OK;
+
+    // Collect the ids first, the rows are rewritten while we go
+    while (success && sqlite3_step(listRows) == SQLITE_ROW) {
+      rowIds.push_back(sqlite3_column_int64(listRows, 0));
+    }
+
+    // Most rows share a few avatars, skip the hashing for blobs already seen
+    QHash<QByteArray, int64_t> idByPng;
+    for (int64_t rowId: rowIds) {
+      if (!success) break;
+
+      sqlite3_reset(readAvatar);
+      sqlite3_bind_int64(readAvatar, 1, rowId);
+      if (sqlite3_step(readAvatar) != SQLITE_ROW) continue;
+
+      QByteArray png(static_cast<const char *>(sqlite3_column_blob(readAvatar, 0)),
+                     sqlite3_column_bytes(readAvatar, 0));
+      sqlite3_reset(readAvatar);
+
+      int64_t avatarId = idByPng.value(png, noAvatar);
+      if (avatarId == noAvatar) {
+        avatarId = storePng(insert, select, png);
+        if (avatarId == noAvatar) {
+          success = false;
+          break;
+        }
+        idByPng.insert(png, avatarId);
+      }
+
+      sqlite3_reset(update);
+      sqlite3_bind_int64(update, 1, avatarId);
+      sqlite3_bind_int64(update, 2, rowId);
+      success = sqlite3_step(update) == SQLITE_DONE;
+    }
+
+    sqlite3_finalize(listRows);
+    sqlite3_finalize(readAvatar);
+    sqlite3_finalize(insert);
+    sqlite3_finalize(select);
+    sqlite3_finalize(update);
+    return success;
+  }
+} // Logic
@@ -0,0 +1,65 @@
+//
+// Created by deanprangenberg on 18.07.25.
+//
+
+#ifndef AVATARSTORE_H
+#define AVATARSTORE_H
+
+#include <QBuffer>
+#include <QByteArray>
+#include <QHash>
+#include <QImage>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include "../../Database/DBConnectionPool.h"
+
+namespace Logic {
+  // Content addressed avatar storage: every distinct PNG is stored once in the avatars table,
+  // keyed by its BLAKE2s-256 hash, and rows only keep the avatar_id.
+  class AvatarStore {
+  public:
+    static constexpr int64_t noAvatar = 0;
+    static constexpr qsizetype maxCachedAvatars = 512;
+
+    // Avatars a transaction interned, they only reach the shared cache once it committed
+    struct Pending {
+      QHash<qint64, int64_t> idByCacheKey;
+      QHash<int64_t, QImage> imageById;
+    };
+
+    // Returns the avatar_id for the image, storing it on first use. Runs on the caller's
+    // connection inside the caller's write transaction, new ids are kept in pending.
+    int64_t internAvatar(const DBConnectionPool::Lease &conn, const QImage &avatar, Pending &pending);
+
+    // Call once the transaction that filled pending committed, dropping pending forgets a rollback
+    void publish(Pending &pending);
+
+    QImage loadAvatar(const DBConnectionPool::Lease &conn, int64_t avatarId);
+
+    // Deletes the candidates no message references any more, inside the transaction that deleted
+    // the messages. Afterwards forget() them once it committed.
+    static bool deleteUnreferenced(const DBConnectionPool::Lease &conn, const std::vector<int64_t> &candidates);
+
+    void forget(const std::vector<int64_t> &avatarIds);
+
+    // Migration helper, moves every messages.sender_avatar BLOB into the avatars table
+    static bool backfillMessages(sqlite3 *handle);
+
+  private:
+    static bool hashPng(const QByteArray &png, std::vector<uint8_t> &hash);
+    static int64_t storePng(sqlite3_stmt *insert, sqlite3_stmt *select, const QByteArray &png);
+    // Caller holds cacheMutex
+    void cacheLocked(qint64 cacheKey, int64_t avatarId, const QImage &image);
+
+    std::mutex cacheMutex;
+    // QImage::cacheKey -> avatar_id, lets repeated images skip the PNG encoding entirely. An id may
+    // outlive its row for a moment after a delete, writers check it before they use it.
+    QHash<qint64, int64_t> idByCacheKey;
+    // Decoded avatars, both maps are cleared once maxCachedAvatars is reached
+    QHash<int64_t, QImage> imageById;
+  };
+} // Logic
+
+#endif //AVATARSTORE_H
@@ -4,7 +4,16 @@
 
 #include "DMChatDBManager.h"
 
+#include <algorithm>
+
 namespace Logic {
+  namespace {
+    const char *chatAvatarIdsSql =
+        "SELECT DISTINCT sender_avatar_id FROM messages WHERE chat_uuid = ?1 AND sender_avatar_id IS NOT NULL;";
+    const char *messageAvatarIdSql =
+        "SELECT sender_avatar_id FROM messages WHERE message_id = ?1 AND sender_avatar_id IS NOT NULL;";
+  }
+
   DMChatDBManager::DMChatDBManager(const fs::path &dbPath, const std::string &password, bool debugMode)
     : LocalDatabase(dbPath, password, debugMode) {
     if (createChatTables()) {
@@ -18,38 +27,84 @@ namespace Logic {
   }
 
   bool DMChatDBManager::createChatTables() {
-    std::string createChatsTable =
-        "CREATE TABLE IF NOT EXISTS chats ("
-        "chat_uuid TEXT PRIMARY KEY,"
-        "name TEXT NOT NULL,"
-        "avatar BLOB"
-        ");";
-
-    std::string createMessagesTable =
-        "CREATE TABLE IF NOT EXISTS messages ("
-        "message_id TEXT PRIMARY KEY,"
-        "chat_uuid TEXT NOT NULL,"
-        "sender_uuid TEXT NOT NULL,"
-        "content TEXT NOT NULL,"
-        "timestamp TEXT NOT NULL,"
-        "sender_name TEXT NOT NULL,"
-        "sender_avatar BLOB,"
-        "is_history INTEGER,"
-        "FOREIGN KEY (chat_uuid) REFERENCES chats(chat_uuid)"
-        ");";
-
-    return execute(createChatsTable) && execute(createMessagesTable);
+    // Never edit a shipped migration, append a new one instead
+    std::vector<SchemaMigration> migrations;
+
+    migrations.push_back({1, "baseline chats and messages tables", [](sqlite3 *handle) {
+      const char *sql =
+          "CREATE TABLE IF NOT EXISTS chats ("
+          "chat_uuid TEXT PRIMARY KEY,"
+          "name TEXT NOT NULL,"
+          "avatar BLOB"
+          ");"
+          "CREATE TABLE IF NOT EXISTS messages ("
+          "message_id TEXT PRIMARY KEY,"
+          "chat_uuid TEXT NOT NULL,"
+          "sender_uuid TEXT NOT NULL,"
+          "content TEXT NOT NULL,"
+          "timestamp TEXT NOT NULL,"
+          "sender_name TEXT NOT NULL,"
+          "sender_avatar BLOB,"
+          "is_history INTEGER,"
+          "FOREIGN KEY (chat_uuid) REFERENCES chats(chat_uuid)"
+          ");";
+      return sqlite3_exec(handle, sql, nullptr, nullptr, nullptr) == SQLITE_OK;
+    }});
+
+    migrations.push_back({2, "epoch millis timestamp with chat and time index", [](sqlite3 *handle) {
+      // timestamp is "dd.MM.yyyy HH:mm" (or "dd.MM.yyyy, HH:mm") in local time,
+      // rows that can't be parsed end up at 0 and sort first.
+      // Pages are ordered by (timestamp_ms, rowid), the rowid SQLite appends to every index entry
+      // has to follow timestamp_ms directly or every page needs a sort
+      const char *sql =
+          "ALTER TABLE messages ADD COLUMN timestamp_ms INTEGER NOT NULL DEFAULT 0;"
+          "UPDATE messages SET timestamp_ms = COALESCE(CAST(strftime('%s', "
+          "substr(timestamp, 7, 4) || '-' || substr(timestamp, 4, 2) || '-' || substr(timestamp, 1, 2) || ' ' || "
+          "substr(timestamp, -5) || ':00', 'utc') AS INTEGER) * 1000, 0);"
+          "DROP INDEX IF EXISTS idx_messages_chat_timestamp;"
+          "CREATE INDEX IF NOT EXISTS idx_messages_chat_time "
+          "ON messages (chat_uuid, timestamp_ms);";
+      return sqlite3_exec(handle, sql, nullptr, nullptr, nullptr) == SQLITE_OK;
+    }});
+
+    migrations.push_back({3, "deduplicated avatar store", [](sqlite3 *handle) {
+      const char *sql =
+          "CREATE TABLE IF NOT EXISTS avatars ("
+          "avatar_id INTEGER PRIMARY KEY,"
+          "hash BLOB NOT NULL UNIQUE,"
+          "data BLOB NOT NULL"
+          ");"
+          "ALTER TABLE messages ADD COLUMN sender_avatar_id INTEGER REFERENCES avatars(avatar_id);"
+          // Deletes look up whether an avatar is still referenced
+          "CREATE INDEX IF NOT EXISTS idx_messages_sender_avatar ON messages (sender_avatar_id);";
+      // sender_avatar stays as an always NULL column, dropping it needs a table rebuild
+      return sqlite3_exec(handle, sql, nullptr, nullptr, nullptr) == SQLITE_OK &&
+             AvatarStore::backfillMessages(handle);
+    }});
+
+    return runMigrations(std::move(migrations));
+  }
+
+  qint64 DMChatDBManager::messageTimestampMs(const Gui::MessageContainer &msg) {
+    if (msg.timestamp != 0) return msg.timestamp;
+
+    QDateTime dateTime = QDateTime::fromString(msg.time, "dd.MM.yyyy HH:mm");
+    if (!dateTime.isValid()) {
+      dateTime = QDateTime::fromString(msg.time, "dd.MM.yyyy, HH:mm");
+    }
+    return dateTime.isValid() ? dateTime.toMSecsSinceEpoch() : 0;
   }
 
-  QList<Gui::chatData> DMChatDBManager::getAllChats() {
+  QList<Gui::chatData> DMChatDBManager::getAllChats(int messagesPerChat) {
     QList<Gui::chatData> chats;
     const char *sqlChatData = "SELECT chat_uuid, name, avatar FROM chats;";
 
-    sqlite3 *handle = nullptr;
-    if (!openConnection(handle)) return chats;
+    auto conn = acquireConnection();
+    if (!conn) return chats;
 
-    sqlite3_stmt *stmt;
-    if (sqlite3_prepare_v2(handle, sqlChatData, -1, &stmt, nullptr) == SQLITE_OK) {
+    auto statement = conn.prepare(sqlChatData);
+    sqlite3_stmt *stmt = statement.get();
+    if (stmt) {
       while (sqlite3_step(stmt) == SQLITE_ROW) {
         Gui::chatData chat;
 
@@ -63,33 +118,43 @@ namespace Logic {
 
         if (blob && blobSize > 0) {
           QByteArray avatarData(static_cast<const char *>(blob), blobSize);
-          QPixmap pixmap;
-          pixmap.loadFromData(avatarData, "PNG");
-          chat.avatar = pixmap;
+          QImage image;
+          image.loadFromData(avatarData, "PNG");
+          chat.avatar = image;
         } else {
-          chat.avatar = QPixmap(); // leerer Fallback
+          chat.avatar = QImage(); // leerer Fallback
         }
 
-        chat.messageContainerList = getChatMessages(chat.chatUUID);
         chats.append(chat);
       }
     }
+    statement = {};
+    conn.release();
 
-    sqlite3_finalize(stmt);
-    closeConnection(handle);
+    for (auto &chat: chats) {
+      chat.messageContainerList = getLatestMessages(chat.chatUUID, messagesPerChat);
+    }
     return chats;
   }
 
+  bool DMChatDBManager::hasChats() {
+    auto conn = acquireConnection();
+    if (!conn) return false;
+
+    auto statement = conn.prepare("SELECT EXISTS (SELECT 1 FROM chats);");
+    sqlite3_stmt *stmt = statement.get();
+    return stmt && sqlite3_step(stmt) == SQLITE_ROW && sqlite3_column_int(stmt, 0) != 0;
+  }
+
   bool DMChatDBManager::insertChat(const Gui::chatData &chat) {
     std::string sql = "INSERT OR REPLACE INTO chats (chat_uuid, name, avatar) VALUES (?, ?, ?);";
 
-    sqlite3 *handle = nullptr;
-    if (!openConnection(handle)) return false;
+    auto conn = acquireConnection();
+    if (!conn) return false;
 
-    sqlite3_stmt *stmt;
-    int rc = sqlite3_prepare_v2(handle, sql.c_str(), -1, &stmt, nullptr);
-    if (rc != SQLITE_OK) {
-      closeConnection(handle);
+    auto statement = conn.prepare(sql);
+    sqlite3_stmt *stmt = statement.get();
+    if (!stmt) {
       return false;
     }
 
@@ -113,31 +178,29 @@ namespace Logic {
       sqlite3_bind_null(stmt, 3);
     }
 
-    rc = sqlite3_step(stmt);
-    sqlite3_finalize(stmt);
-    closeConnection(handle);
-
-    insertMessages(chat.messageContainerList);
+    int rc = sqlite3_step(stmt);
+    statement = {};
+    conn.release();
 
-    return rc == SQLITE_DONE;
+    return rc == SQLITE_DONE && insertMessages(chat.messageContainerList);
   }
 
   bool DMChatDBManager::insertChats(const QList<Gui::chatData> &chats) {
     if (chats.isEmpty()) return true;
 
-    sqlite3 *handle = nullptr;
-    if (!openConnection(handle)) return false;
+    auto conn = acquireConnection();
+    if (!conn) return false;
+    sqlite3 *handle = conn.get();
 
     if (sqlite3_exec(handle, "BEGIN TRANSACTION", nullptr, nullptr, nullptr) != SQLITE_OK) {
-      closeConnection(handle);
       return false;
     }
 
     std::string sql = "INSERT OR REPLACE INTO chats (chat_uuid, name, avatar) VALUES (?, ?, ?);";
-    sqlite3_stmt *stmt;
-    if (sqlite3_prepare_v2(handle, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
+    auto statement = conn.prepare(sql);
+    sqlite3_stmt *stmt = statement.get();
+    if (!stmt) {
       sqlite3_exec(handle, "ROLLBACK", nullptr, nullptr, nullptr);
-      closeConnection(handle);
       return false;
     }
 
@@ -172,17 +235,14 @@ namespace Logic {
       sqlite3_clear_bindings(stmt);
     }
 
-    sqlite3_finalize(stmt);
-
     if (allSuccess) {
       sqlite3_exec(handle, "COMMIT", nullptr, nullptr, nullptr);
     } else {
       sqlite3_exec(handle, "ROLLBACK", nullptr, nullptr, nullptr);
-      closeConnection(handle);
       return false;
     }
-
-    closeConnection(handle);
+    statement = {};
+    conn.release();
 
     for (const auto &chat: chats) {
       if (!insertMessages(chat.messageContainerList)) {
@@ -193,78 +253,158 @@ namespace Logic {
     return true;
   }
 
+  void DMChatDBManager::bindAvatarId(sqlite3_stmt *stmt, int index, int64_t avatarId) {
+    if (avatarId != AvatarStore::noAvatar) {
+      sqlite3_bind_int64(stmt, index, avatarId);
+    } else {
+      sqlite3_bind_null(stmt, index);
+    }
+  }
+
+  bool DMChatDBManager::collectAvatarIds(const DBConnectionPool::Lease &conn, const char *sql, const QString &key,
+                                         std::vector<int64_t> &avatarIds) {
+    auto statement = conn.prepare(sql);
+    sqlite3_stmt *stmt = statement.get();
+    if (!stmt) return false;
+
+    QByteArray keyUtf8 = key.toUtf8();
+    sqlite3_bind_text(stmt, 1, keyUtf8.constData(), keyUtf8.size(), SQLITE_TRANSIENT);
+    int rc;
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+      avatarIds.push_back(sqlite3_column_int64(stmt, 0));
+    }
+    return rc == SQLITE_DONE;
+  }
+
+  Gui::MessageContainer DMChatDBManager::readMessageRow(const DBConnectionPool::Lease &conn, sqlite3_stmt *stmt,
+                                                        const QString &chatUuid) {
+    Gui::MessageContainer msg;
+    msg.chatUUID = chatUuid;
+    msg.messageUUID = QString::fromUtf8(reinterpret_cast<const char *>(sqlite3_column_text(stmt, 0)));
+    msg.senderUUID = QString::fromUtf8(reinterpret_cast<const char *>(sqlite3_column_text(stmt, 1)));
+    msg.message = QString::fromUtf8(reinterpret_cast<const char *>(sqlite3_column_text(stmt, 2)));
+    msg.time = QString::fromUtf8(reinterpret_cast<const char *>(sqlite3_column_text(stmt, 3)));
+    msg.senderName = QString::fromUtf8(reinterpret_cast<const char *>(sqlite3_column_text(stmt, 4)));
+
+    msg.avatar = avatarStore.loadAvatar(conn, sqlite3_column_int64(stmt, 5));
+    msg.isFollowUp = sqlite3_column_int(stmt, 6) != 0;
+    msg.timestamp = sqlite3_column_int64(stmt, 7);
+    return msg;
+  }
+
+  QList<Gui::MessageContainer> DMChatDBManager::queryMessagePage(const std::string &sql, const QString &chatUuid,
+                                                                 const QString &anchorMessageUUID, int limit,
+                                                                 bool newestFirst) {
+    QList<Gui::MessageContainer> messages;
+    if (limit <= 0) return messages;
+
+    auto conn = acquireConnection();
+    if (!conn) return messages;
+
+    auto statement = conn.prepare(sql);
+    sqlite3_stmt *stmt = statement.get();
+    if (!stmt) return messages;
+
+    QByteArray chatUuidUtf8 = chatUuid.toUtf8();
+    QByteArray anchorUtf8 = anchorMessageUUID.toUtf8();
+    sqlite3_bind_text(stmt, 1, chatUuidUtf8.constData(), chatUuidUtf8.length(), SQLITE_TRANSIENT);
+    if (!anchorMessageUUID.isEmpty()) {
+      sqlite3_bind_text(stmt, 2, anchorUtf8.constData(), anchorUtf8.length(), SQLITE_TRANSIENT);
+    }
+    sqlite3_bind_int(stmt, 3, limit);
+
+    messages.reserve(limit);
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+      messages.append(readMessageRow(conn, stmt, chatUuid));
+    }
+
+    // Pages are always handed out oldest first
+    if (newestFirst) {
+      std::reverse(messages.begin(), messages.end());
+    }
+    return messages;
+  }
+
   QList<Gui::MessageContainer> DMChatDBManager::getChatMessages(const QString &chatUuid) {
     QList<Gui::MessageContainer> messages;
     const char *sql =
-        "SELECT message_id, sender_uuid, content, timestamp, sender_name, sender_avatar, is_history "
-        "FROM messages WHERE chat_uuid = ? ORDER BY timestamp ASC;";
+        "SELECT message_id, sender_uuid, content, timestamp, sender_name, sender_avatar_id, is_history, timestamp_ms "
+        "FROM messages WHERE chat_uuid = ? ORDER BY timestamp_ms ASC, rowid ASC;";
 
-    sqlite3 *handle = nullptr;
-    if (!openConnection(handle)) return messages;
+    auto conn = acquireConnection();
+    if (!conn) return messages;
 
-    sqlite3_stmt *stmt;
-    if (sqlite3_prepare_v2(handle, sql, -1, &stmt, nullptr) == SQLITE_OK) {
+    auto statement = conn.prepare(sql);
+    sqlite3_stmt *stmt = statement.get();
+    if (stmt) {
       QByteArray chatUuidUtf8 = chatUuid.toUtf8();
       sqlite3_bind_text(stmt, 1, chatUuidUtf8.constData(), chatUuidUtf8.length(), SQLITE_TRANSIENT);
 
       while (sqlite3_step(stmt) == SQLITE_ROW) {
-        Gui::MessageContainer msg;
-        msg.chatUUID = chatUuid;
-        msg.messageUUID = QString::fromUtf8(reinterpret_cast<const char *>(sqlite3_column_text(stmt, 0)));
-        msg.senderUUID = QString::fromUtf8(reinterpret_cast<const char *>(sqlite3_column_text(stmt, 1)));
-        msg.message = QString::fromUtf8(reinterpret_cast<const char *>(sqlite3_column_text(stmt, 2)));
-        msg.time = QString::fromUtf8(reinterpret_cast<const char *>(sqlite3_column_text(stmt, 3)));
-        msg.senderName = QString::fromUtf8(reinterpret_cast<const char *>(sqlite3_column_text(stmt, 4)));
-
-        const void *blob = sqlite3_column_blob(stmt, 5);
-        int blobSize = sqlite3_column_bytes(stmt, 5);
-        if (blob && blobSize > 0) {
-          QByteArray avatarData(static_cast<const char *>(blob), blobSize);
-          QPixmap pixmap;
-          pixmap.loadFromData(avatarData);
-          msg.avatar = pixmap;
-        }
-
-        msg.isFollowUp = sqlite3_column_int(stmt, 6) != 0;
-        messages.append(msg);
+        messages.append(readMessageRow(conn, stmt, chatUuid));
       }
     }
-
-    sqlite3_finalize(stmt);
-    closeConnection(handle);
     return messages;
   }
 
+  QList<Gui::MessageContainer> DMChatDBManager::getLatestMessages(const QString &chatUuid, int limit) {
+    const std::string sql =
+        "SELECT message_id, sender_uuid, content, timestamp, sender_name, sender_avatar_id, is_history, timestamp_ms "
+        "FROM messages WHERE chat_uuid = ?1 "
+        "ORDER BY timestamp_ms DESC, rowid DESC LIMIT ?3;";
+    return queryMessagePage(sql, chatUuid, {}, limit, true);
+  }
+
+  QList<Gui::MessageContainer> DMChatDBManager::getMessagesBefore(const QString &chatUuid,
+                                                                  const QString &messageUUID, int limit) {
+    const std::string sql =
+        "SELECT message_id, sender_uuid, content, timestamp, sender_name, sender_avatar_id, is_history, timestamp_ms "
+        "FROM messages WHERE chat_uuid = ?1 "
+        "AND (timestamp_ms, rowid) < (SELECT timestamp_ms, rowid FROM messages WHERE message_id = ?2) "
+        "ORDER BY timestamp_ms DESC, rowid DESC LIMIT ?3;";
+    return queryMessagePage(sql, chatUuid, messageUUID, limit, true);
+  }
+
+  QList<Gui::MessageContainer> DMChatDBManager::getMessagesAfter(const QString &chatUuid,
+                                                                 const QString &messageUUID, int limit) {
+    const std::string sql =
+        "SELECT message_id, sender_uuid, content, timestamp, sender_name, sender_avatar_id, is_history, timestamp_ms "
+        "FROM messages WHERE chat_uuid = ?1 "
+        "AND (timestamp_ms, rowid) > (SELECT timestamp_ms, rowid FROM messages WHERE message_id = ?2) "
+        "ORDER BY timestamp_ms ASC, rowid ASC LIMIT ?3;";
+    return queryMessagePage(sql, chatUuid, messageUUID, limit, false);
+  }
+
   bool DMChatDBManager::insertMessages(const QList<Gui::MessageContainer> &messages) {
     if (messages.isEmpty()) return true;
 
-    sqlite3 *handle = nullptr;
-    if (!openConnection(handle)) return false;
+    auto conn = acquireConnection();
+    if (!conn) return false;
+    sqlite3 *handle = conn.get();
 
-    if (sqlite3_exec(handle, "BEGIN TRANSACTION", nullptr, nullptr, nullptr) != SQLITE_OK) {
-      closeConnection(handle);
+    // IMMEDIATE, the avatar ids checked below stay valid until COMMIT
+    if (sqlite3_exec(handle, "BEGIN IMMEDIATE", nullptr, nullptr, nullptr) != SQLITE_OK) {
       return false;
     }
 
+    // Messages already stored are skipped, insertChat re-sends the page the GUI holds and a
+    // single duplicate must not roll back the whole batch. Edits go through updateMessage.
     std::string sql =
-        "INSERT INTO messages "
-        "(message_id, chat_uuid, sender_uuid, content, timestamp, sender_name, sender_avatar, is_history) "
-        "VALUES (?, ?, ?, ?, ?, ?, ?, ?);";
+        "INSERT OR IGNORE INTO messages "
+        "(message_id, chat_uuid, sender_uuid, content, timestamp, sender_name, sender_avatar_id, is_history, "
+        "timestamp_ms) VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?);";
 
-    sqlite3_stmt *stmt;
-    if (sqlite3_prepare_v2(handle, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
+    auto statement = conn.prepare(sql);
+    sqlite3_stmt *stmt = statement.get();
+    if (!stmt) {
       sqlite3_exec(handle, "ROLLBACK", nullptr, nullptr, nullptr);
-      closeConnection(handle);
       return false;
     }
 
     bool success = true;
+    AvatarStore::Pending interned;
     for (const auto &msg: messages) {
-      QByteArray avatarData;
-      QBuffer buffer(&avatarData);
-      buffer.open(QIODevice::WriteOnly);
-      msg.avatar.save(&buffer, "PNG");
-      buffer.close();
+      const int64_t avatarId = avatarStore.internAvatar(conn, msg.avatar, interned);
 
       QByteArray messageIdUtf8 = msg.messageUUID.toUtf8();
       QByteArray chatUuidUtf8 = msg.chatUUID.toUtf8();
@@ -279,8 +419,9 @@ namespace Logic {
       sqlite3_bind_text(stmt, 4, contentUtf8.constData(), contentUtf8.length(), SQLITE_TRANSIENT);
       sqlite3_bind_text(stmt, 5, timestampUtf8.constData(), timestampUtf8.length(), SQLITE_TRANSIENT);
       sqlite3_bind_text(stmt, 6, senderNameUtf8.constData(), senderNameUtf8.length(), SQLITE_TRANSIENT);
-      sqlite3_bind_blob(stmt, 7, avatarData.constData(), avatarData.size(), SQLITE_TRANSIENT);
+      bindAvatarId(stmt, 7, avatarId);
       sqlite3_bind_int(stmt, 8, msg.isFollowUp ? 1 : 0);
+      sqlite3_bind_int64(stmt, 9, messageTimestampMs(msg));
 
       if (sqlite3_step(stmt) != SQLITE_DONE) {
         success = false;
@@ -290,35 +431,38 @@ namespace Logic {
       sqlite3_clear_bindings(stmt);
     }
 
-    sqlite3_finalize(stmt);
-
     if (success) {
-      sqlite3_exec(handle, "COMMIT", nullptr, nullptr, nullptr);
-    } else {
+      success = sqlite3_exec(handle, "COMMIT", nullptr, nullptr, nullptr) == SQLITE_OK;
+    }
+    if (!success) {
       sqlite3_exec(handle, "ROLLBACK", nullptr, nullptr, nullptr);
+      return false;
     }
-
-    closeConnection(handle);
-    return success;
+    avatarStore.publish(interned);
+    return true;
   }
 
   bool DMChatDBManager::insertMessage(const Gui::MessageContainer &msg) {
-    sqlite3 *handle = nullptr;
-    if (!openConnection(handle)) return false;
+    auto conn = acquireConnection();
+    if (!conn) return false;
+    sqlite3 *handle = conn.get();
+
+    // The avatar and the message referencing it are written together
+    if (sqlite3_exec(handle, "BEGIN IMMEDIATE", nullptr, nullptr, nullptr) != SQLITE_OK) {
+      return false;
+    }
 
     std::string sql =
-        "INSERT INTO messages "
-        "(message_id, chat_uuid, sender_uuid, content, timestamp, sender_name, sender_avatar, is_history) "
-        "VALUES (?, ?, ?, ?, ?, ?, ?, ?);";
+        "INSERT OR IGNORE INTO messages "
+        "(message_id, chat_uuid, sender_uuid, content, timestamp, sender_name, sender_avatar_id, is_history, "
+        "timestamp_ms) VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?);";
 
-    sqlite3_stmt *stmt;
+    auto statement = conn.prepare(sql);
+    sqlite3_stmt *stmt = statement.get();
     bool success = false;
-    if (sqlite3_prepare_v2(handle, sql.c_str(), -1, &stmt, nullptr) == SQLITE_OK) {
-      QByteArray avatarData;
-      QBuffer buffer(&avatarData);
-      buffer.open(QIODevice::WriteOnly);
-      msg.avatar.save(&buffer, "PNG");
-      buffer.close();
+    AvatarStore::Pending interned;
+    if (stmt) {
+      const int64_t avatarId = avatarStore.internAvatar(conn, msg.avatar, interned);
 
       QByteArray messageIdUtf8 = msg.messageUUID.toUtf8();
       QByteArray chatUuidUtf8 = msg.chatUUID.toUtf8();
@@ -333,192 +477,213 @@ namespace Logic {
       sqlite3_bind_text(stmt, 4, contentUtf8.constData(), contentUtf8.length(), SQLITE_TRANSIENT);
       sqlite3_bind_text(stmt, 5, timestampUtf8.constData(), timestampUtf8.length(), SQLITE_TRANSIENT);
       sqlite3_bind_text(stmt, 6, senderNameUtf8.constData(), senderNameUtf8.length(), SQLITE_TRANSIENT);
-      sqlite3_bind_blob(stmt, 7, avatarData.constData(), avatarData.size(), SQLITE_TRANSIENT);
+      bindAvatarId(stmt, 7, avatarId);
       sqlite3_bind_int(stmt, 8, msg.isFollowUp ? 1 : 0);
+      sqlite3_bind_int64(stmt, 9, messageTimestampMs(msg));
 
       success = (sqlite3_step(stmt) == SQLITE_DONE);
     }
 
-    sqlite3_finalize(stmt);
-    closeConnection(handle);
-    return success;
+    if (success) {
+      success = sqlite3_exec(handle, "COMMIT", nullptr, nullptr, nullptr) == SQLITE_OK;
+    }
+    if (!success) {
+      sqlite3_exec(handle, "ROLLBACK", nullptr, nullptr, nullptr);
+      return false;
+    }
+    avatarStore.publish(interned);
+    return true;
   }
 
   bool DMChatDBManager::deleteChat(const QString &chatUUID) {
-    sqlite3 *handle = nullptr;
-    if (!openConnection(handle)) return false;
+    auto conn = acquireConnection();
+    if (!conn) return false;
+    sqlite3 *handle = conn.get();
 
-    if (sqlite3_exec(handle, "BEGIN TRANSACTION;", nullptr, nullptr, nullptr) != SQLITE_OK) {
-      closeConnection(handle);
+    if (sqlite3_exec(handle, "BEGIN IMMEDIATE;", nullptr, nullptr, nullptr) != SQLITE_OK) {
       return false;
     }
 
     const char *sqlDeleteMessages = "DELETE FROM messages WHERE chat_uuid = ?;";
-    sqlite3_stmt *stmt;
-    if (sqlite3_prepare_v2(handle, sqlDeleteMessages, -1, &stmt, nullptr) != SQLITE_OK) {
+    const char *sqlDeleteChat = "DELETE FROM chats WHERE chat_uuid = ?;";
+    auto statementMessages = conn.prepare(sqlDeleteMessages);
+    auto statementChats = conn.prepare(sqlDeleteChat);
+    if (!statementMessages || !statementChats) {
       sqlite3_exec(handle, "ROLLBACK;", nullptr, nullptr, nullptr);
-      closeConnection(handle);
       return false;
     }
-    sqlite3_bind_text(stmt, 1, chatUUID.toUtf8().constData(), -1, SQLITE_TRANSIENT);
-    if (sqlite3_step(stmt) != SQLITE_DONE) {
-      sqlite3_finalize(stmt);
+
+    std::vector<int64_t> avatarIds;
+    if (!collectAvatarIds(conn, chatAvatarIdsSql, chatUUID, avatarIds)) {
       sqlite3_exec(handle, "ROLLBACK;", nullptr, nullptr, nullptr);
-      closeConnection(handle);
       return false;
     }
-    sqlite3_finalize(stmt);
 
-    const char *sqlDeleteChat = "DELETE FROM chats WHERE chat_uuid = ?;";
-    if (sqlite3_prepare_v2(handle, sqlDeleteChat, -1, &stmt, nullptr) != SQLITE_OK) {
+    QByteArray chatUuidUtf8 = chatUUID.toUtf8();
+    sqlite3_bind_text(statementMessages.get(), 1, chatUuidUtf8.constData(), chatUuidUtf8.size(), SQLITE_TRANSIENT);
+    if (sqlite3_step(statementMessages.get()) != SQLITE_DONE) {
       sqlite3_exec(handle, "ROLLBACK;", nullptr, nullptr, nullptr);
-      closeConnection(handle);
       return false;
     }
-    sqlite3_bind_text(stmt, 1, chatUUID.toUtf8().constData(), -1, SQLITE_TRANSIENT);
-    if (sqlite3_step(stmt) != SQLITE_DONE) {
-      sqlite3_finalize(stmt);
+
+    sqlite3_bind_text(statementChats.get(), 1, chatUuidUtf8.constData(), chatUuidUtf8.size(), SQLITE_TRANSIENT);
+    if (sqlite3_step(statementChats.get()) != SQLITE_DONE ||
+        !AvatarStore::deleteUnreferenced(conn, avatarIds)) {
       sqlite3_exec(handle, "ROLLBACK;", nullptr, nullptr, nullptr);
-      closeConnection(handle);
       return false;
     }
-    sqlite3_finalize(stmt);
 
     if (sqlite3_exec(handle, "COMMIT;", nullptr, nullptr, nullptr) != SQLITE_OK) {
       sqlite3_exec(handle, "ROLLBACK;", nullptr, nullptr, nullptr);
-      closeConnection(handle);
       return false;
     }
-
-    closeConnection(handle);
+    avatarStore.forget(avatarIds);
     return true;
   }
 
   bool DMChatDBManager::deleteChats(const QList<QString> &chatUUIDs) {
-    sqlite3 *handle = nullptr;
-    if (!openConnection(handle)) return false;
+    auto conn = acquireConnection();
+    if (!conn) return false;
+    sqlite3 *handle = conn.get();
 
-    if (sqlite3_exec(handle, "BEGIN TRANSACTION;", nullptr, nullptr, nullptr) != SQLITE_OK) {
-      closeConnection(handle);
+    if (sqlite3_exec(handle, "BEGIN IMMEDIATE;", nullptr, nullptr, nullptr) != SQLITE_OK) {
       return false;
     }
 
     const char *sqlDeleteMessages = "DELETE FROM messages WHERE chat_uuid = ?;";
     const char *sqlDeleteChat = "DELETE FROM chats WHERE chat_uuid = ?;";
-    sqlite3_stmt *stmtMessages;
-    sqlite3_stmt *stmtChats;
+    auto statementMessages = conn.prepare(sqlDeleteMessages);
+    auto statementChats = conn.prepare(sqlDeleteChat);
+    sqlite3_stmt *stmtMessages = statementMessages.get();
+    sqlite3_stmt *stmtChats = statementChats.get();
 
-    if (sqlite3_prepare_v2(handle, sqlDeleteMessages, -1, &stmtMessages, nullptr) != SQLITE_OK ||
-        sqlite3_prepare_v2(handle, sqlDeleteChat, -1, &stmtChats, nullptr) != SQLITE_OK) {
-      if (stmtMessages) sqlite3_finalize(stmtMessages);
-      if (stmtChats) sqlite3_finalize(stmtChats);
+    if (!stmtMessages || !stmtChats) {
       sqlite3_exec(handle, "ROLLBACK;", nullptr, nullptr, nullptr);
-      closeConnection(handle);
       return false;
     }
 
+    std::vector<int64_t> avatarIds;
     for (const auto &chatUUID: chatUUIDs) {
+      if (!collectAvatarIds(conn, chatAvatarIdsSql, chatUUID, avatarIds)) {
+        sqlite3_exec(handle, "ROLLBACK;", nullptr, nullptr, nullptr);
+        return false;
+      }
       sqlite3_reset(stmtMessages);
       sqlite3_bind_text(stmtMessages, 1, chatUUID.toUtf8().constData(), -1, SQLITE_TRANSIENT);
       if (sqlite3_step(stmtMessages) != SQLITE_DONE) {
-        sqlite3_finalize(stmtMessages);
-        sqlite3_finalize(stmtChats);
         sqlite3_exec(handle, "ROLLBACK;", nullptr, nullptr, nullptr);
-        closeConnection(handle);
         return false;
       }
       sqlite3_reset(stmtChats);
       sqlite3_bind_text(stmtChats, 1, chatUUID.toUtf8().constData(), -1, SQLITE_TRANSIENT);
       if (sqlite3_step(stmtChats) != SQLITE_DONE) {
-        sqlite3_finalize(stmtMessages);
-        sqlite3_finalize(stmtChats);
         sqlite3_exec(handle, "ROLLBACK;", nullptr, nullptr, nullptr);
-        closeConnection(handle);
         return false;
       }
     }
 
-    sqlite3_finalize(stmtMessages);
-    sqlite3_finalize(stmtChats);
+    if (!AvatarStore::deleteUnreferenced(conn, avatarIds)) {
+      sqlite3_exec(handle, "ROLLBACK;", nullptr, nullptr, nullptr);
+      return false;
+    }
 
     if (sqlite3_exec(handle, "COMMIT;", nullptr, nullptr, nullptr) != SQLITE_OK) {
       sqlite3_exec(handle, "ROLLBACK;", nullptr, nullptr, nullptr);
-      closeConnection(handle);
       return false;
     }
-
-    closeConnection(handle);
+    avatarStore.forget(avatarIds);
     return true;
   }
 
   bool DMChatDBManager::deleteMessage(const QString &messageUUID) {
-    sqlite3 *handle = nullptr;
-    if (!openConnection(handle)) return false;
+    auto conn = acquireConnection();
+    if (!conn) return false;
+    sqlite3 *handle = conn.get();
+
+    if (sqlite3_exec(handle, "BEGIN IMMEDIATE;", nullptr, nullptr, nullptr) != SQLITE_OK) {
+      return false;
+    }
 
     const char *sql = "DELETE FROM messages WHERE message_id = ?;";
-    sqlite3_stmt *stmt;
-    if (sqlite3_prepare_v2(handle, sql, -1, &stmt, nullptr) != SQLITE_OK) {
-      closeConnection(handle);
+    auto statement = conn.prepare(sql);
+    sqlite3_stmt *stmt = statement.get();
+    std::vector<int64_t> avatarIds;
+    if (!stmt || !collectAvatarIds(conn, messageAvatarIdSql, messageUUID, avatarIds)) {
+      sqlite3_exec(handle, "ROLLBACK;", nullptr, nullptr, nullptr);
       return false;
     }
 
     sqlite3_bind_text(stmt, 1, messageUUID.toUtf8().constData(), -1, SQLITE_TRANSIENT);
+    if (sqlite3_step(stmt) != SQLITE_DONE || !AvatarStore::deleteUnreferenced(conn, avatarIds)) {
+      sqlite3_exec(handle, "ROLLBACK;", nullptr, nullptr, nullptr);
+      return false;
+    }
 
-    bool success = (sqlite3_step(stmt) == SQLITE_DONE);
-    sqlite3_finalize(stmt);
-    closeConnection(handle);
-    return success;
+    if (sqlite3_exec(handle, "COMMIT;", nullptr, nullptr, nullptr) != SQLITE_OK) {
+      sqlite3_exec(handle, "ROLLBACK;", nullptr, nullptr, nullptr);
+      return false;
+    }
+    avatarStore.forget(avatarIds);
+    return true;
   }
 
   bool DMChatDBManager::deleteMessages(const QList<QString> &messageUUIDs) {
-    sqlite3 *handle = nullptr;
-    if (!openConnection(handle)) return false;
+    auto conn = acquireConnection();
+    if (!conn) return false;
+    sqlite3 *handle = conn.get();
 
-    if (sqlite3_exec(handle, "BEGIN TRANSACTION;", nullptr, nullptr, nullptr) != SQLITE_OK) {
-      closeConnection(handle);
+    if (sqlite3_exec(handle, "BEGIN IMMEDIATE;", nullptr, nullptr, nullptr) != SQLITE_OK) {
       return false;
     }
 
+    const char *sql = "DELETE FROM messages WHERE message_id = ?;";
+    auto statement = conn.prepare(sql);
+    sqlite3_stmt *stmt = statement.get();
+    if (!stmt) {
+      sqlite3_exec(handle, "ROLLBACK;", nullptr, nullptr, nullptr);
+      return false;
+    }
+
+    std::vector<int64_t> avatarIds;
     for (const auto &messageUUID: messageUUIDs) {
-      const char *sql = "DELETE FROM messages WHERE message_id = ?;";
-      sqlite3_stmt *stmt;
-      if (sqlite3_prepare_v2(handle, sql, -1, &stmt, nullptr) != SQLITE_OK) {
+      if (!collectAvatarIds(conn, messageAvatarIdSql, messageUUID, avatarIds)) {
         sqlite3_exec(handle, "ROLLBACK;", nullptr, nullptr, nullptr);
-        closeConnection(handle);
         return false;
       }
-
+      sqlite3_reset(stmt);
       sqlite3_bind_text(stmt, 1, messageUUID.toUtf8().constData(), -1, SQLITE_TRANSIENT);
 
       if (sqlite3_step(stmt) != SQLITE_DONE) {
-        sqlite3_finalize(stmt);
         sqlite3_exec(handle, "ROLLBACK;", nullptr, nullptr, nullptr);
-        closeConnection(handle);
         return false;
       }
+    }
 
-      sqlite3_finalize(stmt);
+    // Ids shared by several deleted messages are checked once
+    std::sort(avatarIds.begin(), avatarIds.end());
+    avatarIds.erase(std::unique(avatarIds.begin(), avatarIds.end()), avatarIds.end());
+    if (!AvatarStore::deleteUnreferenced(conn, avatarIds)) {
+      sqlite3_exec(handle, "ROLLBACK;", nullptr, nullptr, nullptr);
+      return false;
     }
 
     if (sqlite3_exec(handle, "COMMIT;", nullptr, nullptr, nullptr) != SQLITE_OK) {
       sqlite3_exec(handle, "ROLLBACK;", nullptr, nullptr, nullptr);
-      closeConnection(handle);
       return false;
     }
-
-    closeConnection(handle);
+    avatarStore.forget(avatarIds);
     return true;
   }
 
   bool DMChatDBManager::updateChat(const Gui::chatData &chat) {
     std::string sql = "UPDATE chats SET name = ?, avatar = ? WHERE chat_uuid = ?;";
 
-    sqlite3 *handle = nullptr;
-    if (!openConnection(handle)) return false;
+    auto conn = acquireConnection();
+    if (!conn) return false;
 
-    sqlite3_stmt *stmt;
-    if (sqlite3_prepare_v2(handle, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
-      closeConnection(handle);
+    auto statement = conn.prepare(sql);
+    sqlite3_stmt *stmt = statement.get();
+    if (!stmt) {
       return false;
     }
 
@@ -543,25 +708,23 @@ namespace Logic {
 
     bool success = (sqlite3_step(stmt) == SQLITE_DONE);
 
-    sqlite3_finalize(stmt);
-    closeConnection(handle);
-
     return success;
   }
 
   bool DMChatDBManager::updateChats(const QList<Gui::chatData> &chats) {
-    sqlite3 *handle = nullptr;
-    if (!openConnection(handle)) return false;
+    auto conn = acquireConnection();
+    if (!conn) return false;
+    sqlite3 *handle = conn.get();
 
     if (sqlite3_exec(handle, "BEGIN TRANSACTION;", nullptr, nullptr, nullptr) != SQLITE_OK) {
-      closeConnection(handle);
       return false;
     }
 
     const char *sql = "UPDATE chats SET name = ?, avatar = ? WHERE chat_uuid = ?;";
-    sqlite3_stmt *stmt;
-    if (sqlite3_prepare_v2(handle, sql, -1, &stmt, nullptr) != SQLITE_OK) {
-      closeConnection(handle);
+    auto statement = conn.prepare(sql);
+    sqlite3_stmt *stmt = statement.get();
+    if (!stmt) {
+      sqlite3_exec(handle, "ROLLBACK;", nullptr, nullptr, nullptr);
       return false;
     }
 
@@ -588,21 +751,14 @@ namespace Logic {
       sqlite3_bind_text(stmt, 3, chatUuidUtf8.constData(), chatUuidUtf8.size(), SQLITE_TRANSIENT);
 
       if (sqlite3_step(stmt) != SQLITE_DONE) {
-        sqlite3_finalize(stmt);
         sqlite3_exec(handle, "ROLLBACK;", nullptr, nullptr, nullptr);
-        closeConnection(handle);
         return false;
       }
     }
-
-    sqlite3_finalize(stmt);
     if (sqlite3_exec(handle, "COMMIT;", nullptr, nullptr, nullptr) != SQLITE_OK) {
       sqlite3_exec(handle, "ROLLBACK;", nullptr, nullptr, nullptr);
-      closeConnection(handle);
       return false;
     }
-
-    closeConnection(handle);
     return true;
   }
 
@@ -610,15 +766,22 @@ namespace Logic {
     std::string sql =
         "UPDATE messages SET "
         "chat_uuid = ?, sender_uuid = ?, content = ?, timestamp = ?, "
-        "sender_name = ?, sender_avatar = ?, is_history = ? "
-        "WHERE message_id = ?;";
+        "sender_name = ?, sender_avatar_id = ?, is_history = ?7, timestamp_ms = ?9 "
+        "WHERE message_id = ?8;";
 
-    sqlite3 *handle = nullptr;
-    if (!openConnection(handle)) return false;
+    auto conn = acquireConnection();
+    if (!conn) return false;
+    sqlite3 *handle = conn.get();
 
-    sqlite3_stmt *stmt;
-    if (sqlite3_prepare_v2(handle, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
-      closeConnection(handle);
+    // The avatar and the message referencing it are written together
+    if (sqlite3_exec(handle, "BEGIN IMMEDIATE;", nullptr, nullptr, nullptr) != SQLITE_OK) {
+      return false;
+    }
+
+    auto statement = conn.prepare(sql);
+    sqlite3_stmt *stmt = statement.get();
+    if (!stmt) {
+      sqlite3_exec(handle, "ROLLBACK;", nullptr, nullptr, nullptr);
       return false;
     }
 
@@ -629,55 +792,53 @@ namespace Logic {
     QByteArray senderNameUtf8 = msg.senderName.toUtf8();
     QByteArray messageIdUtf8 = msg.messageUUID.toUtf8();
 
-    QByteArray avatarData;
-    if (!msg.avatar.isNull()) {
-      QBuffer buffer(&avatarData);
-      buffer.open(QIODevice::WriteOnly);
-      msg.avatar.save(&buffer, "PNG");
-      buffer.close();
-    }
+    AvatarStore::Pending interned;
+    const int64_t avatarId = avatarStore.internAvatar(conn, msg.avatar, interned);
 
     sqlite3_bind_text(stmt, 1, chatUuidUtf8.constData(), chatUuidUtf8.size(), SQLITE_TRANSIENT);
     sqlite3_bind_text(stmt, 2, senderUuidUtf8.constData(), senderUuidUtf8.size(), SQLITE_TRANSIENT);
     sqlite3_bind_text(stmt, 3, contentUtf8.constData(), contentUtf8.size(), SQLITE_TRANSIENT);
     sqlite3_bind_text(stmt, 4, timestampUtf8.constData(), timestampUtf8.size(), SQLITE_TRANSIENT);
     sqlite3_bind_text(stmt, 5, senderNameUtf8.constData(), senderNameUtf8.size(), SQLITE_TRANSIENT);
-    if (!avatarData.isEmpty()) {
-      sqlite3_bind_blob(stmt, 6, avatarData.constData(), avatarData.size(), SQLITE_TRANSIENT);
-    } else {
-      sqlite3_bind_null(stmt, 6);
-    }
+    bindAvatarId(stmt, 6, avatarId);
     sqlite3_bind_int(stmt, 7, msg.isFollowUp ? 1 : 0);
     sqlite3_bind_text(stmt, 8, messageIdUtf8.constData(), messageIdUtf8.size(), SQLITE_TRANSIENT);
+    sqlite3_bind_int64(stmt, 9, messageTimestampMs(msg));
 
     bool success = (sqlite3_step(stmt) == SQLITE_DONE);
-
-    sqlite3_finalize(stmt);
-    closeConnection(handle);
-
-    return success;
+    if (success) {
+      success = sqlite3_exec(handle, "COMMIT;", nullptr, nullptr, nullptr) == SQLITE_OK;
+    }
+    if (!success) {
+      sqlite3_exec(handle, "ROLLBACK;", nullptr, nullptr, nullptr);
+      return false;
+    }
+    avatarStore.publish(interned);
+    return true;
   }
 
   bool DMChatDBManager::updateMessages(const QList<Gui::MessageContainer> &messages) {
-    sqlite3 *handle = nullptr;
-    if (!openConnection(handle)) return false;
+    auto conn = acquireConnection();
+    if (!conn) return false;
+    sqlite3 *handle = conn.get();
 
-    if (sqlite3_exec(handle, "BEGIN TRANSACTION;", nullptr, nullptr, nullptr) != SQLITE_OK) {
-      closeConnection(handle);
+    if (sqlite3_exec(handle, "BEGIN IMMEDIATE;", nullptr, nullptr, nullptr) != SQLITE_OK) {
       return false;
     }
 
     const char *sql =
         "UPDATE messages SET "
         "chat_uuid = ?, sender_uuid = ?, content = ?, timestamp = ?, "
-        "sender_name = ?, sender_avatar = ?, is_history = ? "
-        "WHERE message_id = ?;";
-    sqlite3_stmt *stmt;
-    if (sqlite3_prepare_v2(handle, sql, -1, &stmt, nullptr) != SQLITE_OK) {
-      closeConnection(handle);
+        "sender_name = ?, sender_avatar_id = ?, is_history = ?7, timestamp_ms = ?9 "
+        "WHERE message_id = ?8;";
+    auto statement = conn.prepare(sql);
+    sqlite3_stmt *stmt = statement.get();
+    if (!stmt) {
+      sqlite3_exec(handle, "ROLLBACK;", nullptr, nullptr, nullptr);
       return false;
     }
 
+    AvatarStore::Pending interned;
     for (const auto &msg: messages) {
       sqlite3_reset(stmt);
 
@@ -688,13 +849,7 @@ namespace Logic {
       QByteArray senderNameUtf8 = msg.senderName.toUtf8();
       QByteArray messageIdUtf8 = msg.messageUUID.toUtf8();
 
-      QByteArray avatarData;
-      if (!msg.avatar.isNull()) {
-        QBuffer buffer(&avatarData);
-        buffer.open(QIODevice::WriteOnly);
-        msg.avatar.save(&buffer, "PNG");
-        buffer.close();
-      }
+      const int64_t avatarId = avatarStore.internAvatar(conn, msg.avatar, interned);
 
       sqlite3_bind_text(stmt, 1, chatUuidUtf8.constData(), chatUuidUtf8.size(), SQLITE_TRANSIENT);
       sqlite3_bind_text(stmt, 2, senderUuidUtf8.constData(), senderUuidUtf8.size(), SQLITE_TRANSIENT);
@@ -702,31 +857,22 @@ namespace Logic {
       sqlite3_bind_text(stmt, 4, timestampUtf8.constData(), timestampUtf8.size(), SQLITE_TRANSIENT);
       sqlite3_bind_text(stmt, 5, senderNameUtf8.constData(), senderNameUtf8.size(), SQLITE_TRANSIENT);
 
-      if (!avatarData.isEmpty()) {
-        sqlite3_bind_blob(stmt, 6, avatarData.constData(), avatarData.size(), SQLITE_TRANSIENT);
-      } else {
-        sqlite3_bind_null(stmt, 6);
-      }
+      bindAvatarId(stmt, 6, avatarId);
 
       sqlite3_bind_int(stmt, 7, msg.isFollowUp ? 1 : 0);
       sqlite3_bind_text(stmt, 8, messageIdUtf8.constData(), messageIdUtf8.size(), SQLITE_TRANSIENT);
+      sqlite3_bind_int64(stmt, 9, messageTimestampMs(msg));
 
       if (sqlite3_step(stmt) != SQLITE_DONE) {
-        sqlite3_finalize(stmt);
         sqlite3_exec(handle, "ROLLBACK;", nullptr, nullptr, nullptr);
-        closeConnection(handle);
         return false;
       }
     }
-
-    sqlite3_finalize(stmt);
     if (sqlite3_exec(handle, "COMMIT;", nullptr, nullptr, nullptr) != SQLITE_OK) {
       sqlite3_exec(handle, "ROLLBACK;", nullptr, nullptr, nullptr);
-      closeConnection(handle);
       return false;
     }
-
-    closeConnection(handle);
+    avatarStore.publish(interned);
     return true;
   }
 } // Logic
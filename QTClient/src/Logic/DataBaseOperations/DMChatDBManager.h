@@ -8,8 +8,10 @@
 #include <qiodevice.h>
 #include <QString>
 #include <QBuffer>
+#include <QDateTime>
 #include "../../Gui/Gui_Structs_Enums.h"
 #include "../../Database/LocalDatabase.h"
+#include "AvatarStore.h"
 
 namespace Logic {
   class DMChatManager;
@@ -18,12 +20,26 @@ namespace Logic {
     friend class DMChatManager;
   public:
     DMChatDBManager(const fs::path &dbPath, const std::string &password, bool debugMode);
+
+    static constexpr int defaultPageSize = 50;
+
   private:
 
-    QList<Gui::chatData> getAllChats();
+    // Chats with only their latest messagesPerChat messages loaded
+    QList<Gui::chatData> getAllChats(int messagesPerChat = defaultPageSize);
+
+    bool hasChats();
 
+    // Full history, prefer the paged getters below
     QList<Gui::MessageContainer> getChatMessages(const QString &chatUuid);
 
+    // Keyset pages, every page is returned oldest message first
+    QList<Gui::MessageContainer> getLatestMessages(const QString &chatUuid, int limit);
+
+    QList<Gui::MessageContainer> getMessagesBefore(const QString &chatUuid, const QString &messageUUID, int limit);
+
+    QList<Gui::MessageContainer> getMessagesAfter(const QString &chatUuid, const QString &messageUUID, int limit);
+
     bool insertChat(const Gui::chatData &chat);
 
     bool insertChats(const QList<Gui::chatData> &chats);
@@ -50,6 +66,23 @@ namespace Logic {
 
 
     bool createChatTables();
+
+    QList<Gui::MessageContainer> queryMessagePage(const std::string &sql, const QString &chatUuid,
+                                                  const QString &anchorMessageUUID, int limit, bool newestFirst);
+
+    // Falls back to parsing msg.time for containers built before the timestamp field existed
+    static qint64 messageTimestampMs(const Gui::MessageContainer &msg);
+
+    static void bindAvatarId(sqlite3_stmt *stmt, int index, int64_t avatarId);
+
+    // Appends the avatar ids of the rows selected by sql with key bound to ?1, before they are deleted
+    static bool collectAvatarIds(const DBConnectionPool::Lease &conn, const char *sql, const QString &key,
+                                 std::vector<int64_t> &avatarIds);
+
+    Gui::MessageContainer readMessageRow(const DBConnectionPool::Lease &conn, sqlite3_stmt *stmt,
+                                         const QString &chatUuid);
+
+    AvatarStore avatarStore;
   };
 } // Logic
 
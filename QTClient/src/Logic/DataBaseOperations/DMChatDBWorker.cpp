@@ -0,0 +1,88 @@
+//
+// Created by deanprangenberg on 25.07.25.
+//
+
+#include "DMChatDBWorker.h"
+
+#include <iostream>
+
+namespace Logic {
+  DMChatDBWorker::DMChatDBWorker(DMChatDBManager &db) : db(db) {
+    writer = std::jthread([this](std::stop_token stopToken) {
+      writerLoop(stopToken);
+    });
+  }
+
+  DMChatDBWorker::~DMChatDBWorker() {
+    writer.request_stop();
+    queueChanged.notify_all();
+    if (writer.joinable()) {
+      writer.join();
+    }
+
+    std::unique_lock lock(queueMutex);
+    queueChanged.wait(lock, [this] { return runningReads == 0; });
+  }
+
+  std::future<bool> DMChatDBWorker::submitWrite(std::string description, WriteFunction write) {
+    WriteCommand command{std::move(description), std::move(write), {}};
+    auto result = command.done.get_future();
+    {
+      std::lock_guard lock(queueMutex);
+      writeQueue.push_back(std::move(command));
+    }
+    queueChanged.notify_all();
+    return result;
+  }
+
+  void DMChatDBWorker::flush() {
+    std::unique_lock lock(queueMutex);
+    queueChanged.wait(lock, [this] { return writeQueue.empty() && !writeRunning; });
+  }
+
+  void DMChatDBWorker::writerLoop(std::stop_token stopToken) {
+    while (true) {
+      WriteCommand command;
+      {
+        std::unique_lock lock(queueMutex);
+        // On stop the queue is still drained, queued writes must not get lost
+        queueChanged.wait(lock, stopToken, [this] { return !writeQueue.empty(); });
+        if (writeQueue.empty()) return;
+
+        command = std::move(writeQueue.front());
+        writeQueue.pop_front();
+        writeRunning = true;
+      }
+
+      bool success = false;
+      try {
+        success = command.write(db);
+      } catch (const std::exception &e) {
+        std::cerr << "DB write threw (" << command.description << "): " << e.what() << std::endl;
+      }
+      if (!success) {
+        std::cerr << "DB write failed (" << command.description << "): " << db.getLastError() << std::endl;
+      }
+      command.done.set_value(success);
+
+      {
+        std::lock_guard lock(queueMutex);
+        writeRunning = false;
+      }
+      queueChanged.notify_all();
+    }
+  }
+
+  void DMChatDBWorker::readStarted() {
+    std::lock_guard lock(queueMutex);
+    runningReads++;
+  }
+
+  void DMChatDBWorker::readFinished() {
+    {
+      std::lock_guard lock(queueMutex);
+      runningReads--;
+    }
+    queueChanged.notify_all();
+  }
+} // Logic
@@ -0,0 +1,74 @@
+//
+// Created by deanprangenberg on 25.07.25.
+//
+
+#ifndef DMCHATDBWORKER_H
+#define DMCHATDBWORKER_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <stop_token>
+#include <string>
+#include <thread>
+
+#include "DMChatDBManager.h"
+#include "../../../../Shared/ThreadPool/ThreadPool.h"
+
+namespace Logic {
+  // Keeps SQLCipher work off the GUI thread. Writes run one after another on a dedicated writer
+  // thread in submission order, reads run on the Utils::ThreadPool with their own pooled
+  // connection, which WAL mode lets proceed while a write is in progress.
+  class DMChatDBWorker {
+  public:
+    using WriteFunction = std::function<bool(DMChatDBManager &db)>;
+
+    explicit DMChatDBWorker(DMChatDBManager &db);
+    // Finishes every queued write and waits for running reads
+    ~DMChatDBWorker();
+
+    DMChatDBWorker(const DMChatDBWorker &) = delete;
+    DMChatDBWorker &operator=(const DMChatDBWorker &) = delete;
+
+    std::future<bool> submitWrite(std::string description, WriteFunction write);
+
+    template<typename F>
+    auto submitRead(F &&read) -> std::future<std::invoke_result_t<F, DMChatDBManager &> >;
+
+    // Blocks until every write submitted so far is done
+    void flush();
+
+  private:
+    struct WriteCommand {
+      std::string description;
+      WriteFunction write;
+      std::promise<bool> done;
+    };
+
+    struct ReadGuard {
+      DMChatDBWorker &worker;
+      ~ReadGuard() { worker.readFinished(); }
+    };
+
+    void writerLoop(std::stop_token stopToken);
+    void readStarted();
+    void readFinished();
+
+    DMChatDBManager &db;
+
+    std::mutex queueMutex;
+    std::condition_variable_any queueChanged;
+    std::deque<WriteCommand> writeQueue;
+    bool writeRunning = false;
+    size_t runningReads = 0;
+
+    // Started last, everything it touches is constructed by then
+    std::jthread writer;
+  };
+} // Logic
+
+#include "DMChatDBWorker.tpp"
+
+#endif //DMCHATDBWORKER_H
@@ -0,0 +1,24 @@
+//
+// Created by deanprangenberg on 25.07.25.
+//
+
+#ifndef DMCHATDBWORKER_TPP
+#define DMCHATDBWORKER_TPP
+
+namespace Logic {
+  template<typename F>
+  auto DMChatDBWorker::submitRead(F &&read) -> std::future<std::invoke_result_t<F, DMChatDBManager &> > {
+    readStarted();
+    try {
+      return Utils::ThreadPool::getInstance().addTask([this, read = std::forward<F>(read)]() mutable {
+        ReadGuard guard{*this};
+        return read(db);
+      });
+    } catch (...) {
+      readFinished();
+      throw;
+    }
+  }
+} // Logic
+
+#endif //DMCHATDBWORKER_TPP
@@ -0,0 +1,114 @@
+//
+// Created by deanprangenberg on 01.08.25.
+//
+
+#include "OutboxDB.h"
+
+#include <QDateTime>
+
+namespace Logic {
+  OutboxDB::OutboxDB(const fs::path &dbPath, const std::string &password, bool debugMode)
+    : LocalDatabase(dbPath, password, debugMode) {
+    if (!createOutboxTables()) {
+      std::cerr << "Error creating outbox tables: " << getLastError() << std::endl;
+    }
+  }
+
+  bool OutboxDB::createOutboxTables() {
+    std::vector<SchemaMigration> migrations;
+
+    migrations.push_back({1, "outbox of unsent messages", [](sqlite3 *handle) {
+      // AUTOINCREMENT so ids are never reused after the newest rows were deleted
+      const char *sql =
+          "CREATE TABLE IF NOT EXISTS outbox ("
+          "id INTEGER PRIMARY KEY AUTOINCREMENT,"
+          "payload BLOB NOT NULL,"
+          "queued_ms INTEGER NOT NULL"
+          ");";
+      return sqlite3_exec(handle, sql, nullptr, nullptr, nullptr) == SQLITE_OK;
+    }});
+
+    return runMigrations(std::move(migrations));
+  }
+
+  bool OutboxDB::commit(const std::vector<QByteArray> &appends, std::vector<int64_t> &appendedIds,
+                        const std::vector<int64_t> &removals) {
+    appendedIds.clear();
+    if (appends.empty() && removals.empty()) return true;
+
+    auto conn = acquireConnection();
+    if (!conn) return false;
+    sqlite3 *handle = conn.get();
+
+    if (sqlite3_exec(handle, "BEGIN TRANSACTION", nullptr, nullptr, nullptr) != SQLITE_OK) {
+      setLastError(sqlite3_errmsg(handle));
+      return false;
+    }
+
+    bool success = true;
+    if (!appends.empty()) {
+      auto statement = conn.prepare("INSERT INTO outbox (payload, queued_ms) VALUES (?, ?);");
+      sqlite3_stmt *stmt = statement.get();
+      success = stmt != nullptr;
+      const int64_t queuedMs = QDateTime::currentMSecsSinceEpoch();
+      appendedIds.reserve(appends.size());
+      for (size_t i = 0; success && i < appends.size(); ++i) {
+        sqlite3_bind_blob(stmt, 1, appends[i].constData(), static_cast<int>(appends[i].size()), SQLITE_STATIC);
+        sqlite3_bind_int64(stmt, 2, queuedMs);
+        success = sqlite3_step(stmt) == SQLITE_DONE;
+        sqlite3_reset(stmt);
+        if (success) appendedIds.push_back(sqlite3_last_insert_rowid(handle));
+      }
+    }
+
+    if (success && !removals.empty()) {
+      auto statement = conn.prepare("DELETE FROM outbox WHERE id = ?;");
+      sqlite3_stmt *stmt = statement.get();
+      success = stmt != nullptr;
+      for (size_t i = 0; success && i < removals.size(); ++i) {
+        sqlite3_bind_int64(stmt, 1, removals[i]);
+        success = sqlite3_step(stmt) == SQLITE_DONE;
+        sqlite3_reset(stmt);
+      }
+    }
+
+    if (success) {
+      success = sqlite3_exec(handle, "COMMIT", nullptr, nullptr, nullptr) == SQLITE_OK;
+    }
+    if (!success) {
+      setLastError(sqlite3_errmsg(handle));
+      sqlite3_exec(handle, "ROLLBACK", nullptr, nullptr, nullptr);
+      appendedIds.clear();
+    }
+    return success;
+  }
+
+  bool OutboxDB::loadPending(int64_t afterId, size_t limit, std::vector<Network::OutboxEntry> &entries) {
+    auto conn = acquireConnection();
+    if (!conn) return false;
+
+    auto statement = conn.prepare("SELECT id, payload FROM outbox WHERE id > ? ORDER BY id LIMIT ?;");
+    sqlite3_stmt *stmt = statement.get();
+    if (!stmt) {
+      setLastError(sqlite3_errmsg(conn.get()));
+      return false;
+    }
+
+    sqlite3_bind_int64(stmt, 1, afterId);
+    sqlite3_bind_int64(stmt, 2, static_cast<sqlite3_int64>(limit));
+
+    int rc;
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+      const void *blob = sqlite3_column_blob(stmt, 1);
+      const int blobSize = sqlite3_column_bytes(stmt, 1);
+      entries.push_back({sqlite3_column_int64(stmt, 0),
+                         QByteArray(static_cast<const char *>(blob), blobSize)});
+    }
+
+    if (rc != SQLITE_DONE) {
+      setLastError(sqlite3_errmsg(conn.get()));
+      return false;
+    }
+    return true;
+  }
+} // Logic
@@ -0,0 +1,28 @@
+//
+// Created by deanprangenberg on 01.08.25.
+//
+
+#ifndef OUTBOXDB_H
+#define OUTBOXDB_H
+
+#include "../../Database/LocalDatabase.h"
+#include "../../../../Shared/Network/OutboxStore.h"
+
+namespace Logic {
+  // Unsent messages of one WebSocketClient in their own SQLCipher database, plaintext never
+  // touches the disk unencrypted unless debugMode is set
+  class OutboxDB : public LocalDatabase, public Network::OutboxStore {
+  public:
+    OutboxDB(const fs::path &dbPath, const std::string &password, bool debugMode);
+
+    bool commit(const std::vector<QByteArray> &appends, std::vector<int64_t> &appendedIds,
+                const std::vector<int64_t> &removals) override;
+
+    bool loadPending(int64_t afterId, size_t limit, std::vector<Network::OutboxEntry> &entries) override;
+
+  private:
+    bool createOutboxTables();
+  };
+} // Logic
+
+#endif //OUTBOXDB_H
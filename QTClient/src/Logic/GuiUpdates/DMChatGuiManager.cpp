@@ -17,18 +17,16 @@ namespace Logic {
     QList<Gui::chatData> chatDataOutput;
 
     auto chatWindowMap = chatScreen->chatWindowMap;
-    auto contactButtonMap = chatScreen->ButtonMap;
+    auto *contactList = chatScreen->contactList;
 
     for (const auto &chatWindowKey: chatWindowMap.keys()) {
       const auto &chatWindow = chatWindowMap.value(chatWindowKey);
 
-      const auto &contactButton = contactButtonMap.value(chatWindowKey);
-
       auto chatData = Gui::chatData(
         chatWindow->getChatHistory(),
-        contactButton->nameLabel->text(),
-        contactButton->chatUUID,
-        contactButton->avatarLabel->pixmap()
+        contactList->contactName(chatWindowKey),
+        chatWindowKey,
+        contactList->contactAvatar(chatWindowKey).toImage()
       );
 
       chatDataOutput.append(chatData);
@@ -39,17 +37,15 @@ namespace Logic {
 
   Gui::chatData DMChatGuiManager::getSingleChatData(const QString &chatUUID) {
     auto chatWindowMap = chatScreen->chatWindowMap;
-    auto contactButtonMap = chatScreen->ButtonMap;
+    auto *contactList = chatScreen->contactList;
 
     const auto &chatWindow = chatWindowMap.value(chatUUID);
 
-    const auto &contactButton = contactButtonMap.value(chatUUID);
-
     auto chatDataOutput = Gui::chatData(
       chatWindow->getChatHistory(),
-      contactButton->nameLabel->text(),
-      contactButton->chatUUID,
-      contactButton->avatarLabel->pixmap()
+      contactList->contactName(chatUUID),
+      chatUUID,
+      contactList->contactAvatar(chatUUID).toImage()
     );
 
     return chatDataOutput;
@@ -57,10 +53,8 @@ namespace Logic {
 
 
   void DMChatGuiManager::addNewChat(const Gui::chatData &chatData) {
-    chatScreen->contactList->addContact(chatData.name, chatData.chatUUID, chatData.avatar);
-    auto *contactButton = chatScreen->contactList->getContactButtonPointer(chatData.chatUUID);
-    if (!contactButton) {
-      std::cerr << "Failed to create contact button for chat: " << chatData.chatUUID.toStdString() << std::endl;
+    if (!chatScreen->contactList->addContact(chatData.name, chatData.chatUUID, QPixmap::fromImage(chatData.avatar))) {
+      std::cerr << "Failed to add contact for chat: " << chatData.chatUUID.toStdString() << std::endl;
       return;
     }
 
@@ -68,13 +62,17 @@ namespace Logic {
     chatWindow->setObjectName("DMScreenChatWindow");
     chatWindow->setChatHistory(chatData.messageContainerList);
 
-    chatScreen->ButtonMap.insert(chatData.chatUUID, contactButton);
     chatScreen->chatWindowMap.insert(chatData.chatUUID, chatWindow);
 
     chatScreen->chatWindowStack->addWidget(chatWindow);
-    chatScreen->connect(contactButton, &QPushButton::clicked, chatScreen, [this, chatData]() {
-      chatScreen->showChatbyID(chatData.chatUUID);
-    });
+    chatScreen->connect(chatWindow, &Gui::ChatWindow::olderMessagesRequested, chatScreen,
+                        [this](const QString &chatUUID) {
+                          if (olderMessagesHandler) {
+                            olderMessagesHandler(chatUUID);
+                          } else if (auto *window = chatScreen->chatWindowMap.value(chatUUID)) {
+                            window->setHistoryComplete(true);
+                          }
+                        });
   }
 
   void DMChatGuiManager::addNewChats(const QList<Gui::chatData> &datas) {
@@ -84,64 +82,84 @@ namespace Logic {
   }
 
   void DMChatGuiManager::deleteChat(const QString &chatUUID) {
-    if (auto *chatWindow = chatScreen->chatWindowMap.value(chatUUID)) {
+    if (auto *chatWindow = chatScreen->chatWindowMap.take(chatUUID)) {
       chatScreen->chatWindowStack->removeWidget(chatWindow);
       delete chatWindow;
     }
-    if (auto *contactButton = chatScreen->ButtonMap.value(chatUUID)) {
-      chatScreen->contactList->removeContact(chatUUID);
-      delete contactButton;
-    }
+    chatScreen->contactList->removeContact(chatUUID);
   }
 
   void DMChatGuiManager::removeAllChats() {
-    for (const auto &chatUUID: chatScreen->chatWindowMap.keys()) {
-      deleteChat(chatUUID);
+    for (auto *chatWindow: chatScreen->chatWindowMap) {
+      chatScreen->chatWindowStack->removeWidget(chatWindow);
+      delete chatWindow;
     }
     chatScreen->chatWindowMap.clear();
-    for (auto *button: chatScreen->ButtonMap.values()) {
-      delete button;
-    }
-    chatScreen->ButtonMap.clear();
+    chatScreen->contactList->removeAllContacts();
   }
 
-  void DMChatGuiManager::updateChat(const QString &chatUUID, const QString &newName, const QPixmap &newAvatar) {
-    auto contactButton = chatScreen->ButtonMap.value(chatUUID);
-    contactButton->setText(newName);
-    contactButton->avatarLabel->setPixmap(newAvatar);
+  void DMChatGuiManager::updateChat(const QString &chatUUID, const QString &newName, const QImage &newAvatar) {
+    chatScreen->contactList->updateContact(chatUUID, newName, QPixmap::fromImage(newAvatar));
   }
 
   void DMChatGuiManager::addNewMessages(QList<Gui::MessageContainer> message) {
-    auto chatWindowMap = chatScreen->chatWindowMap;
-    for (const auto &msg: message) {
-      if (auto *chatWindow = chatWindowMap.value(msg.chatUUID)) {
-        chatWindow->addNewMessages({msg});
+    // One append per chat instead of one per message, order inside a chat is kept
+    QList<QString> chatOrder;
+    QHash<QString, QList<Gui::MessageContainer> > messagesByChat;
+    for (auto &msg: message) {
+      auto it = messagesByChat.find(msg.chatUUID);
+      if (it == messagesByChat.end()) {
+        chatOrder.append(msg.chatUUID);
+        it = messagesByChat.insert(msg.chatUUID, {});
+      }
+      it->append(std::move(msg));
+    }
+
+    for (const auto &chatUUID: chatOrder) {
+      if (auto *chatWindow = chatScreen->chatWindowMap.value(chatUUID)) {
+        chatWindow->addNewMessages(std::move(messagesByChat[chatUUID]));
       } else {
-        std::cerr << "Chat window not found for UUID: " << msg.chatUUID.toStdString() << std::endl;
+        std::cerr << "Chat window not found for UUID: " << chatUUID.toStdString() << std::endl;
       }
     }
   }
 
   void DMChatGuiManager::deleteMessageFromChat(const QString &chatUUID, const QString &messageID) {
-    auto chatWindow = chatScreen->chatWindowMap.value(chatUUID);
-    for (auto it = chatWindow->messageList.begin(); it != chatWindow->messageList.end(); ++it) {
-      if (it->messageUUID == messageID) {
-        chatWindow->messageList.erase(it);
-        break;
-      }
+    if (auto *chatWindow = chatScreen->chatWindowMap.value(chatUUID)) {
+      chatWindow->removeMessage(messageID);
     }
   }
 
   void DMChatGuiManager::updateMessageInChat(const QString &chatUUID, const Gui::MessageContainer &newContent) {
-    auto chatWindow = chatScreen->chatWindowMap.value(chatUUID);
-    for (auto it = chatWindow->messageList.begin(); it != chatWindow->messageList.end(); ++it) {
-      if (it->messageUUID == newContent.messageUUID) {
-        chatWindow->messageList.replace(std::distance(chatWindow->messageList.begin(), it), newContent);
-        break;
-      }
+    if (auto *chatWindow = chatScreen->chatWindowMap.value(chatUUID)) {
+      chatWindow->updateMessage(newContent);
+    }
+  }
+
+  void DMChatGuiManager::setOlderMessagesHandler(std::function<void(const QString &chatUUID)> handler) {
+    olderMessagesHandler = std::move(handler);
+  }
+
+  void DMChatGuiManager::addOldMessages(const QString &chatUUID, const QList<Gui::MessageContainer> &messages) {
+    if (auto *chatWindow = chatScreen->chatWindowMap.value(chatUUID)) {
+      chatWindow->addOldMessages(messages);
+    } else {
+      std::cerr << "Chat window not found for UUID: " << chatUUID.toStdString() << std::endl;
     }
   }
 
+  void DMChatGuiManager::setHistoryComplete(const QString &chatUUID, bool complete) {
+    if (auto *chatWindow = chatScreen->chatWindowMap.value(chatUUID)) {
+      chatWindow->setHistoryComplete(complete);
+    }
+  }
+
+  QString DMChatGuiManager::getOldestMessageUUID(const QString &chatUUID) const {
+    auto *chatWindow = chatScreen->chatWindowMap.value(chatUUID);
+    if (!chatWindow || chatWindow->getChatHistory().isEmpty()) return {};
+    return chatWindow->getChatHistory().first().messageUUID;
+  }
+
   void DMChatGuiManager::generateAndLoadTestChats(int numChats, int numMessagesPerChat) {
     QList<Gui::chatData> chatList;
 
@@ -158,7 +176,7 @@ namespace Logic {
             QString("18.05.2025, %1:%2").arg(12 + chatIndex).arg(msgIndex, 2, 10, QChar('0')),
             QString("Sender %1").arg(chatIndex),
             Crypto::GenerateID::uuid(),
-            QPixmap(":/icons/res/icons/EmptyAccount.png"),
+            QImage(":/icons/res/icons/EmptyAccount.png"),
             msgIndex != 0
           )
         );
@@ -168,7 +186,7 @@ namespace Logic {
         messageList,
         QString("ChatName_%1").arg(chatIndex),
         Crypto::GenerateID::uuid(),
-        QPixmap(":/icons/res/icons/EmptyAccount.png")
+        QImage(":/icons/res/icons/EmptyAccount.png")
       };
 
       chatList.push_back(chat);
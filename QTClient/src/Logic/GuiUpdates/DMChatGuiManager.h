@@ -5,10 +5,11 @@
 #ifndef DMCHATGUIMANAGER_H
 #define DMCHATGUIMANAGER_H
 
+#include <QHash>
 #include <QPixmap>
 #include <QString>
+#include <functional>
 
-#include "../../Gui/ChatWindow/Message.h"
 #include "../../Gui/Gui_Structs_Enums.h"
 #include "../../Gui/DirektChatScreen/DirektChatScreen.h"
 
@@ -31,14 +32,21 @@ private:
   void addNewChats(const QList<Gui::chatData> &datas);
   void deleteChat(const QString &chatUUID);
   void removeAllChats();
-  void updateChat(const QString &chatUUID, const QString &newName, const QPixmap &newAvatar);
+  void updateChat(const QString &chatUUID, const QString &newName, const QImage &newAvatar);
 
   void addNewMessages(QList<Gui::MessageContainer> message);
   void deleteMessageFromChat(const QString &chatUUID, const QString &messageID);
   void updateMessageInChat(const QString &chatUUID, const Gui::MessageContainer &newContent);
 
+  // Paging of older history, the handler is called when a chat window scrolls to its top
+  void setOlderMessagesHandler(std::function<void(const QString &chatUUID)> handler);
+  void addOldMessages(const QString &chatUUID, const QList<Gui::MessageContainer> &messages);
+  void setHistoryComplete(const QString &chatUUID, bool complete);
+  QString getOldestMessageUUID(const QString &chatUUID) const;
+
   void generateAndLoadTestChats(int numChats, int numMessagesPerChat);
   Gui::DirektChatScreen *chatScreen;
+  std::function<void(const QString &chatUUID)> olderMessagesHandler;
 };
 
 } // Logic
@@ -15,11 +15,6 @@ namespace Logic {
     if (testMode) {
       std::cout << "DMChatManager initialized in test mode" << std::endl;
       dbManager = std::make_unique<DMChatDBManager>("TEST_DMchatData.db", "password123", true);
-      bool testdata = generateTestDBAndLoadToGui(10, 100);
-
-      if (!testdata) {
-        throw std::runtime_error("DMChatManager could not be initialized in test mode");
-      }
     } else {
       std::cout << "DMChatManager initialized in production mode" << std::endl;
       std::cerr << "DMChatManager database password still is 'password123'" << std::endl;
@@ -27,6 +22,21 @@ namespace Logic {
     }
 
     guiManager = std::make_unique<DMChatGuiManager>(chatScreen);
+    // Lives in the GUI thread, results of background reads are delivered through it
+    callbackContext = std::make_unique<QObject>();
+    dbWorker = std::make_unique<DMChatDBWorker>(*dbManager);
+    guiManager->setOlderMessagesHandler([this](const QString &chatUUID) {
+      loadOlderMessages(chatUUID);
+    });
+
+    // The test data goes through dbWorker, so it can only be generated once the worker exists
+    if (testMode) {
+      generateTestData(10, 100);
+    }
+  }
+
+  void DMChatManager::postToGui(std::function<void()> update) {
+    QMetaObject::invokeMethod(callbackContext.get(), std::move(update), Qt::QueuedConnection);
   }
 
   void DMChatManager::updateDBfromGui() {
@@ -37,118 +47,171 @@ namespace Logic {
     }
     std::cout << "Updating database with " << guiChatData.size() << " chat(s) from GUI" << std::endl;
 
-    for (const auto &data: guiChatData) {
-      if (data.chatUUID.isEmpty()) {
-        std::cerr << "Skipping chat with empty UUID" << std::endl;
-        continue;
-      }
-
-      std::cout << "Inserting chat in DB: " << data.chatUUID.toStdString() << std::endl;
-      bool successChat = dbManager->insertChat(data);
-      if (successChat) {
-        std::cout << "Updated chat: " << data.chatUUID.toStdString() << std::endl;
-      } else {
-        std::cerr << "Failed to update chat: " << data.chatUUID.toStdString() << std::endl;
+    dbWorker->submitWrite("update DB from GUI", [guiChatData](DMChatDBManager &db) {
+      bool allSuccess = true;
+      for (const auto &data: guiChatData) {
+        if (data.chatUUID.isEmpty()) {
+          std::cerr << "Skipping chat with empty UUID" << std::endl;
+          continue;
+        }
+
+        std::cout << "Inserting chat in DB: " << data.chatUUID.toStdString() << std::endl;
+        bool successChat = db.insertChat(data);
+        if (successChat) {
+          std::cout << "Updated chat: " << data.chatUUID.toStdString() << std::endl;
+        } else {
+          std::cerr << "Failed to update chat: " << data.chatUUID.toStdString() << std::endl;
+          allSuccess = false;
+        }
       }
-    }
+      return allSuccess;
+    });
   }
 
   void DMChatManager::updateGuiFromDB() {
-    auto chatList = dbManager->getAllChats();
-
-    guiManager->removeAllChats();
-
-    for (const auto &chat: chatList) {
-      if (chat.chatUUID.isEmpty()) {
-        std::cerr << "Skipping chat with empty UUID" << std::endl;
-        continue;
-      }
-
-      std::cout << "Adding chat to GUI: " << chat.chatUUID.toStdString() << std::endl;
-      guiManager->addNewChat(chat);
-    }
+    dbWorker->submitRead([this](DMChatDBManager &db) {
+      // Only the newest page per chat, older history is paged in on scroll
+      auto chatList = db.getAllChats(DMChatDBManager::defaultPageSize);
+
+      postToGui([this, chatList = std::move(chatList)]() {
+        guiManager->removeAllChats();
+
+        for (const auto &chat: chatList) {
+          if (chat.chatUUID.isEmpty()) {
+            std::cerr << "Skipping chat with empty UUID" << std::endl;
+            continue;
+          }
+
+          std::cout << "Adding chat to GUI: " << chat.chatUUID.toStdString() << std::endl;
+          guiManager->addNewChat(chat);
+          guiManager->setHistoryComplete(chat.chatUUID,
+                                         chat.messageContainerList.size() < DMChatDBManager::defaultPageSize);
+        }
+      });
+    });
   }
 
   void DMChatManager::addNewChat(const Gui::chatData &data) {
-    dbManager->insertChat(data);
     guiManager->addNewChat(data);
+    dbWorker->submitWrite("insert chat", [data](DMChatDBManager &db) {
+      return db.insertChat(data);
+    });
   }
 
   void DMChatManager::addNewChats(const QList<Gui::chatData> &datas) {
-    dbManager->insertChats(datas);
     guiManager->addNewChats(datas);
+    dbWorker->submitWrite("insert chats", [datas](DMChatDBManager &db) {
+      return db.insertChats(datas);
+    });
   }
 
   void DMChatManager::deleteChat(const QString &chatUUID) {
-    dbManager->deleteChat(chatUUID);
     guiManager->deleteChat(chatUUID);
+    dbWorker->submitWrite("delete chat", [chatUUID](DMChatDBManager &db) {
+      return db.deleteChat(chatUUID);
+    });
   }
 
-  void DMChatManager::updateChat(const QString &chatUUID, const QString &newName, const QPixmap &newAvatar) {
-    auto chatMessages = dbManager->getChatMessages(chatUUID);
+  void DMChatManager::updateChat(const QString &chatUUID, const QString &newName, const QImage &newAvatar) {
+    guiManager->updateChat(chatUUID, newName, newAvatar);
 
+    // updateChat only touches name and avatar, the history is not needed
     auto newChatData = Gui::chatData(
-      chatMessages,
+      {},
       newName,
        chatUUID,
       newAvatar
       );
 
-    dbManager->updateChat(newChatData);
-    guiManager->updateChat(chatUUID, newName, newAvatar);
+    dbWorker->submitWrite("update chat", [newChatData](DMChatDBManager &db) {
+      return db.updateChat(newChatData);
+    });
   }
 
   void DMChatManager::addNewMessages(QList<Gui::MessageContainer> message) {
-    dbManager->insertMessages(message);
     guiManager->addNewMessages(message);
+    dbWorker->submitWrite("insert messages", [message = std::move(message)](DMChatDBManager &db) {
+      return db.insertMessages(message);
+    });
   }
 
   void DMChatManager::deleteMessage(const QString &chatUUID, const QString &messageID) {
-    dbManager->deleteMessage(messageID);
     guiManager->deleteMessageFromChat(chatUUID, messageID);
+    dbWorker->submitWrite("delete message", [messageID](DMChatDBManager &db) {
+      return db.deleteMessage(messageID);
+    });
   }
 
   void DMChatManager::updateMessage(const QString &chatUUID, const Gui::MessageContainer &newContent) {
-    dbManager->updateMessage(newContent);
     guiManager->updateMessageInChat(chatUUID, newContent);
+    dbWorker->submitWrite("update message", [newContent](DMChatDBManager &db) {
+      return db.updateMessage(newContent);
+    });
   }
 
-  bool DMChatManager::generateTestDBAndLoadToGui(int numChats, int numMessagesPerChat) {
-    if (dbManager->getAllChats().size() > 0) {
-      std::cout << "DMChat Database already has data, skipping test data generation." << std::endl;
-      return true; // Database already has data, no need to generate test data
+  void DMChatManager::loadOlderMessages(const QString &chatUUID) {
+    const QString oldestMessageUUID = guiManager->getOldestMessageUUID(chatUUID);
+    if (oldestMessageUUID.isEmpty()) {
+      guiManager->setHistoryComplete(chatUUID, true);
+      return;
     }
 
-    QList<Gui::chatData> chats;
+    dbWorker->submitRead([this, chatUUID, oldestMessageUUID](DMChatDBManager &db) {
+      auto olderMessages = db.getMessagesBefore(chatUUID, oldestMessageUUID, DMChatDBManager::defaultPageSize);
 
-    for (int i = 0; i < numChats; i++) {
-      Gui::chatData chat;
-      QList<Gui::MessageContainer> chatMessages;
+      postToGui([this, chatUUID, olderMessages = std::move(olderMessages)]() {
+        const bool complete = olderMessages.size() < DMChatDBManager::defaultPageSize;
+        guiManager->addOldMessages(chatUUID, olderMessages);
+        guiManager->setHistoryComplete(chatUUID, complete);
+      });
+    });
+  }
 
-      chat.chatUUID = Crypto::GenerateID::uuid();
-      chat.name = "Test Chat " + QString::number(i + 1);
-      chat.avatar = QPixmap(":/icons/res/icons/EmptyAccount.png");
-      if (chat.avatar.isNull()) {
-        qWarning() << "Avatar image not found or failed to load!";
+  void DMChatManager::generateTestData(int numChats, int numMessagesPerChat) {
+    // Built and written on the writer thread, a failure is reported by dbWorker
+    dbWorker->submitWrite("generate test data", [this, numChats, numMessagesPerChat](DMChatDBManager &db) {
+      if (db.hasChats()) {
+        std::cout << "DMChat Database already has data, skipping test data generation." << std::endl;
+        return true;
       }
 
-      for (int j = 0; j < numMessagesPerChat; j++) {
-        Gui::MessageContainer msgs;
-        msgs.messageUUID = Crypto::GenerateID::uuid();
-        msgs.chatUUID = chat.chatUUID;
-        msgs.avatar = chat.avatar;
-        msgs.senderUUID = Crypto::GenerateID::uuid();
-        msgs.senderName = "Test User " + QString::number(j + 1);
-        msgs.message = "This is a test message " + QString::number(j + 1) + " in chat " + chat.name;
-        msgs.time = QDateTime::currentDateTime().toString("dd.MM.yyyy HH:mm");
-        msgs.isFollowUp = (j != 0);
-        chatMessages.append(msgs);
+      QList<Gui::chatData> chats;
+      const qint64 baseTimestamp = QDateTime::currentMSecsSinceEpoch();
+
+      for (int i = 0; i < numChats; i++) {
+        Gui::chatData chat;
+        QList<Gui::MessageContainer> chatMessages;
+
+        chat.chatUUID = Crypto::GenerateID::uuid();
+        chat.name = "Test Chat " + QString::number(i + 1);
+        chat.avatar = QImage(":/icons/res/icons/EmptyAccount.png");
+        if (chat.avatar.isNull()) {
+          qWarning() << "Avatar image not found or failed to load!";
+        }
+
+        for (int j = 0; j < numMessagesPerChat; j++) {
+          Gui::MessageContainer msgs;
+          msgs.messageUUID = Crypto::GenerateID::uuid();
+          msgs.chatUUID = chat.chatUUID;
+          msgs.avatar = chat.avatar;
+          msgs.senderUUID = Crypto::GenerateID::uuid();
+          msgs.senderName = "Test User " + QString::number(j + 1);
+          msgs.message = "This is a test message " + QString::number(j + 1) + " in chat " + chat.name;
+          msgs.timestamp = baseTimestamp + j;
+          msgs.time = QDateTime::fromMSecsSinceEpoch(msgs.timestamp).toString("dd.MM.yyyy HH:mm");
+          msgs.isFollowUp = (j != 0);
+          chatMessages.append(msgs);
+        }
+
+        chat.messageContainerList = chatMessages;
+        chats.append(chat);
       }
 
-      chat.messageContainerList = chatMessages;
-      chats.append(chat);
-    }
+      if (!db.insertChats(chats)) return false;
 
-    return dbManager->insertChats(chats);
+      // A load started before the data was written found nothing, show the new chats now
+      postToGui([this]() { updateGuiFromDB(); });
+      return true;
+    });
   }
 }
@@ -6,12 +6,18 @@
 #define DMCHATMANAGER_H
 
 #include <QDateTime>
+#include <QObject>
+#include <functional>
+#include <memory>
 
 #include "../../Gui/DirektChatScreen/DirektChatScreen.h"
 #include "../DataBaseOperations/DMChatDBManager.h"
+#include "../DataBaseOperations/DMChatDBWorker.h"
 #include "../GuiUpdates/DMChatGuiManager.h"
 
 namespace Logic {
+  // Mutations update the GUI right away and queue the matching DB write, reads run in the
+  // background and hand their results back to the GUI thread
   class DMChatManager {
   public:
     DMChatManager(Gui::DirektChatScreen *chatScreen, bool testMode);
@@ -22,18 +28,27 @@ namespace Logic {
     void addNewChat(const Gui::chatData &data);
     void addNewChats(const QList<Gui::chatData> &datas);
     void deleteChat(const QString &chatUUID);
-    void updateChat(const QString &chatUUID, const QString &newName, const QPixmap &newAvatar);
+    void updateChat(const QString &chatUUID, const QString &newName, const QImage &newAvatar);
 
     void addNewMessages(QList<Gui::MessageContainer> message);
     void deleteMessage(const QString &chatUUID, const QString &messageID);
     void updateMessage(const QString &chatUUID, const Gui::MessageContainer &newContent);
 
-    bool generateTestDBAndLoadToGui(int numChats, int numMessagesPerChat);
+    // Loads the next page of history above the oldest message shown in the chat
+    void loadOlderMessages(const QString &chatUUID);
+
+    // Fills an empty database in the background and loads the result into the GUI once written
+    void generateTestData(int numChats, int numMessagesPerChat);
 
   private:
+    void postToGui(std::function<void()> update);
+
     std::unique_ptr<DMChatDBManager> dbManager;
     Gui::DirektChatScreen *chatScreen;
     std::unique_ptr<DMChatGuiManager> guiManager;
+    std::unique_ptr<QObject> callbackContext;
+    // Declared last so it is destroyed first, it still uses everything above while draining
+    std::unique_ptr<DMChatDBWorker> dbWorker;
   };
 }
 
@@ -1,16 +1,19 @@
 #include <QApplication>
 #include <QPushButton>
 #include <iostream>
-#include "../test/WebSocketWorker.h"
-#include <QThread>
+#include "../test/ChatWindowBenchmark.h"
+#include "../test/EncryptionBenchmark.h"
+#include "../test/KDFBenchmark.h"
 #include "../../Shared/Crypto/Encryption/EncryptionEnv.h"
 #include "../../Shared/Crypto/Hash/HashingEnv.h"
-#include "ThreadPool/ThreadPool.h"
+#include "../../Shared/ThreadPool/ThreadPool.h"
 #include "../../Shared/Crypto/KeyEnv/KeyEnv.h"
 #include "../../Shared/Crypto/DoubleRatchet/DoubleRatchet.h"
 #include "HelperUtils/HelperUtils.h"
 #include "Gui/MainWindow/MainWindow.h"
 #include "../../Shared/Network/WebSocketClient.h"
+#include "../../Shared/Network/ConnectionManager.h"
+#include "Logic/DataBaseOperations/OutboxDB.h"
 #include "../../Shared/Network/Packages.h"
 #include <QFile>
 
@@ -106,17 +109,42 @@ void test_double_ratchet() {
 }
 
 void test_mulitBackendConnection(int numClients) {
-  QList<QThread *> threads;
+  // All sessions share the manager's I/O threads, one per core however many clients there are.
+  // Every session keeps its unsent messages in its own encrypted outbox, which outlives the manager.
+  auto *outboxes = new std::vector<std::unique_ptr<Logic::OutboxDB> >;
+  auto *manager = new Network::ConnectionManager;
+  QObject::connect(qApp, &QCoreApplication::aboutToQuit, [manager, outboxes]() {
+    delete manager;
+    delete outboxes;
+  });
+
+  std::cerr << "Outbox database password still is 'password123'" << std::endl;
+  Packages pack;
   for (int i = 0; i < numClients; ++i) {
-    QThread *thread = new QThread;
-    WebSocketWorker *worker = new WebSocketWorker(i);
-    worker->moveToThread(thread);
-    QObject::connect(thread, &QThread::started, worker, &WebSocketWorker::process);
-    thread->start();
-    threads.append(thread);
+    outboxes->push_back(std::make_unique<Logic::OutboxDB>("Enc_Outbox_" + std::to_string(i) + ".db",
+                                                          "password123", false));
+    Network::SessionOptions options;
+    options.outbox = outboxes->back().get();
+    auto id = manager->addSession(QUrl("ws://127.0.0.1:8881/ws"), options);
+    // Waits in the session's queue until the handshake is done
+    manager->sendMessage(id, pack.testMessage());
+    std::cout << "WebSocket client " << i << " started" << std::endl;
   }
 }
 
+void test_chatWindowAppend() {
+  ChatWindowBenchmark::run(50000, 10000);
+}
+
+void test_encryptionThroughput() {
+  EncryptionBenchmark::run();
+  EncryptionBenchmark::runBatch();
+}
+
+void test_kdfChainStep() {
+  KDFBenchmark::run();
+}
+
 int main(int argc, char *argv[]) {
   QApplication a(argc, argv);
   Gui::MainWindow mainWindow;
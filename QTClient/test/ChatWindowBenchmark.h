@@ -0,0 +1,70 @@
+//
+// Created by deanprangenberg on 21.07.25.
+//
+
+#ifndef CHATWINDOWBENCHMARK_H
+#define CHATWINDOWBENCHMARK_H
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <iostream>
+
+#include "../src/Gui/ChatWindow/ChatWindow.h"
+
+// Pushes newMessages single-message appends into a chat that already shows existingMessages
+// and reports how long the appends plus the coalesced flush take.
+class ChatWindowBenchmark {
+public:
+  static void run(int existingMessages = 50000, int newMessages = 10000) {
+    const QImage avatar(":/icons/res/icons/EmptyAccount.png");
+    const QString chatUUID = "benchmark-chat";
+
+    Gui::ChatWindow chatWindow(chatUUID);
+    chatWindow.resize(800, 600);
+    chatWindow.show();
+
+    QElapsedTimer timer;
+    timer.start();
+    chatWindow.setChatHistory(makeMessages(chatUUID, avatar, 0, existingMessages));
+    QCoreApplication::processEvents();
+    std::cout << "ChatWindow: loaded " << existingMessages << " messages in "
+        << timer.elapsed() << " ms" << std::endl;
+
+    auto incoming = makeMessages(chatUUID, avatar, existingMessages, newMessages);
+
+    // Like the network path, one call per received message, all within one event loop tick
+    timer.restart();
+    for (const auto &msg: incoming) {
+      chatWindow.addNewMessages({msg});
+    }
+    QCoreApplication::processEvents();
+    const qint64 elapsedMs = timer.elapsed();
+
+    std::cout << "ChatWindow: appended " << newMessages << " messages to " << existingMessages
+        << " in " << elapsedMs << " ms ("
+        << (elapsedMs > 0 ? newMessages * 1000 / elapsedMs : newMessages) << " msg/s), rows now "
+        << chatWindow.getChatHistory().size() << std::endl;
+  }
+
+private:
+  static QList<Gui::MessageContainer> makeMessages(const QString &chatUUID, const QImage &avatar,
+                                                   int first, int count) {
+    QList<Gui::MessageContainer> messages;
+    messages.reserve(count);
+    for (int i = first; i < first + count; ++i) {
+      Gui::MessageContainer msg;
+      msg.chatUUID = chatUUID;
+      msg.messageUUID = QString("benchmark-message-%1").arg(i);
+      msg.message = QString("Benchmark message %1 with some text that wraps in narrow windows").arg(i);
+      msg.time = "21.07.2025 12:00";
+      msg.senderName = "Benchmark";
+      msg.senderUUID = "benchmark-sender";
+      msg.avatar = avatar;
+      msg.isFollowUp = i % 5 != 0;
+      messages.append(msg);
+    }
+    return messages;
+  }
+};
+
+#endif //CHATWINDOWBENCHMARK_H
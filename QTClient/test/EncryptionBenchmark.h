@@ -0,0 +1,124 @@
+//
+// Created by deanprangenberg on 26.07.25.
+//
+
+#ifndef ENCRYPTIONBENCHMARK_H
+#define ENCRYPTIONBENCHMARK_H
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "../../Shared/Crypto/Encryption/BatchAead.h"
+#include "../../Shared/Crypto/Encryption/CipherContext.h"
+#include "../../Shared/Crypto/KeyEnv/KeyEnv.h"
+
+// Per message cost of AEAD encryption for 64 B to 64 KiB payloads, once with a fresh context per
+// message like the old AES256/ChaCha20 code and once with one reused CipherContext.
+// runBatch seals a history sync sized batch through BatchAead with a growing number of threads.
+class EncryptionBenchmark {
+public:
+  static void run() {
+    for (const char *cipherName: {"AES-256-GCM", "ChaCha20-Poly1305"}) {
+      for (size_t payloadSize = 64; payloadSize <= 64 * 1024; payloadSize *= 4) {
+        runCase(cipherName, payloadSize);
+      }
+    }
+  }
+
+  static void runBatch(size_t messages = 20000, size_t payloadSize = 256) {
+    Crypto::EncryptionEnv keySource(Crypto::EncAlgorithm::AES256);
+    std::vector<uint8_t> plaintext(messages * payloadSize, 0x42);
+    std::vector<uint8_t> sealed(messages * Crypto::EncryptionEnv::sealedSize(payloadSize));
+    std::vector<uint8_t> nonces(messages * Crypto::CipherContext::ivSize);
+
+    // Same key for every message like a fan out, every message gets its own nonce
+    std::vector<Crypto::AeadJob> jobs(messages);
+    for (size_t i = 0; i < messages; ++i) {
+      std::span<uint8_t> nonce(nonces.data() + i * Crypto::CipherContext::ivSize, Crypto::CipherContext::ivSize);
+      std::copy(keySource.iv.begin(), keySource.iv.end(), nonce.begin());
+      nonce[0] ^= static_cast<uint8_t>(i);
+      nonce[1] ^= static_cast<uint8_t>(i >> 8);
+      nonce[2] ^= static_cast<uint8_t>(i >> 16);
+
+      jobs[i].key = keySource.key;
+      jobs[i].nonce = nonce;
+      jobs[i].in = std::span<const uint8_t>(plaintext.data() + i * payloadSize, payloadSize);
+      jobs[i].out = std::span<uint8_t>(sealed.data() + i * Crypto::EncryptionEnv::sealedSize(payloadSize),
+                                       Crypto::EncryptionEnv::sealedSize(payloadSize));
+    }
+
+    Crypto::BatchAead batch(Crypto::EncAlgorithm::AES256);
+    const size_t maxThreads = std::max(1u, std::thread::hardware_concurrency());
+    for (size_t threads = 1; threads <= maxThreads; threads *= 2) {
+      const auto stats = batch.sealAll(jobs, threads);
+      std::cout << "Encryption: batch of " << stats.messages << " x " << payloadSize << " B on " << threads
+          << " thread(s), " << static_cast<long long>(stats.messagesPerSecond()) << " msg/s, "
+          << stats.gigabytesPerSecond() << " GB/s, " << stats.failed << " failed" << std::endl;
+    }
+  }
+
+private:
+  static void runCase(const char *cipherName, size_t payloadSize) {
+    // Roughly 32 MiB per case, but enough messages that small payloads are not dominated by noise
+    const size_t messages = std::max<size_t>(2000, 32 * 1024 * 1024 / payloadSize);
+
+    std::vector<uint8_t> key(Crypto::CipherContext::keySize);
+    std::vector<uint8_t> iv(Crypto::CipherContext::ivSize);
+    Crypto::KeyEnv keyEnv(Crypto::KeyType::KeyIv);
+    keyEnv.startKeyIvGeneration(key, iv);
+
+    std::vector<uint8_t> plaintext(payloadSize, 0x42);
+    std::vector<uint8_t> ciphertext(payloadSize);
+    uint8_t tag[Crypto::CipherContext::tagSize];
+
+    const double freshNs = measure(messages, [&](size_t i) {
+      Crypto::CipherContext context(cipherName, true);
+      return sealOne(context, key, iv, i, plaintext, ciphertext, tag);
+    });
+
+    Crypto::CipherContext reusedContext(cipherName, true);
+    const double reusedNs = measure(messages, [&](size_t i) {
+      return sealOne(reusedContext, key, iv, i, plaintext, ciphertext, tag);
+    });
+
+    std::cout << "Encryption: " << cipherName << " " << payloadSize << " B, fresh ctx "
+        << static_cast<long long>(freshNs) << " ns/msg, reused ctx "
+        << static_cast<long long>(reusedNs) << " ns/msg ("
+        << static_cast<long long>(payloadSize * 1000.0 / reusedNs) << " MB/s)" << std::endl;
+  }
+
+  template<typename F>
+  static double measure(size_t messages, F &&sealMessage) {
+    const auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < messages; ++i) {
+      if (!sealMessage(i)) {
+        std::cerr << "Encryption: benchmark message " << i << " failed" << std::endl;
+        return 0;
+      }
+    }
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+    return std::chrono::duration<double, std::nano>(elapsed).count() / static_cast<double>(messages);
+  }
+
+  static bool sealOne(Crypto::CipherContext &context, const std::vector<uint8_t> &key, std::vector<uint8_t> iv,
+                      size_t messageNum, const std::vector<uint8_t> &plaintext, std::vector<uint8_t> &ciphertext,
+                      uint8_t *tag) {
+    // Unique IV per message, same key, like a sending chain within one ratchet step
+    for (size_t b = 0; b < sizeof(messageNum); ++b) {
+      iv[b] ^= static_cast<uint8_t>(messageNum >> (8 * b));
+    }
+
+    int len = 0;
+    int finalLen = 0;
+    return context.init(key.data(), iv.data())
+           && EVP_EncryptUpdate(context.get(), ciphertext.data(), &len, plaintext.data(),
+                                static_cast<int>(plaintext.size())) == 1
+           && EVP_EncryptFinal_ex(context.get(), ciphertext.data() + len, &finalLen) == 1
+           && EVP_CIPHER_CTX_ctrl(context.get(), EVP_CTRL_AEAD_GET_TAG, Crypto::CipherContext::tagSize, tag) == 1;
+  }
+};
+
+#endif //ENCRYPTIONBENCHMARK_H
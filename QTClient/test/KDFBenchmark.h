@@ -0,0 +1,82 @@
+//
+// Created by deanprangenberg on 29.07.25.
+//
+
+#ifndef KDFBENCHMARK_H
+#define KDFBENCHMARK_H
+
+#include <openssl/kdf.h>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#include "../../Shared/Crypto/KDF/KDFEnv.h"
+#include "../../Shared/Crypto/KeyEnv/SecureKey.h"
+
+// Ratchet chain steps per second: 32 byte chain key in, 64 byte chain key + message key out, as in
+// DoubleRatchet::symmetricRatchetStep. "before" sets up a new EVP_PKEY_CTX and allocates the output
+// per step like the old HKDF::derive, "after" goes through one KDFEnv and a stack buffer.
+class KDFBenchmark {
+public:
+  static void run(size_t steps = 200000) {
+    Crypto::Key32 chainKey{};
+    Crypto::Key32 sharedSecret{};
+    std::memset(chainKey.data(), 0x11, chainKey.size());
+    std::memset(sharedSecret.data(), 0x22, sharedSecret.size());
+
+    const double before = measure(steps, [&]() {
+      std::vector<uint8_t> out = legacyDerive(chainKey, sharedSecret);
+      if (out.size() != 64) return false;
+      std::memcpy(chainKey.data(), out.data(), chainKey.size());
+      return true;
+    });
+
+    Crypto::KDFEnv kdf(Crypto::KDFType::SHA3_512);
+    const double after = measure(steps, [&]() {
+      Crypto::Key64 out;
+      if (!kdf.startKDF(chainKey.span(), sharedSecret.span(), "SendChainStep", out.span())) return false;
+      std::memcpy(chainKey.data(), out.data(), chainKey.size());
+      out.wipe();
+      return true;
+    });
+
+    std::cout << "KDF: ratchet chain step before " << static_cast<long long>(before) << " steps/s, after "
+        << static_cast<long long>(after) << " steps/s" << std::endl;
+  }
+
+private:
+  template<typename F>
+  static double measure(size_t steps, F &&step) {
+    const auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < steps; ++i) {
+      if (!step()) {
+        std::cerr << "KDF: benchmark step " << i << " failed" << std::endl;
+        return 0;
+      }
+    }
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return seconds > 0 ? steps / seconds : 0;
+  }
+
+  static std::vector<uint8_t> legacyDerive(const Crypto::Key32 &ikm, const Crypto::Key32 &salt) {
+    static const std::string info = "SendChainStep";
+    std::vector<uint8_t> infoVec(info.begin(), info.end());
+    std::vector<uint8_t> out(64);
+    size_t outLen = out.size();
+
+    EVP_PKEY_CTX *ctx = EVP_PKEY_CTX_new_id(EVP_PKEY_HKDF, nullptr);
+    const bool ok = ctx
+                    && EVP_PKEY_derive_init(ctx) > 0
+                    && EVP_PKEY_CTX_set_hkdf_md(ctx, EVP_sha3_512()) > 0
+                    && EVP_PKEY_CTX_set_hkdf_mode(ctx, EVP_PKEY_HKDEF_MODE_EXTRACT_AND_EXPAND) > 0
+                    && EVP_PKEY_CTX_set1_hkdf_salt(ctx, salt.data(), salt.size()) > 0
+                    && EVP_PKEY_CTX_set1_hkdf_key(ctx, ikm.data(), ikm.size()) > 0
+                    && EVP_PKEY_CTX_add1_hkdf_info(ctx, infoVec.data(), infoVec.size()) > 0
+                    && EVP_PKEY_derive(ctx, out.data(), &outLen) > 0;
+    EVP_PKEY_CTX_free(ctx);
+    return ok ? out : std::vector<uint8_t>();
+  }
+};
+
+#endif //KDFBENCHMARK_H
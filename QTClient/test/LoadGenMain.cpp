@@ -0,0 +1,49 @@
+//
+// Created by deanprangenberg on 02.08.25.
+//
+
+#include <sys/resource.h>
+#include <cstring>
+#include <iostream>
+#include "LoadGenerator.h"
+
+// ventra-loadgen [--clients n] [--loops n] [--rate msgs/s per client] [--seconds n] [--payload bytes]
+//                [--url ws://host:port/ws] [--json <file>] [--verbose]
+int main(int argc, char *argv[]) {
+  QCoreApplication app(argc, argv);
+  LoadGenerator::Options options;
+
+  for (int i = 1; i < argc; ++i) {
+    const bool hasValue = i + 1 < argc;
+    if (std::strcmp(argv[i], "--clients") == 0 && hasValue) {
+      options.clients = std::strtoul(argv[++i], nullptr, 10);
+    } else if (std::strcmp(argv[i], "--loops") == 0 && hasValue) {
+      options.loops = std::strtoul(argv[++i], nullptr, 10);
+    } else if (std::strcmp(argv[i], "--rate") == 0 && hasValue) {
+      options.ratePerClient = std::strtod(argv[++i], nullptr);
+    } else if (std::strcmp(argv[i], "--seconds") == 0 && hasValue) {
+      options.durationSeconds = std::atoi(argv[++i]);
+    } else if (std::strcmp(argv[i], "--payload") == 0 && hasValue) {
+      options.payloadSize = std::strtoul(argv[++i], nullptr, 10);
+    } else if (std::strcmp(argv[i], "--url") == 0 && hasValue) {
+      options.url = QString::fromLocal8Bit(argv[++i]);
+    } else if (std::strcmp(argv[i], "--json") == 0 && hasValue) {
+      options.jsonPath = argv[++i];
+    } else if (std::strcmp(argv[i], "--verbose") == 0) {
+      options.verbose = true;
+    } else {
+      std::cerr << "Usage: " << argv[0] << " [--clients n] [--loops n] [--rate msgs/s per client] [--seconds n]"
+          << " [--payload bytes] [--url ws://host:port/ws] [--json <file>] [--verbose]" << std::endl;
+      return 2;
+    }
+  }
+
+  // Two sockets per client with the in process relay, far more than the usual soft limit of 1024
+  rlimit files{};
+  if (getrlimit(RLIMIT_NOFILE, &files) == 0 && files.rlim_cur < files.rlim_max) {
+    files.rlim_cur = files.rlim_max;
+    setrlimit(RLIMIT_NOFILE, &files);
+  }
+
+  return LoadGenerator::run(options);
+}
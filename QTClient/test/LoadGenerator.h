@@ -0,0 +1,423 @@
+//
+// Created by deanprangenberg on 02.08.25.
+//
+
+#ifndef LOADGENERATOR_H
+#define LOADGENERATOR_H
+
+#include <QCoreApplication>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMetaObject>
+#include <QThread>
+#include <QTimer>
+#include <sys/resource.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../../Shared/Network/NetLog.h"
+#include "../../Shared/Network/Packages.h"
+#include "../../Shared/Network/WebSocketClient.h"
+#include "../../Shared/Network/WebSocketServer.h"
+
+// End to end load test on localhost, built as the ventra-loadgen target. Thousands of
+// WebSocketClients are spread over a few event loop threads, the clients of a thread share its
+// CryptoEngines like under Network::ConnectionManager. Client i sends to client i ^ 1
+// through the relay, so every message is encrypted by the client, decrypted and re-encrypted by
+// the relay and decrypted by the receiver. Latency is taken from the send call to the receiver's
+// message handler. CPU per message covers the whole process, the relay included when it runs
+// in process. Needs a QCoreApplication, run() itself blocks the calling thread.
+class LoadGenerator {
+public:
+  struct Options {
+    size_t clients = 2000;
+    size_t loops = 4;
+    double ratePerClient = 5;
+    int durationSeconds = 10;
+    size_t payloadSize = 256;
+    // Empty starts a relay on its own thread in this process
+    QString url;
+    bool verbose = false;
+    std::string jsonPath;
+  };
+
+  static int run(const Options &options) {
+    LoadGenerator generator(options);
+    return generator.execute();
+  }
+
+private:
+  using Clock = std::chrono::steady_clock;
+
+  static constexpr int tickMs = 10;
+  static constexpr int connectTimeoutSeconds = 60;
+  static constexpr int drainTimeoutSeconds = 5;
+
+  static int64_t nowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now().time_since_epoch()).count();
+  }
+
+  static QString userName(size_t index) {
+    return QStringLiteral("load-%1").arg(index);
+  }
+
+  // Owns the clients of one event loop thread, every method runs on that thread
+  class Worker : public QObject {
+  public:
+    Worker(const Options &options, size_t firstClient, size_t clientCount)
+      : options(options), firstClient(firstClient), clientCount(clientCount) {
+    }
+
+    std::atomic<size_t> connected{0};
+    std::atomic<uint64_t> sent{0};
+    std::atomic<uint64_t> rejected{0};
+    std::atomic<uint64_t> received{0};
+    std::vector<double> latenciesNs;
+
+    void start(const QUrl &url) {
+      payload = QString(static_cast<qsizetype>(options.payloadSize), QChar('x'));
+      std::mt19937 rng(static_cast<uint32_t>(firstClient));
+      std::uniform_real_distribution<double> phase(0, 1);
+
+      for (size_t i = 0; i < clientCount; ++i) {
+        const size_t index = firstClient + i;
+        auto client = std::make_unique<Network::WebSocketClient>(url, nullptr, &engines);
+        client->setUserId(userName(index));
+        client->setMessageHandler([this](const QByteArray &plaintext) { onMessage(plaintext); });
+        clients.push_back(std::move(client));
+        // Random start credit, so the clients of one tick do not all send at once
+        credits.push_back(phase(rng));
+      }
+
+      statusTimer = new QTimer(this);
+      connect(statusTimer, &QTimer::timeout, this, [this]() {
+        size_t count = 0;
+        for (const auto &client: clients) count += client->isConnected() ? 1 : 0;
+        connected = count;
+      });
+      statusTimer->start(50);
+
+      sendTimer = new QTimer(this);
+      connect(sendTimer, &QTimer::timeout, this, [this]() { tick(); });
+    }
+
+    void beginSending(int64_t startNs, int64_t endNs) {
+      measureStartNs = startNs;
+      sendUntilNs = endNs;
+      lastTickNs = nowNs();
+      sendTimer->start(tickMs);
+    }
+
+    void stop() {
+      statusTimer->stop();
+      sendTimer->stop();
+      clients.clear();
+    }
+
+  private:
+    void tick() {
+      const int64_t now = nowNs();
+      if (now >= sendUntilNs) {
+        sendTimer->stop();
+        return;
+      }
+
+      const double credit = options.ratePerClient * static_cast<double>(now - lastTickNs) / 1e9;
+      lastTickNs = now;
+
+      Packages packages;
+      for (size_t i = 0; i < clients.size(); ++i) {
+        credits[i] += credit;
+        while (credits[i] >= 1) {
+          credits[i] -= 1;
+          const size_t index = firstClient + i;
+          QJsonObject message = packages.makeMessagePkg(payload, QString(), userName(index), "Load",
+                                                        userName(index ^ 1), QString::number(sequence++));
+          message["sentNs"] = QString::number(nowNs());
+          if (clients[i]->sendMessage(message)) {
+            ++sent;
+          } else {
+            ++rejected;
+          }
+        }
+      }
+    }
+
+    void onMessage(const QByteArray &plaintext) {
+      const QJsonObject message = QJsonDocument::fromJson(plaintext).object();
+      bool ok = false;
+      const int64_t sentNs = message["sentNs"].toString().toLongLong(&ok);
+      // Handshake test packets and messages from before the measurement
+      if (!ok || sentNs < measureStartNs) return;
+
+      latenciesNs.push_back(static_cast<double>(nowNs() - sentNs));
+      ++received;
+    }
+
+    const Options &options;
+    Network::CryptoEngines engines;
+    size_t firstClient;
+    size_t clientCount;
+    QString payload;
+    std::vector<std::unique_ptr<Network::WebSocketClient> > clients;
+    std::vector<double> credits;
+    QTimer *statusTimer = nullptr;
+    QTimer *sendTimer = nullptr;
+    int64_t measureStartNs = 0;
+    int64_t sendUntilNs = 0;
+    int64_t lastTickNs = 0;
+    uint64_t sequence = 0;
+  };
+
+  struct Result {
+    double connectMs = 0;
+    size_t connectedClients = 0;
+    uint64_t sent = 0;
+    uint64_t rejected = 0;
+    uint64_t received = 0;
+    double seconds = 0;
+    double messagesPerSecond = 0;
+    double p50Ms = 0;
+    double p90Ms = 0;
+    double p99Ms = 0;
+    double maxMs = 0;
+    double cpuUsPerMessage = 0;
+    Network::RelayStats relay;
+    bool relayInProcess = false;
+  };
+
+  explicit LoadGenerator(const Options &options) : options(options) {
+  }
+
+  static double cpuSeconds() {
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+    return static_cast<double>(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) +
+           static_cast<double>(usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+  }
+
+  template<typename Function>
+  static void runOn(QObject *context, Function function) {
+    QMetaObject::invokeMethod(context, std::move(function), Qt::BlockingQueuedConnection);
+  }
+
+  int execute() {
+    // Every client logs its handshake, thousands of them would drown the results
+    if (!options.verbose) Network::NetLog::setLevel(Crypto::LogLevel::Warn);
+
+    const bool ok = startRelay() && connectClients() && measure();
+    shutdown();
+
+    Network::NetLog::setLevel(Network::NetLog::compiledLevel);
+    Crypto::CryptoLog::getInstance().flush();
+    if (!ok) return 1;
+
+    printResult();
+    if (!options.jsonPath.empty() && !writeJson(options.jsonPath)) return 1;
+    return result.received > 0 ? 0 : 1;
+  }
+
+  bool startRelay() {
+    if (!options.url.isEmpty()) {
+      url = QUrl(options.url);
+      return true;
+    }
+
+    result.relayInProcess = true;
+    relayHost = std::make_unique<QObject>();
+    relayHost->moveToThread(&relayThread);
+    relayThread.start();
+
+    quint16 port = 0;
+    runOn(relayHost.get(), [this, &port]() {
+      relay = new Network::WebSocketServer(0, relayHost.get());
+      port = relay->isListening() ? relay->port() : 0;
+    });
+    if (port == 0) {
+      std::cerr << "[LoadGenerator] Relay could not listen on localhost" << std::endl;
+      return false;
+    }
+    url = QUrl(QStringLiteral("ws://127.0.0.1:%1/ws").arg(port));
+    return true;
+  }
+
+  bool connectClients() {
+    const size_t loops = std::clamp<size_t>(options.loops, 1, std::max<size_t>(options.clients, 1));
+    size_t first = 0;
+    for (size_t i = 0; i < loops; ++i) {
+      const size_t count = options.clients / loops + (i < options.clients % loops ? 1 : 0);
+      auto worker = std::make_unique<Worker>(options, first, count);
+      auto thread = std::make_unique<QThread>();
+      worker->moveToThread(thread.get());
+      thread->start();
+      first += count;
+      workers.push_back(std::move(worker));
+      threads.push_back(std::move(thread));
+    }
+
+    const auto start = Clock::now();
+    for (auto &worker: workers) {
+      Worker *target = worker.get();
+      runOn(target, [this, target]() { target->start(url); });
+    }
+
+    // Refused connections retry with the client's own backoff
+    const auto deadline = start + std::chrono::seconds(connectTimeoutSeconds);
+    while (Clock::now() < deadline && connectedClients() < options.clients) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+    result.connectedClients = connectedClients();
+    result.connectMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+    if (result.connectedClients < options.clients) {
+      std::cerr << "[LoadGenerator] Only " << result.connectedClients << " of " << options.clients
+          << " clients connected within " << connectTimeoutSeconds << " s" << std::endl;
+      return false;
+    }
+    return true;
+  }
+
+  size_t connectedClients() const {
+    size_t count = 0;
+    for (const auto &worker: workers) count += worker->connected;
+    return count;
+  }
+
+  uint64_t total(std::atomic<uint64_t> Worker::*counter) const {
+    uint64_t sum = 0;
+    for (const auto &worker: workers) sum += (worker.get()->*counter).load();
+    return sum;
+  }
+
+  bool measure() {
+    const double cpuStart = cpuSeconds();
+    const int64_t startNs = nowNs();
+    const int64_t endNs = startNs + static_cast<int64_t>(options.durationSeconds) * 1000000000;
+    for (auto &worker: workers) {
+      Worker *target = worker.get();
+      QMetaObject::invokeMethod(target, [target, startNs, endNs]() { target->beginSending(startNs, endNs); },
+                                Qt::QueuedConnection);
+    }
+
+    std::this_thread::sleep_for(std::chrono::nanoseconds(endNs - nowNs()));
+    const auto drainDeadline = Clock::now() + std::chrono::seconds(drainTimeoutSeconds);
+    uint64_t lastReceived = 0;
+    while (Clock::now() < drainDeadline) {
+      lastReceived = total(&Worker::received);
+      if (lastReceived >= total(&Worker::sent)) break;
+      std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+
+    result.seconds = static_cast<double>(nowNs() - startNs) / 1e9;
+    const double cpuUsed = cpuSeconds() - cpuStart;
+
+    std::vector<double> latenciesNs;
+    for (auto &worker: workers) {
+      Worker *target = worker.get();
+      runOn(target, [target, &latenciesNs]() {
+        latenciesNs.insert(latenciesNs.end(), target->latenciesNs.begin(), target->latenciesNs.end());
+      });
+    }
+
+    result.sent = total(&Worker::sent);
+    result.rejected = total(&Worker::rejected);
+    result.received = latenciesNs.size();
+    result.messagesPerSecond = static_cast<double>(result.received) / result.seconds;
+    result.cpuUsPerMessage = result.received > 0 ? cpuUsed * 1e6 / static_cast<double>(result.received) : 0;
+
+    if (!latenciesNs.empty()) {
+      std::sort(latenciesNs.begin(), latenciesNs.end());
+      auto percentile = [&](double p) {
+        return latenciesNs[static_cast<size_t>(p * static_cast<double>(latenciesNs.size() - 1) + 0.5)] / 1e6;
+      };
+      result.p50Ms = percentile(0.50);
+      result.p90Ms = percentile(0.90);
+      result.p99Ms = percentile(0.99);
+      result.maxMs = latenciesNs.back() / 1e6;
+    }
+    return true;
+  }
+
+  void shutdown() {
+    for (size_t i = 0; i < workers.size(); ++i) {
+      Worker *target = workers[i].get();
+      runOn(target, [target]() { target->stop(); });
+      threads[i]->quit();
+      threads[i]->wait();
+    }
+    workers.clear();
+    threads.clear();
+
+    if (relayHost) {
+      runOn(relayHost.get(), [this]() {
+        if (!relay) return;
+        result.relay = relay->stats();
+        delete relay;
+        relay = nullptr;
+      });
+      relayThread.quit();
+      relayThread.wait();
+    }
+  }
+
+  void printResult() const {
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "clients            " << options.clients << " on " << options.loops << " event loops" << std::endl;
+    std::cout << "connect all        " << result.connectMs << " ms" << std::endl;
+    std::cout << "target rate        " << options.ratePerClient * static_cast<double>(options.clients)
+        << " msgs/s, " << options.payloadSize << " B payload" << std::endl;
+    std::cout << "sent / received    " << result.sent << " / " << result.received
+        << " (" << result.rejected << " rejected)" << std::endl;
+    std::cout << "throughput         " << result.messagesPerSecond << " msgs/s over " << result.seconds << " s"
+        << std::endl;
+    std::cout << "latency ms         p50 " << result.p50Ms << "  p90 " << result.p90Ms << "  p99 " << result.p99Ms
+        << "  max " << result.maxMs << std::endl;
+    std::cout << "cpu per message    " << result.cpuUsPerMessage << " us"
+        << (result.relayInProcess ? " (clients and relay)" : " (clients only)") << std::endl;
+    if (result.relayInProcess) {
+      std::cout << "relay              " << result.relay.handshakes << " handshakes, " << result.relay.resumes
+          << " resumes, " << result.relay.messagesRelayed << " relayed, " << result.relay.undeliverable
+          << " undeliverable, " << result.relay.malformed << " malformed" << std::endl;
+    }
+    std::cout << std::defaultfloat;
+  }
+
+  bool writeJson(const std::string &path) const {
+    std::ofstream file(path);
+    if (!file) {
+      std::cerr << "[LoadGenerator] Cannot write " << path << std::endl;
+      return false;
+    }
+
+    file << std::fixed << std::setprecision(3);
+    file << "{\n  \"clients\": " << options.clients << ",\n  \"loops\": " << options.loops
+        << ",\n  \"rate_per_client\": " << options.ratePerClient << ",\n  \"payload_bytes\": " << options.payloadSize
+        << ",\n  \"connect_ms\": " << result.connectMs << ",\n  \"sent\": " << result.sent
+        << ",\n  \"received\": " << result.received << ",\n  \"rejected\": " << result.rejected
+        << ",\n  \"msgs_per_s\": " << result.messagesPerSecond << ",\n  \"p50_ms\": " << result.p50Ms
+        << ",\n  \"p90_ms\": " << result.p90Ms << ",\n  \"p99_ms\": " << result.p99Ms
+        << ",\n  \"max_ms\": " << result.maxMs << ",\n  \"cpu_us_per_msg\": " << result.cpuUsPerMessage
+        << ",\n  \"relay_in_process\": " << (result.relayInProcess ? "true" : "false") << "\n}\n";
+    return static_cast<bool>(file);
+  }
+
+  Options options;
+  QUrl url;
+  Result result;
+  QThread relayThread;
+  std::unique_ptr<QObject> relayHost;
+  Network::WebSocketServer *relay = nullptr;
+  std::vector<std::unique_ptr<Worker> > workers;
+  std::vector<std::unique_ptr<QThread> > threads;
+};
+
+#endif //LOADGENERATOR_H
@@ -0,0 +1,25 @@
+//
+// Created by deanprangenberg on 30.07.25.
+//
+
+#include <cstring>
+#include <iostream>
+#include "RatchetBenchmark.h"
+
+// ventra-bench [--quick] [--json <file>]
+int main(int argc, char *argv[]) {
+  RatchetBenchmark::Options options;
+
+  for (int i = 1; i < argc; ++i) {
+    if (std::strcmp(argv[i], "--quick") == 0) {
+      options.quick = true;
+    } else if (std::strcmp(argv[i], "--json") == 0 && i + 1 < argc) {
+      options.jsonPath = argv[++i];
+    } else {
+      std::cerr << "Usage: " << argv[0] << " [--quick] [--json <file>]" << std::endl;
+      return 2;
+    }
+  }
+
+  return RatchetBenchmark::run(options);
+}
@@ -0,0 +1,289 @@
+//
+// Created by deanprangenberg on 30.07.25.
+//
+
+#ifndef RATCHETBENCHMARK_H
+#define RATCHETBENCHMARK_H
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../../Shared/Crypto/DoubleRatchet/DoubleRatchet.h"
+#include "../../Shared/Crypto/KDF/KDFEnv.h"
+#include "../../Shared/Crypto/KeyEnv/KeyEnv.h"
+
+// Latency distribution of the DoubleRatchet hot paths, built as the ventra-bench target:
+// - packEncMessage / unpackDecMessage for 16 B to 1 MiB messages
+// - one symmetric chain step (the KDF call every message pays)
+// - one DH ratchet step (new keypair, X25519, root KDF)
+// - unpackDecMessage when messages arrive out of order and go through the skipped key store
+// Results are printed as a table and optionally written as JSON for regression tracking.
+class RatchetBenchmark {
+public:
+  struct Options {
+    bool quick = false;
+    std::string jsonPath;
+  };
+
+  static int run(const Options &options) {
+    RatchetBenchmark bench(options);
+    bench.runMessageSizes();
+    bench.runChainStep();
+    bench.runDhRatchet();
+    bench.runOutOfOrder();
+    bench.printTable();
+    if (!options.jsonPath.empty() && !bench.writeJson(options.jsonPath)) {
+      return 1;
+    }
+    return bench.failures == 0 ? 0 : 1;
+  }
+
+private:
+  struct Result {
+    std::string name;
+    size_t payloadSize = 0;
+    size_t samples = 0;
+    size_t failed = 0;
+    double meanNs = 0;
+    double p50Ns = 0;
+    double p90Ns = 0;
+    double p99Ns = 0;
+    double maxNs = 0;
+  };
+
+  struct Session {
+    std::unique_ptr<DoubleRatchet> alice;
+    std::unique_ptr<DoubleRatchet> bob;
+  };
+
+  using Clock = std::chrono::steady_clock;
+
+  explicit RatchetBenchmark(const Options &options) : options(options) {
+  }
+
+  static double elapsedNs(Clock::time_point start) {
+    return std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+  }
+
+  size_t scaled(size_t count) const {
+    return options.quick ? std::max<size_t>(count / 10, 10) : count;
+  }
+
+  static Session makeSession() {
+    auto bobKeyEnv = std::make_unique<Crypto::KeyEnv>(Crypto::KeyType::X25519Keypair);
+    bobKeyEnv->startKeyPairGeneration(true);
+    auto bobPubKey = bobKeyEnv->getPublicRaw();
+
+    Session session;
+    session.alice = std::make_unique<DoubleRatchet>(SessionType::DUO, ConstructType::INIT, nullptr, nullptr, bobPubKey);
+    session.bob = std::make_unique<DoubleRatchet>(SessionType::DUO, ConstructType::FOLLOWINIT, nullptr,
+                                                  std::move(bobKeyEnv), session.alice->ownPubKey());
+    return session;
+  }
+
+  void record(const std::string &name, size_t payloadSize, std::vector<double> &samplesNs, size_t failed) {
+    Result result;
+    result.name = name;
+    result.payloadSize = payloadSize;
+    result.samples = samplesNs.size();
+    result.failed = failed;
+    failures += failed;
+
+    if (!samplesNs.empty()) {
+      std::sort(samplesNs.begin(), samplesNs.end());
+      auto percentile = [&](double p) {
+        const size_t index = static_cast<size_t>(p * static_cast<double>(samplesNs.size() - 1) + 0.5);
+        return samplesNs[index];
+      };
+      double sum = 0;
+      for (double ns: samplesNs) sum += ns;
+      result.meanNs = sum / static_cast<double>(samplesNs.size());
+      result.p50Ns = percentile(0.50);
+      result.p90Ns = percentile(0.90);
+      result.p99Ns = percentile(0.99);
+      result.maxNs = samplesNs.back();
+    }
+    results.push_back(result);
+  }
+
+  void runMessageSizes() {
+    for (size_t payloadSize = 16; payloadSize <= 1024 * 1024; payloadSize *= 4) {
+      // About 32 MiB per size, bounded so small messages do not run forever
+      const size_t messages = scaled(std::clamp<size_t>(32 * 1024 * 1024 / payloadSize, 50, 5000));
+      const std::string plaintext(payloadSize, 'x');
+      Session session = makeSession();
+
+      std::vector<double> encryptNs, decryptNs;
+      encryptNs.reserve(messages);
+      decryptNs.reserve(messages);
+      size_t failed = 0;
+
+      for (size_t i = 0; i < messages; ++i) {
+        auto start = Clock::now();
+        const std::string package = session.alice->packEncMessage(plaintext);
+        encryptNs.push_back(elapsedNs(start));
+
+        start = Clock::now();
+        const std::string decrypted = session.bob->unpackDecMessage(package);
+        decryptNs.push_back(elapsedNs(start));
+
+        if (decrypted != plaintext) ++failed;
+      }
+
+      record("encrypt", payloadSize, encryptNs, 0);
+      record("decrypt", payloadSize, decryptNs, failed);
+    }
+  }
+
+  void runChainStep() {
+    // Same derivation as DoubleRatchet::symmetricRatchetStep
+    const size_t steps = scaled(20000);
+    Crypto::KDFEnv kdf(Crypto::KDFType::SHA3_512);
+    Crypto::Key32 chainKey{}, sharedSecret{};
+    chainKey.bytes.fill(0x11);
+    sharedSecret.bytes.fill(0x22);
+
+    std::vector<double> samplesNs;
+    samplesNs.reserve(steps);
+    size_t failed = 0;
+    for (size_t i = 0; i < steps; ++i) {
+      Crypto::Key64 out;
+      const auto start = Clock::now();
+      const bool ok = kdf.startKDF(chainKey.span(), sharedSecret.span(), "SendChainStep", out.span());
+      chainKey.assign(out.span().first<32>());
+      samplesNs.push_back(elapsedNs(start));
+      out.wipe();
+      if (!ok) ++failed;
+    }
+    record("chain_step", 0, samplesNs, failed);
+  }
+
+  void runDhRatchet() {
+    const size_t steps = scaled(1000);
+    Session session = makeSession();
+
+    // Peer keys are generated up front, only the ratchet step itself is timed
+    std::vector<std::vector<uint8_t> > peerKeys;
+    peerKeys.reserve(steps);
+    for (size_t i = 0; i < steps; ++i) {
+      Crypto::KeyEnv peer(Crypto::KeyType::X25519Keypair);
+      peer.startKeyPairGeneration(true);
+      peerKeys.push_back(peer.getPublicRaw());
+    }
+
+    std::vector<double> samplesNs;
+    samplesNs.reserve(steps);
+    size_t failed = 0;
+    for (const auto &peerKey: peerKeys) {
+      const auto start = Clock::now();
+      const bool ok = session.alice->updateRootKey(peerKey);
+      samplesNs.push_back(elapsedNs(start));
+      if (!ok) ++failed;
+    }
+    record("dh_ratchet", 0, samplesNs, failed);
+  }
+
+  void runOutOfOrder() {
+    constexpr size_t payloadSize = 256;
+    const size_t messages = scaled(2048);
+
+    std::vector<size_t> inOrder(messages);
+    for (size_t i = 0; i < messages; ++i) inOrder[i] = i;
+
+    // Every block of 16 arrives back to front
+    std::vector<size_t> reversedWindows = inOrder;
+    for (size_t i = 0; i < messages; i += 16) {
+      std::reverse(reversedWindows.begin() + i, reversedWindows.begin() + std::min(i + 16, messages));
+    }
+
+    // Random order inside windows of 64, fixed seed so runs are comparable
+    std::vector<size_t> shuffledWindows = inOrder;
+    std::mt19937 rng(42);
+    for (size_t i = 0; i < messages; i += 64) {
+      std::shuffle(shuffledWindows.begin() + i, shuffledWindows.begin() + std::min(i + 64, messages), rng);
+    }
+
+    // Every 8th message is held back and delivered after all others
+    std::vector<size_t> lateEighth;
+    for (size_t i = 0; i < messages; ++i) if (i % 8 != 0) lateEighth.push_back(i);
+    for (size_t i = 0; i < messages; i += 8) lateEighth.push_back(i);
+
+    runDeliveryPattern("ooo_in_order", payloadSize, inOrder);
+    runDeliveryPattern("ooo_reverse_16", payloadSize, reversedWindows);
+    runDeliveryPattern("ooo_shuffle_64", payloadSize, shuffledWindows);
+    runDeliveryPattern("ooo_late_every_8th", payloadSize, lateEighth);
+  }
+
+  void runDeliveryPattern(const std::string &name, size_t payloadSize, const std::vector<size_t> &order) {
+    Session session = makeSession();
+    session.bob->setSkippedKeyLimits(static_cast<uint32_t>(order.size()), order.size());
+
+    const std::string plaintext(payloadSize, 'x');
+    std::vector<std::string> packages;
+    packages.reserve(order.size());
+    for (size_t i = 0; i < order.size(); ++i) {
+      packages.push_back(session.alice->packEncMessage(plaintext));
+    }
+
+    std::vector<double> samplesNs;
+    samplesNs.reserve(order.size());
+    size_t failed = 0;
+    for (size_t index: order) {
+      const auto start = Clock::now();
+      const std::string decrypted = session.bob->unpackDecMessage(packages[index]);
+      samplesNs.push_back(elapsedNs(start));
+      if (decrypted != plaintext) ++failed;
+    }
+    record(name, payloadSize, samplesNs, failed);
+  }
+
+  void printTable() const {
+    std::cout << std::left << std::setw(20) << "case" << std::right << std::setw(10) << "bytes"
+        << std::setw(9) << "samples" << std::setw(12) << "mean us" << std::setw(12) << "p50 us"
+        << std::setw(12) << "p90 us" << std::setw(12) << "p99 us" << std::setw(12) << "max us"
+        << std::setw(8) << "failed" << std::endl;
+    std::cout << std::fixed << std::setprecision(2);
+    for (const auto &r: results) {
+      std::cout << std::left << std::setw(20) << r.name << std::right << std::setw(10) << r.payloadSize
+          << std::setw(9) << r.samples << std::setw(12) << r.meanNs / 1000 << std::setw(12) << r.p50Ns / 1000
+          << std::setw(12) << r.p90Ns / 1000 << std::setw(12) << r.p99Ns / 1000 << std::setw(12) << r.maxNs / 1000
+          << std::setw(8) << r.failed << std::endl;
+    }
+    std::cout << std::defaultfloat;
+  }
+
+  bool writeJson(const std::string &path) const {
+    std::ofstream file(path);
+    if (!file) {
+      std::cerr << "[RatchetBenchmark] Cannot write " << path << std::endl;
+      return false;
+    }
+
+    file << std::fixed << std::setprecision(1);
+    file << "{\n  \"aead\": \"" << Crypto::AeadRegistry::algorithmName(Crypto::AeadRegistry::getInstance().preferred())
+        << "\",\n  \"quick\": " << (options.quick ? "true" : "false") << ",\n  \"results\": [\n";
+    for (size_t i = 0; i < results.size(); ++i) {
+      const auto &r = results[i];
+      file << "    {\"name\": \"" << r.name << "\", \"bytes\": " << r.payloadSize << ", \"samples\": " << r.samples
+          << ", \"failed\": " << r.failed << ", \"mean_ns\": " << r.meanNs << ", \"p50_ns\": " << r.p50Ns
+          << ", \"p90_ns\": " << r.p90Ns << ", \"p99_ns\": " << r.p99Ns << ", \"max_ns\": " << r.maxNs << "}"
+          << (i + 1 < results.size() ? ",\n" : "\n");
+    }
+    file << "  ]\n}\n";
+    return static_cast<bool>(file);
+  }
+
+  Options options;
+  std::vector<Result> results;
+  size_t failures = 0;
+};
+
+#endif //RATCHETBENCHMARK_H
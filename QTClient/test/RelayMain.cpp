@@ -0,0 +1,27 @@
+//
+// Created by deanprangenberg on 02.08.25.
+//
+
+#include <QCoreApplication>
+#include <cstring>
+#include <iostream>
+#include "../../Shared/Network/WebSocketServer.h"
+
+// ventra-relay [--port n], default 8881 like the test clients in main.cpp
+int main(int argc, char *argv[]) {
+  QCoreApplication app(argc, argv);
+  quint16 port = 8881;
+
+  for (int i = 1; i < argc; ++i) {
+    if (std::strcmp(argv[i], "--port") == 0 && i + 1 < argc) {
+      port = static_cast<quint16>(std::atoi(argv[++i]));
+    } else {
+      std::cerr << "Usage: " << argv[0] << " [--port n]" << std::endl;
+      return 2;
+    }
+  }
+
+  Network::WebSocketServer relay(port);
+  if (!relay.isListening()) return 1;
+  return app.exec();
+}
@@ -1,7 +1,7 @@
 #include "DoubleRatchet.h"
+#include "../Log/CryptoLog.h"
+#include <openssl/rand.h>
 
-#define printHexDebug false
-#define printNormDebug true
 #define testAmount 1
 
 using namespace Crypto;
@@ -11,10 +11,12 @@ DoubleRatchet::DoubleRatchet(SessionType sessionType, ConstructType constructTyp
     : state(std::make_unique<RatchetState>()),
       ownKeyEnv(std::make_unique<KeyEnv>(KeyType::X25519Keypair)),
       theirKeyEnv(std::make_unique<KeyEnv>(KeyType::X25519Keypair)),
-      encryptionEnv(std::make_unique<EncryptionEnv>(EncAlgorithm::AES256)),
-      decryptionEnv(std::make_unique<EncryptionEnv>(EncAlgorithm::AES256)),
+      sendAead(AeadRegistry::getInstance().preferred()),
+      encryptionEnv(std::make_unique<EncryptionEnv>(sendAead)),
+      decryptionEnv(std::make_unique<EncryptionEnv>(sendAead)),
       kdfEnv(std::make_unique<KDFEnv>(KDFType::SHA3_512)),
-      hashingEnv(std::make_unique<HashingEnv>(HashAlgorithm::BLAKE2b512)) {
+      hashingEnv(std::make_unique<HashingEnv>(HashAlgorithm::BLAKE2b512)),
+      skippedKeys(std::make_unique<SkippedKeyStore>(defaultMaxStoredKeys)) {
 
     std::srand(static_cast<unsigned int>(std::time(nullptr)));
 
@@ -39,6 +41,17 @@ DoubleRatchet::DoubleRatchet(SessionType sessionType, ConstructType constructTyp
     }
 }
 
+DoubleRatchet::~DoubleRatchet() {
+  secureWipe(*state);
+}
+
+// Moves raw key bytes handed out by KeyEnv into fixed size storage and wipes the temporary
+static bool takeRawKey(Key32 &key, std::vector<uint8_t> raw) {
+  const bool ok = key.assign(raw);
+  OPENSSL_cleanse(raw.data(), raw.size());
+  return ok;
+}
+
 bool DoubleRatchet::setState(RatchetState *rs) {
   if (rs) {
     *state = *rs;
@@ -51,391 +64,405 @@ bool DoubleRatchet::importKeyEnv(std::unique_ptr<KeyEnv> keyEnv) {
   if (!keyEnv) return false;
   // Create a new KeyEnv instance instead of taking ownership
   ownKeyEnv = std::move(keyEnv);
-  state->ownPrivKey = ownKeyEnv->getPrivateRaw();
-  state->ownPubKey = ownKeyEnv->getPublicRaw();
-  return true;
+  return takeRawKey(state->ownPrivKey, ownKeyEnv->getPrivateRaw())
+         && takeRawKey(state->ownPubKey, ownKeyEnv->getPublicRaw());
 }
 
 bool DoubleRatchet::generateKeypair() {
   ownKeyEnv->startKeyPairGeneration(true);
-  state->ownPrivKey = ownKeyEnv->getPrivateRaw();
-  state->ownPubKey = ownKeyEnv->getPublicRaw();
-  if constexpr (printHexDebug) Converter::HexConverter::printBytesAsHex("[generateKeypair] PrivKey", state->ownPrivKey);
-  if constexpr (printHexDebug) Converter::HexConverter::printBytesAsHex("[generateKeypair] PubKey", state->ownPubKey);
+  if (!takeRawKey(state->ownPrivKey, ownKeyEnv->getPrivateRaw())
+      || !takeRawKey(state->ownPubKey, ownKeyEnv->getPublicRaw())) {
+    CRYPTO_LOG(Error, "generateKeypair", "Unexpected X25519 key size");
+    return false;
+  }
+  CRYPTO_LOG(Trace, "generateKeypair", "PrivKey=", CryptoLog::Hex{state->ownPrivKey.span()});
+  CRYPTO_LOG(Trace, "generateKeypair", "PubKey=", CryptoLog::Hex{state->ownPubKey.span()});
   return true;
 }
 
 bool DoubleRatchet::deriveSharedSecret(const std::vector<uint8_t> &theirPub) {
-  if (theirPub.size() != 32) {
-    if constexpr (printNormDebug) std::cerr << "[deriveSharedSecret] Invalid theirPub size=" << theirPub.size() << std::endl;
+  if (!state->theirPubKey.assign(theirPub)) {
+    CRYPTO_LOG(Error, "deriveSharedSecret", "Invalid theirPub size=", theirPub.size());
     return false;
   }
-  state->theirPubKey = theirPub;
   // Set the private key before deriving the shared secret
-  state->sharedSecret = ownKeyEnv->deriveSharedSecret(theirPub);
-  if constexpr (printHexDebug) Converter::HexConverter::printBytesAsHex("[deriveSharedSecret] theirPub", theirPub);
-  if constexpr (printHexDebug) Converter::HexConverter::printBytesAsHex("[deriveSharedSecret] sharedSecret", state->sharedSecret);
+  if (!takeRawKey(state->sharedSecret, ownKeyEnv->deriveSharedSecret(theirPub))) {
+    CRYPTO_LOG(Error, "deriveSharedSecret", "Unexpected shared secret size");
+    return false;
+  }
+  CRYPTO_LOG(Trace, "deriveSharedSecret", "theirPub=", CryptoLog::Hex{theirPub});
+  CRYPTO_LOG(Trace, "deriveSharedSecret", "sharedSecret=", CryptoLog::Hex{state->sharedSecret.span()});
   return true;
 }
 
 bool DoubleRatchet::initRootChain() {
-  if (state->sharedSecret.empty()) {
-    if constexpr (printNormDebug) std::cerr << "[initRootChain] Error: Empty shared secret" << std::endl;
+  if (state->sharedSecret.isZero()) {
+    CRYPTO_LOG(Error, "initRootChain", "Empty shared secret");
     return false;
   }
 
-  std::vector<uint8_t> salt(16);
+  std::array<uint8_t, 16> salt;
   for (size_t i = 0; i < 16; ++i) salt[i] = uint8_t(i);
 
-  state->rootKey.resize(32);
-  kdfEnv->startKDF(state->sharedSecret, salt, "InitialRootKey", state->rootKey, 32);
+  if (!kdfEnv->startKDF(state->sharedSecret.span(), salt, "InitialRootKey", state->rootKey.span())) {
+    CRYPTO_LOG(Error, "initRootChain", "KDF failed");
+    return false;
+  }
   state->sendChainKey = state->rootKey;
   state->recvChainKey = state->rootKey; // Initialize receive chain key as well
 
-  if constexpr (printHexDebug) Converter::HexConverter::printBytesAsHex("[initRootChain] rootKey", state->rootKey);
-  if constexpr (printHexDebug) Converter::HexConverter::printBytesAsHex("[initRootChain] sendChainKey", state->sendChainKey);
-  if constexpr (printHexDebug) Converter::HexConverter::printBytesAsHex("[initRootChain] recvChainKey", state->recvChainKey);
+  CRYPTO_LOG(Trace, "initRootChain", "rootKey=", CryptoLog::Hex{state->rootKey.span()});
+  CRYPTO_LOG(Trace, "initRootChain", "sendChainKey=", CryptoLog::Hex{state->sendChainKey.span()});
+  CRYPTO_LOG(Trace, "initRootChain", "recvChainKey=", CryptoLog::Hex{state->recvChainKey.span()});
   return true;
 }
 
 bool DoubleRatchet::initNewSession(const std::vector<uint8_t> &theirPub) {
-  if constexpr (printNormDebug) std::cerr << "[initNewSession] starting" << std::endl;
+  CRYPTO_LOG(Debug, "initNewSession", "starting");
   deriveSharedSecret(theirPub);
   return initRootChain();
 }
 
 bool DoubleRatchet::symmetricRatchetStep() {
-  const size_t OUTLEN = 64;
-  std::vector<uint8_t> out(OUTLEN);
+  // Chain key and message key come out of one derivation, all of it stays on the stack
+  Key64 out;
 
   // Check if sendChainKey is initialized
-  if (state->sendChainKey.empty()) {
-    if constexpr (printNormDebug) std::cerr << "[symmetricRatchetStep] Error: sendChainKey is empty" << std::endl;
+  if (state->sendChainKey.isZero()) {
+    CRYPTO_LOG(Error, "symmetricRatchetStep", "sendChainKey is empty");
     return false;
   }
 
   // Check if sharedSecret is initialized
-  if (state->sharedSecret.empty()) {
-    if constexpr (printNormDebug) std::cerr << "[symmetricRatchetStep] Error: sharedSecret is empty" << std::endl;
+  if (state->sharedSecret.isZero()) {
+    CRYPTO_LOG(Error, "symmetricRatchetStep", "sharedSecret is empty");
     return false;
   }
 
-  if (!kdfEnv->startKDF(state->sendChainKey, state->sharedSecret, "SendChainStep", out, OUTLEN)) {
-    if constexpr (printNormDebug) std::cerr << "[symmetricRatchetStep] KDF failed" << std::endl;
+  if (!kdfEnv->startKDF(state->sendChainKey.span(), state->sharedSecret.span(), "SendChainStep", out.span())) {
+    CRYPTO_LOG(Error, "symmetricRatchetStep", "KDF failed");
+    out.wipe();
     return false;
   }
-
-  std::vector<uint8_t> newChain(out.begin(), out.begin() + 32);
-  std::vector<uint8_t> msgKey(out.begin() + 32, out.end());
-  if constexpr (printHexDebug) Converter::HexConverter::printBytesAsHex("[symmetricRatchetStep] out", out);
-  if constexpr (printHexDebug) Converter::HexConverter::printBytesAsHex("[symmetricRatchetStep] newChain", newChain);
-  if constexpr (printHexDebug) Converter::HexConverter::printBytesAsHex("[symmetricRatchetStep] msgKey", msgKey);
+  CRYPTO_LOG(Trace, "symmetricRatchetStep", "out=", CryptoLog::Hex{out.span()});
 
   // Store the new chain key and message key
-  state->sendChainKey = std::move(newChain);
-  state->send_message_keys[state->send_msg_num] = std::move(msgKey);
-  if constexpr (printNormDebug) std::cerr << "[symmetricRatchetStep] msg_num=" << state->send_msg_num << std::endl;
+  state->sendChainKey.assign(out.span().first<32>());
+  state->sendMessageKey.assign(out.span().last<32>());
+  out.wipe();
+  CRYPTO_LOG(Debug, "symmetricRatchetStep", "msg_num=", state->send_msg_num);
   state->send_msg_num++;
   return true;
 }
 
-bool DoubleRatchet::receiveSymmetricRatchetStep(uint32_t msg_num) {
-  const size_t OUTLEN = 64;
-  std::vector<uint8_t> out(OUTLEN);
+bool DoubleRatchet::receiveSymmetricRatchetStep(Key32 &msgKey) {
+  Key64 out;
 
-  // Use sendChainKey instead of recvChainKey for symmetric operation
-  if (state->sendChainKey.empty()) {
-    if constexpr (printNormDebug) std::cerr << "[receiveSymmetricRatchetStep] Error: sendChainKey is empty" << std::endl;
+  if (state->recvChainKey.isZero()) {
+    CRYPTO_LOG(Error, "receiveSymmetricRatchetStep", "recvChainKey is empty");
     return false;
   }
 
-  if (state->sharedSecret.empty()) {
-    if constexpr (printNormDebug) std::cerr << "[receiveSymmetricRatchetStep] Error: sharedSecret is empty" << std::endl;
+  if (state->sharedSecret.isZero()) {
+    CRYPTO_LOG(Error, "receiveSymmetricRatchetStep", "sharedSecret is empty");
     return false;
   }
 
-  // Use same KDF parameters as in symmetricRatchetStep
-  if (!kdfEnv->startKDF(state->sendChainKey, state->sharedSecret, "SendChainStep", out, OUTLEN)) {
-    if constexpr (printNormDebug) std::cerr << "[receiveSymmetricRatchetStep] KDF failed" << std::endl;
+  // Same KDF parameters as the sender's symmetricRatchetStep
+  if (!kdfEnv->startKDF(state->recvChainKey.span(), state->sharedSecret.span(), "SendChainStep", out.span())) {
+    CRYPTO_LOG(Error, "receiveSymmetricRatchetStep", "KDF failed");
+    out.wipe();
     return false;
   }
 
-  std::vector<uint8_t> newChain(out.begin(), out.begin() + 32);
-  std::vector<uint8_t> msgKey(out.begin() + 32, out.end());
-
-  // Store the new chain key and message key
-  state->sendChainKey = std::move(newChain);
-  state->recv_message_keys[msg_num] = std::move(msgKey);
+  // Store the new chain key and hand out the message key
+  state->recvChainKey.assign(out.span().first<32>());
+  msgKey.assign(out.span().last<32>());
+  out.wipe();
 
   return true;
 }
 
-bool DoubleRatchet::encryptMessage(const std::vector<uint8_t> &msg,
-                                   std::vector<uint8_t> &cipher,
-                                   std::vector<uint8_t> &tag,
-                                   std::vector<uint8_t> &iv) {
-  if constexpr (printNormDebug) std::cerr << "[encryptMessage] plaintext size=" << msg.size() << std::endl;
-  if constexpr (printHexDebug) Converter::HexConverter::printBytesAsHex("[encryptMessage] plaintext", msg);
+bool DoubleRatchet::encryptMessage(std::span<const uint8_t> msg,
+                                   std::span<uint8_t> cipher,
+                                   std::span<uint8_t> tag,
+                                   std::span<const uint8_t> iv) {
+  CRYPTO_LOG(Debug, "encryptMessage", "plaintext size=", msg.size());
+  CRYPTO_LOG(Trace, "encryptMessage", "plaintext=", CryptoLog::Hex{msg});
 
   // Perform symmetric ratchet step to generate the message key
   if (!symmetricRatchetStep()) return false;
 
   // Get the message key that was just created
-  // Check if the key exists before accessing it
-  if (state->send_message_keys.find(state->send_msg_num - 1) == state->send_message_keys.end()) {
-    if constexpr (printNormDebug) std::cerr << "[encryptMessage] Error: Missing message key for send_msg_num=" << (state->send_msg_num - 1) <<
-        std::endl;
-    return false;
-  }
+  auto &key = state->sendMessageKey;
+  CRYPTO_LOG(Trace, "encryptMessage", "msgKey=", CryptoLog::Hex{key.span()});
 
-  auto &key = state->send_message_keys[state->send_msg_num - 1];
-  if constexpr (printHexDebug) Converter::HexConverter::printBytesAsHex("[encryptMessage] msgKey", key);
+  const bool sealed = encryptionEnv->seal(key.span(), iv, msg, cipher, tag);
+  // The message key is single use
+  key.wipe();
 
-  // Set up encryption environment
-  encryptionEnv->key = key;
-  encryptionEnv->iv = iv;
-  encryptionEnv->plaintext = msg;
-  encryptionEnv->ciphertext = cipher;
-  encryptionEnv->authTag = tag;
-
-  if (!encryptionEnv->startEncryption()) {
-    if constexpr (printNormDebug) std::cerr << "[encryptMessage] Encryption failed" << std::endl;
+  if (!sealed) {
+    CRYPTO_LOG(Error, "encryptMessage", "Encryption failed");
     return false;
   } else {
-    if constexpr (printNormDebug) std::cerr << "[encryptMessage] Encryption succeeded" << std::endl;
-    cipher = encryptionEnv->ciphertext;
-    tag = encryptionEnv->authTag;
+    CRYPTO_LOG(Debug, "encryptMessage", "Encryption succeeded");
   }
 
-  if constexpr (printHexDebug) Converter::HexConverter::printBytesAsHex("[encryptMessage] iv", encryptionEnv->iv);
-  if constexpr (printHexDebug) Converter::HexConverter::printBytesAsHex("[encryptMessage] cipher", cipher);
-  if constexpr (printHexDebug) Converter::HexConverter::printBytesAsHex("[encryptMessage] authTag", tag);
+  CRYPTO_LOG(Trace, "encryptMessage", "iv=", CryptoLog::Hex{iv});
+  CRYPTO_LOG(Trace, "encryptMessage", "cipher=", CryptoLog::Hex{cipher});
+  CRYPTO_LOG(Trace, "encryptMessage", "authTag=", CryptoLog::Hex{tag});
   return true;
 }
 
-bool DoubleRatchet::decryptMessage(const std::vector<uint8_t> &cipher,
-                                   std::vector<uint8_t> &msg,
-                                   const std::vector<uint8_t> &tag,
-                                   const std::vector<uint8_t> &iv,
+bool DoubleRatchet::decryptMessage(std::span<const uint8_t> cipher,
+                                   std::span<uint8_t> msg,
+                                   std::span<const uint8_t> tag,
+                                   std::span<const uint8_t> iv,
+                                   const Key32 &senderPubKey,
                                    uint32_t num) {
-  if constexpr (printNormDebug) std::cerr << "[decryptMessage] cipher size=" << cipher.size() << " iv size=" << iv.size() << " tag size=" << tag.
-      size() << " msgNum=" << num << std::endl;
-  if constexpr (printHexDebug) Converter::HexConverter::printBytesAsHex("[decryptMessage] cipher", cipher);
-  if constexpr (printHexDebug) Converter::HexConverter::printBytesAsHex("[decryptMessage] authTag", tag);
-  if constexpr (printHexDebug) Converter::HexConverter::printBytesAsHex("[decryptMessage] iv", iv);
+  CRYPTO_LOG(Debug, "decryptMessage", "cipher size=", cipher.size(), " iv size=", iv.size(), " tag size=", tag.size(), " msgNum=", num);
+  CRYPTO_LOG(Trace, "decryptMessage", "cipher=", CryptoLog::Hex{cipher});
+  CRYPTO_LOG(Trace, "decryptMessage", "authTag=", CryptoLog::Hex{tag});
+  CRYPTO_LOG(Trace, "decryptMessage", "iv=", CryptoLog::Hex{iv});
 
   // Generate message key if not already present
-  if (state->recv_message_keys.find(num) == state->recv_message_keys.end()) {
-    if constexpr (printNormDebug) std::cerr << "[decryptMessage] generating msgKey for num=" << num << std::endl;
-    if (!receiveSymmetricRatchetStep(num)) {
-      if constexpr (printNormDebug) std::cerr << "[decryptMessage] Failed to generate message key" << std::endl;
+  // Late messages find their key in the store, it is removed there on use
+  Key32 key;
+  Key32 chainBackup = state->recvChainKey;
+  const uint32_t numBackup = state->recv_msg_num;
+  const bool fromStore = skippedKeys->take(senderPubKey, num, key);
+  // Keys of the messages in between, stored only once this message proved to be authentic
+  std::vector<std::pair<uint32_t, Key32> > skipped;
+
+  if (!fromStore) {
+    if (num < state->recv_msg_num) {
+      CRYPTO_LOG(Warn, "decryptMessage", "msgNum=", num, " already received or its key was evicted");
+      return false;
+    }
+    if (num - state->recv_msg_num > maxSkip) {
+      CRYPTO_LOG(Warn, "decryptMessage", "msgNum=", num, " skips more than ", maxSkip, " messages");
       return false;
     }
+
+    CRYPTO_LOG(Debug, "decryptMessage", "generating msgKey for num=", num);
+    skipped.reserve(num - state->recv_msg_num);
+    while (state->recv_msg_num <= num) {
+      if (!receiveSymmetricRatchetStep(key)) {
+        CRYPTO_LOG(Warn, "decryptMessage", "Failed to generate message key");
+        state->recvChainKey = chainBackup;
+        state->recv_msg_num = numBackup;
+        for (auto &entry: skipped) entry.second.wipe();
+        key.wipe();
+        chainBackup.wipe();
+        return false;
+      }
+      if (state->recv_msg_num < num) {
+        skipped.emplace_back(state->recv_msg_num, key);
+      }
+      state->recv_msg_num++;
+    }
   }
 
-  auto &key = state->recv_message_keys[num];
-  if constexpr (printHexDebug) Converter::HexConverter::printBytesAsHex("[decryptMessage] msgKey", key);
+  CRYPTO_LOG(Trace, "decryptMessage", "msgKey=", CryptoLog::Hex{key.span()});
 
-  // Set up decryption environment
-  decryptionEnv->key = key;
-  decryptionEnv->iv = iv;
-  decryptionEnv->ciphertext = cipher;
-  decryptionEnv->authTag = tag;
-  decryptionEnv->plaintext = msg;
+  // Decrypt straight into the caller's buffer
+  const bool opened = decryptionEnv->open(key.span(), iv, cipher, tag, msg);
+  if (opened) {
+    for (const auto &[skippedNum, skippedKey]: skipped) {
+      skippedKeys->put(state->theirPubKey, skippedNum, skippedKey);
+    }
+  } else if (fromStore) {
+    skippedKeys->put(senderPubKey, num, key);
+  } else {
+    // The chain only moves for an authentic message, nothing it made us skip was stored
+    state->recvChainKey = chainBackup;
+    state->recv_msg_num = numBackup;
+  }
+  for (auto &entry: skipped) entry.second.wipe();
+  key.wipe();
+  chainBackup.wipe();
 
-  if (!decryptionEnv->startDecryption()) {
-    if constexpr (printNormDebug) std::cerr << "[decryptMessage] Decryption failed" << std::endl;
+  if (!opened) {
+    CRYPTO_LOG(Warn, "decryptMessage", "Decryption failed");
     return false;
   } else {
-    if constexpr (printNormDebug) std::cerr << "[decryptMessage] Decryption succeeded" << std::endl;
-    msg = decryptionEnv->plaintext;
+    CRYPTO_LOG(Debug, "decryptMessage", "Decryption succeeded");
   }
 
-  if constexpr (printHexDebug) Converter::HexConverter::printBytesAsHex("[decryptMessage] plaintext", msg);
+  CRYPTO_LOG(Trace, "decryptMessage", "plaintext=", CryptoLog::Hex{msg});
   return true;
 }
 
 std::string DoubleRatchet::packEncMessage(const std::string &plaintext) {
-  std::vector<uint8_t> msg(plaintext.begin(), plaintext.end()), cipher, tag;
-  if constexpr (printNormDebug) std::cerr << "[packEncMessage] plaintext '" << plaintext << "'" << std::endl;
+  CRYPTO_LOG(Trace, "packEncMessage", "plaintext '", plaintext, "'");
 
-  KeyEnv keyEnv(KeyType::KeyIv);
-  keyEnv.setKeyIvSizes(32, 12);
-  std::vector<uint8_t> iv;
-  std::vector<uint8_t> key;
-
-  if (!keyEnv.startKeyIvGeneration(key, iv)) {
+  if (state->ownPubKey.isZero() || state->theirPubKey.isZero()) {
+    CRYPTO_LOG(Error, "packEncMessage", "Ratchet keys not set");
     return "";
   }
 
-  if constexpr (printHexDebug) Converter::HexConverter::printBytesAsHex("[packEncMessage] generated iv", iv);
+  // The envelope is the only buffer, header fields and ciphertext are written into it in place
+  std::string out(RatchetEnvelope::sizeFor(plaintext.size()), '\0');
+  std::span<uint8_t> package(reinterpret_cast<uint8_t *>(out.data()), out.size());
 
-  if (!encryptMessage(msg, cipher, tag, iv)) {
-    if constexpr (printNormDebug) std::cerr << "[packEncMessage] encryption failed" << std::endl;
-    throw std::runtime_error("DoubleRatchet::packEncMessage: encryption failed");
-  }
+  // symmetricRatchetStep hands out the current number and then advances it
+  const uint32_t currentMsgNum = state->send_msg_num;
 
-  // Ensure the current message number is used
-  uint32_t currentMsgNum = state->send_msg_num - 1;
-
-  if constexpr (printNormDebug) std::cout << "iv size=" << iv.size() << std::endl;
-  if constexpr (printNormDebug) std::cout << "tag size=" << tag.size() << std::endl;
-  if constexpr (printNormDebug) std::cout << "ownPubKey size=" << state->ownPubKey.size() << std::endl;
-  if constexpr (printNormDebug) std::cout << "theirPubKey size=" << state->theirPubKey.size() << std::endl;
+  auto slots = RatchetEnvelope::writeHeader(package, AeadRegistry::algorithmId(sendAead), state->ownPubKey.span(),
+                                            state->theirPubKey.span(), currentMsgNum);
+  if (!slots) {
+    CRYPTO_LOG(Error, "packEncMessage", "Message too large, size=", plaintext.size());
+    return "";
+  }
 
-  if (iv.size() != 12 || tag.size() != 16 || state->ownPubKey.size() != 32 || state->theirPubKey.size() != 32) {
-    if constexpr (printNormDebug) std::cerr << "[packEncMessage] Error: Invalid header element sizes" << std::endl;
+  if (RAND_bytes(slots->iv.data(), static_cast<int>(slots->iv.size())) != 1) {
+    CRYPTO_LOG(Error, "packEncMessage", "IV generation failed");
     return "";
   }
+  CRYPTO_LOG(Trace, "packEncMessage", "generated iv=", CryptoLog::Hex{slots->iv});
+
+  std::span<const uint8_t> msg(reinterpret_cast<const uint8_t *>(plaintext.data()), plaintext.size());
+  if (!encryptMessage(msg, slots->cipher, slots->authTag, slots->iv)) {
+    CRYPTO_LOG(Error, "packEncMessage", "encryption failed");
+    throw std::runtime_error("DoubleRatchet::packEncMessage: encryption failed");
+  }
 
-  RatchetHeader hdr{
-    iv, tag, state->ownPubKey, state->theirPubKey, currentMsgNum,
-    static_cast<uint32_t>(msg.size())
-  };
-
-  if constexpr (printHexDebug) Converter::HexConverter::printBytesAsHex("[packEncMessage] hdr.iv", hdr.iv);
-  if constexpr (printHexDebug) Converter::HexConverter::printBytesAsHex("[packEncMessage] hdr.authTag", hdr.authTag);
-  if constexpr (printHexDebug) Converter::HexConverter::printBytesAsHex("[packEncMessage] hdr.SenderPubKey", hdr.SenderPubKey);
-  if constexpr (printHexDebug) Converter::HexConverter::printBytesAsHex("[packEncMessage] hdr.ReceiverPubKey", hdr.ReceiverPubKey);
-  if constexpr (printNormDebug) std::cerr << "[packEncMessage] hdr.sendMessageNum=" << hdr.sendMessageNum << std::endl;
-  if constexpr (printNormDebug) std::cerr << "[packEncMessage] hdr.messageLength=" << hdr.messageLength << std::endl;
-
-  std::string out;
-  out.insert(out.end(), hdr.iv.begin(), hdr.iv.end());
-  out.insert(out.end(), hdr.authTag.begin(), hdr.authTag.end());
-  out.insert(out.end(), hdr.SenderPubKey.begin(), hdr.SenderPubKey.end());
-  out.insert(out.end(), hdr.ReceiverPubKey.begin(), hdr.ReceiverPubKey.end());
-  out.append(reinterpret_cast<const char *>(&hdr.sendMessageNum), sizeof(uint32_t));
-  out.append(reinterpret_cast<const char *>(&hdr.messageLength), sizeof(uint32_t));
-  out.insert(out.end(), cipher.begin(), cipher.end());
+  CRYPTO_LOG(Debug, "packEncMessage", "sendMessageNum=", currentMsgNum, " messageLength=", plaintext.size());
   return out;
 }
 
 std::string DoubleRatchet::unpackDecMessage(const std::string &pkg) {
-  if (pkg.empty()) {
-    if constexpr (printNormDebug) std::cerr << "[unpackDecMessage] Error: Empty package" << std::endl;
-    return "";
-  }
+  return unpackDecMessage(std::span<const uint8_t>(reinterpret_cast<const uint8_t *>(pkg.data()), pkg.size()));
+}
 
-  if (pkg.length() < 100) {
-    // 12 (iv) + 16 (tag) + 32 (spk) + 32 (rpk) + 4 (num) + 4 (len)
-    if constexpr (printNormDebug) std::cerr << "[unpackDecMessage] Error: Package too short, size=" << pkg.length() << std::endl;
+std::string DoubleRatchet::unpackDecMessage(std::span<const uint8_t> pkg) {
+  auto parsed = RatchetEnvelope::parse(pkg);
+  if (!parsed) {
+    CRYPTO_LOG(Warn, "unpackDecMessage", "Malformed package, size=", pkg.size());
     return "";
   }
 
-  size_t pos = 0;
-  auto read = [&](size_t n) {
-    if (pos + n > pkg.length()) {
-      if constexpr (printNormDebug) std::cerr << "[unpackDecMessage] Error: Trying to read beyond package bounds" << std::endl;
-      return std::vector<uint8_t>();
-    }
-    auto v = std::vector<uint8_t>(pkg.begin() + pos, pkg.begin() + pos + n);
-    pos += n;
-    return v;
-  };
-
-  auto iv = read(12);
-  if (iv.empty()) return "";
-
-  auto tag = read(16);
-  if (tag.empty()) return "";
+  const RatchetEnvelopeView &envelope = *parsed;
 
-  auto spk = read(32);
-  if (spk.empty()) return "";
-
-  auto rpk = read(32);
-  if (rpk.empty()) return "";
-
-  if (pos + 8 > pkg.length()) {
-    if constexpr (printNormDebug) std::cerr << "[unpackDecMessage] Error: Package too short for message number and length" << std::endl;
+  auto peerAead = AeadRegistry::algorithmFromId(envelope.aeadId);
+  if (!peerAead) {
+    CRYPTO_LOG(Warn, "unpackDecMessage", "Unknown AEAD id");
     return "";
   }
 
-  uint32_t num, len;
-  std::memcpy(&num, pkg.data() + pos, 4);
-  pos += 4;
-  std::memcpy(&len, pkg.data() + pos, 4);
-  pos += 4;
-
-  if (pos > pkg.length()) {
-    if constexpr (printNormDebug) std::cerr << "[unpackDecMessage] Error: Package too short for cipher data" << std::endl;
-    return "";
+  // Always decrypt with the cipher the sender used
+  if (decryptionEnv->getAlgorithm() != *peerAead) {
+    decryptionEnv = std::make_unique<EncryptionEnv>(*peerAead);
   }
 
-  std::vector<uint8_t> cipher(pkg.begin() + pos, pkg.end());
-  if constexpr (printNormDebug) std::cerr << "[unpackDecMessage] num=" << num << " len=" << len << std::endl;
-  if constexpr (printHexDebug) Converter::HexConverter::printBytesAsHex("[unpackDecMessage] iv", iv);
-  if constexpr (printHexDebug) Converter::HexConverter::printBytesAsHex("[unpackDecMessage] tag", tag);
-  if constexpr (printHexDebug) Converter::HexConverter::printBytesAsHex("[unpackDecMessage] spk", spk);
+  CRYPTO_LOG(Debug, "unpackDecMessage", "num=", envelope.messageNum, " len=", envelope.cipher.size());
+  CRYPTO_LOG(Trace, "unpackDecMessage", "iv=", CryptoLog::Hex{envelope.iv});
+  CRYPTO_LOG(Trace, "unpackDecMessage", "tag=", CryptoLog::Hex{envelope.authTag});
+  CRYPTO_LOG(Trace, "unpackDecMessage", "spk=", CryptoLog::Hex{envelope.senderPubKey});
 
   // Check if we need to do an asymmetric ratchet step
-  if (spk != state->theirPubKey) {
-    if constexpr (printNormDebug) std::cerr << "[unpackDecMessage] Performing asymmetric ratchet step" << std::endl;
-    asymmetricRatchetStep(spk);
+  Key32 senderPubKey;
+  senderPubKey.assign(envelope.senderPubKey);
+  // senderPubKey is not authenticated before the message opens, the step is undone if it does not
+  RatchetState stateBackup{};
+  std::unique_ptr<KeyEnv> keyEnvBackup;
+  if (!(senderPubKey == state->theirPubKey) && !skippedKeys->contains(senderPubKey, envelope.messageNum)) {
+    CRYPTO_LOG(Debug, "unpackDecMessage", "Performing asymmetric ratchet step");
+    stateBackup = *state;
+    keyEnvBackup = std::move(ownKeyEnv);
+    ownKeyEnv = std::make_unique<KeyEnv>(KeyType::X25519Keypair);
+    asymmetricRatchetStep(senderPubKey.toVector());
   }
 
-  std::vector<uint8_t> out;
-  if (!decryptMessage(cipher, out, tag, iv, num)) {
-    if constexpr (printNormDebug) std::cerr << "[unpackDecMessage] Failed to decrypt message" << std::endl;
+  std::string out(envelope.cipher.size(), '\0');
+  std::span<uint8_t> msg(reinterpret_cast<uint8_t *>(out.data()), out.size());
+  const bool decrypted = decryptMessage(envelope.cipher, msg, envelope.authTag, envelope.iv, senderPubKey,
+                                        envelope.messageNum);
+  if (!decrypted && keyEnvBackup) {
+    *state = stateBackup;
+    ownKeyEnv = std::move(keyEnvBackup);
+  }
+  secureWipe(stateBackup);
+  if (!decrypted) {
+    CRYPTO_LOG(Warn, "unpackDecMessage", "Failed to decrypt message");
     return "";
   }
 
-  return std::string(out.begin(), out.end());
+  // Only an authenticated header may move the send side
+  adoptPeerAead(*peerAead);
+
+  return out;
+}
+
+void DoubleRatchet::adoptPeerAead(EncAlgorithm peerAead) {
+  auto agreed = AeadRegistry::negotiate(AeadRegistry::getInstance().preferred(), peerAead);
+  if (agreed != sendAead) {
+    CRYPTO_LOG(Debug, "adoptPeerAead", "Switching send side to ", AeadRegistry::algorithmName(agreed));
+    sendAead = agreed;
+    encryptionEnv = std::make_unique<EncryptionEnv>(sendAead);
+  }
+}
+
+void DoubleRatchet::setSkippedKeyLimits(uint32_t newMaxSkip, size_t maxStoredKeys) {
+  maxSkip = newMaxSkip;
+  skippedKeys = std::make_unique<SkippedKeyStore>(std::max<size_t>(maxStoredKeys, 2 * static_cast<size_t>(maxSkip)));
 }
 
 bool DoubleRatchet::updateRootKey(const std::vector<uint8_t> &newPubKey) {
-  if constexpr (printNormDebug) std::cerr << "[updateRootKey] newPubKey" << std::endl;
-  if constexpr (printHexDebug) Converter::HexConverter::printBytesAsHex("[updateRootKey] newPubKey", newPubKey);
+  CRYPTO_LOG(Debug, "updateRootKey", "newPubKey");
+  CRYPTO_LOG(Trace, "updateRootKey", "newPubKey=", CryptoLog::Hex{newPubKey});
 
   // Ensure the new public key is set before the asymmetric ratchet step
-  state->theirPubKey = newPubKey;
+  if (!state->theirPubKey.assign(newPubKey)) {
+    CRYPTO_LOG(Warn, "updateRootKey", "Invalid newPubKey size=", newPubKey.size());
+    return false;
+  }
 
   return asymmetricRatchetStep(newPubKey);
 }
 
 RatchetState *DoubleRatchet::getState() const {
-  if constexpr (printNormDebug) std::cerr << "[getState] send_msg_num=" << state->send_msg_num << " recv_msg_num=" << state->recv_msg_num <<
-      std::endl;
+  CRYPTO_LOG(Debug, "getState", "send_msg_num=", state->send_msg_num, " recv_msg_num=", state->recv_msg_num);
   return state.get();
 }
 
 std::vector<uint8_t> DoubleRatchet::ownPubKey() const {
-  if constexpr (printHexDebug) Converter::HexConverter::printBytesAsHex("[ownPubKey] ownPubKey", state->ownPubKey);
-  return state->ownPubKey;
+  CRYPTO_LOG(Trace, "ownPubKey", "ownPubKey=", CryptoLog::Hex{state->ownPubKey.span()});
+  return state->ownPubKey.toVector();
 }
 
 bool DoubleRatchet::asymmetricRatchetStep(const std::vector<uint8_t> &theirPub) {
-  if constexpr (printNormDebug) std::cerr << "[asymmetricRatchetStep] starting" << std::endl;
+  CRYPTO_LOG(Debug, "asymmetricRatchetStep", "starting");
 
-  if (theirPub.empty()) {
-    if constexpr (printNormDebug) std::cerr << "[asymmetricRatchetStep] Error: Empty theirPub" << std::endl;
+  if (theirPub.size() != Key32::keySize) {
+    CRYPTO_LOG(Error, "asymmetricRatchetStep", "Invalid theirPub size=", theirPub.size());
     return false;
   }
 
-  // Save current own key pair before generating a new one
-  std::vector<uint8_t> oldPrivKey = state->ownPrivKey;
-  std::vector<uint8_t> oldPubKey = state->ownPubKey;
-
   // Generate a new key pair
-  generateKeypair();
+  if (!generateKeypair()) return false;
 
   // Set the theirPubKey
-  state->theirPubKey = theirPub;
+  state->theirPubKey.assign(theirPub);
 
   // Derive the shared secret using our new private key and their public key
-  state->sharedSecret = ownKeyEnv->deriveSharedSecret(theirPub);
-  if constexpr (printHexDebug) Converter::HexConverter::printBytesAsHex("[asymmetricRatchetStep] sharedSecret", state->sharedSecret);
+  if (!takeRawKey(state->sharedSecret, ownKeyEnv->deriveSharedSecret(theirPub))) {
+    CRYPTO_LOG(Error, "asymmetricRatchetStep", "Unexpected shared secret size");
+    return false;
+  }
+  CRYPTO_LOG(Trace, "asymmetricRatchetStep", "sharedSecret=", CryptoLog::Hex{state->sharedSecret.span()});
 
   // Derive new root key
-  std::vector<uint8_t> newRoot(32);
-  if (!kdfEnv->startKDF(state->rootKey, state->sharedSecret, "DH-Ratchet-Update", newRoot, 32)) {
-    if constexpr (printNormDebug) std::cerr << "[asymmetricRatchetStep] KDF failed" << std::endl;
+  Key32 newRoot;
+  if (!kdfEnv->startKDF(state->rootKey.span(), state->sharedSecret.span(), "DH-Ratchet-Update", newRoot.span())) {
+    CRYPTO_LOG(Error, "asymmetricRatchetStep", "KDF failed");
     return false;
   }
-  if constexpr (printHexDebug) Converter::HexConverter::printBytesAsHex("[asymmetricRatchetStep] newRoot", newRoot);
+  CRYPTO_LOG(Trace, "asymmetricRatchetStep", "newRoot=", CryptoLog::Hex{newRoot.span()});
 
   // Update state
-  state->rootKey = std::move(newRoot);
+  state->rootKey = newRoot;
+  newRoot.wipe();
   state->sendChainKey = state->rootKey;
   state->recvChainKey = state->rootKey;
 
@@ -443,43 +470,39 @@ bool DoubleRatchet::asymmetricRatchetStep(const std::vector<uint8_t> &theirPub)
   state->send_msg_num = 0;
   state->recv_msg_num = 0;
 
-  if constexpr (printHexDebug) Converter::HexConverter::printBytesAsHex("[asymmetricRatchetStep] sendChainKey", state->sendChainKey);
-  if constexpr (printHexDebug) Converter::HexConverter::printBytesAsHex("[asymmetricRatchetStep] recvChainKey", state->recvChainKey);
+  CRYPTO_LOG(Trace, "asymmetricRatchetStep", "sendChainKey=", CryptoLog::Hex{state->sendChainKey.span()});
+  CRYPTO_LOG(Trace, "asymmetricRatchetStep", "recvChainKey=", CryptoLog::Hex{state->recvChainKey.span()});
   return true;
 }
 
 bool DoubleRatchet::testOneSideDoubleRatchet() {
-  if constexpr (printNormDebug) std::cerr << "[testDoubleRatchet] start" << std::endl;
+  CRYPTO_LOG(Debug, "testDoubleRatchet", "start");
 
   std::unique_ptr<KeyEnv> bobKeyEnv = std::make_unique<KeyEnv>(KeyType::X25519Keypair);
   bobKeyEnv->startKeyPairGeneration(true);
   auto bobPubKey = bobKeyEnv->getPublicRaw();
 
-  if constexpr (printNormDebug) std::cout << "[testDoubleRatchet] created Bob's KeyEnv and got public key" << std::endl;
-  if constexpr (printHexDebug) Converter::HexConverter::printBytesAsHex("[testDoubleRatchet] bobPubKey", bobPubKey);
+  CRYPTO_LOG(Debug, "testDoubleRatchet", "created Bob's KeyEnv and got public key");
+  CRYPTO_LOG(Trace, "testDoubleRatchet", "bobPubKey=", CryptoLog::Hex{bobPubKey});
 
   DoubleRatchet alice(SessionType::DUO, ConstructType::INIT, nullptr, nullptr, bobPubKey);
-  if constexpr (printNormDebug) std::cout << "[testDoubleRatchet] created test alice" << std::endl;
+  CRYPTO_LOG(Debug, "testDoubleRatchet", "created test alice");
 
   // Get Alice's public key
   auto alicePubKey = alice.ownPubKey();
-  if constexpr (printHexDebug) Converter::HexConverter::printBytesAsHex("[testDoubleRatchet] alicePubKey", alicePubKey);
+  CRYPTO_LOG(Trace, "testDoubleRatchet", "alicePubKey=", CryptoLog::Hex{alicePubKey});
 
   // Create Bob with Alice's pubkey
   DoubleRatchet bob(SessionType::DUO, ConstructType::FOLLOWINIT, nullptr, std::move(bobKeyEnv), alicePubKey);
-  if constexpr (printNormDebug) std::cout << "[testDoubleRatchet] created test bob" << std::endl;
+  CRYPTO_LOG(Debug, "testDoubleRatchet", "created test bob");
 
   // Now the shared secrets should match
   if (alice.getState()->sharedSecret == bob.getState()->sharedSecret) {
-    if constexpr (printNormDebug) std::cerr << "[testDoubleRatchet] shared secrets match" << std::endl;
+    CRYPTO_LOG(Debug, "testDoubleRatchet", "shared secrets match");
   } else {
-    if constexpr (printNormDebug) std::cerr << "[testDoubleRatchet] shared secrets do not match" << std::endl;
-    if constexpr (printHexDebug)
-      Converter::HexConverter::printBytesAsHex("[testDoubleRatchet] alice sharedSecret",
-                                   alice.getState()->sharedSecret);
-    if constexpr (printHexDebug)
-      Converter::HexConverter::printBytesAsHex("[testDoubleRatchet] bob sharedSecret",
-                                   bob.getState()->sharedSecret);
+    CRYPTO_LOG(Warn, "testDoubleRatchet", "shared secrets do not match");
+    CRYPTO_LOG(Trace, "testDoubleRatchet", "alice sharedSecret=", CryptoLog::Hex{alice.getState()->sharedSecret.span()});
+    CRYPTO_LOG(Trace, "testDoubleRatchet", "bob sharedSecret=", CryptoLog::Hex{bob.getState()->sharedSecret.span()});
     return false;
   }
 
@@ -487,28 +510,28 @@ bool DoubleRatchet::testOneSideDoubleRatchet() {
   bool ok = true;
   for (size_t i = 0; i < testAmount; ++i) {
     std::string msg = "Test Nachricht: " + std::to_string(i);
-    if constexpr (printNormDebug) std::cerr << "[testDoubleRatchet] encrypting message: " << msg << std::endl;
+    CRYPTO_LOG(Debug, "testDoubleRatchet", "encrypting message: ", msg);
 
     try {
       auto pkg = alice.packEncMessage(msg);
       if (pkg == "") {
-        if constexpr (printNormDebug) std::cerr << "[testDoubleRatchet] Error: empty package" << std::endl;
+        CRYPTO_LOG(Warn, "testDoubleRatchet", "empty package");
         ok = false;
         continue;
       }
-      if constexpr (printNormDebug) std::cout << "[testDoubleRatchet] encrypted message, package size: " << pkg.size() << std::endl;
+      CRYPTO_LOG(Debug, "testDoubleRatchet", "encrypted message, package size: ", pkg.size());
 
       auto dec = bob.unpackDecMessage(pkg);
-      if constexpr (printNormDebug) std::cout << "[testDoubleRatchet] decrypted message: " << dec << std::endl;
+      CRYPTO_LOG(Debug, "testDoubleRatchet", "decrypted message: ", dec);
 
       if (dec != msg) {
-        if constexpr (printNormDebug) std::cerr << "[testDoubleRatchet] Error: decrypted message does not match original" << std::endl;
+        CRYPTO_LOG(Warn, "testDoubleRatchet", "decrypted message does not match original");
         ok = false;
       } else {
-        if constexpr (printNormDebug) std::cerr << "[testDoubleRatchet] Success: message correctly encrypted and decrypted" << std::endl;
+        CRYPTO_LOG(Debug, "testDoubleRatchet", "Success: message correctly encrypted and decrypted");
       }
     } catch (const std::exception &e) {
-      if constexpr (printNormDebug) std::cerr << "[testDoubleRatchet] Exception: " << e.what() << std::endl;
+      CRYPTO_LOG(Warn, "testDoubleRatchet", "Exception: ", e.what());
       ok = false;
     }
   }
@@ -517,37 +540,33 @@ bool DoubleRatchet::testOneSideDoubleRatchet() {
 }
 
 bool DoubleRatchet::testMixedDoubleRatchet() {
-  if constexpr (printNormDebug) std::cerr << "[testDoubleRatchet] start" << std::endl;
+  CRYPTO_LOG(Debug, "testDoubleRatchet", "start");
 
   std::unique_ptr<KeyEnv> bobKeyEnv = std::make_unique<KeyEnv>(KeyType::X25519Keypair);
   bobKeyEnv->startKeyPairGeneration(true);
   auto bobPubKey = bobKeyEnv->getPublicRaw();
 
-  if constexpr (printNormDebug) std::cout << "[testDoubleRatchet] created Bob's KeyEnv and got public key" << std::endl;
-  if constexpr (printHexDebug) Converter::HexConverter::printBytesAsHex("[testDoubleRatchet] bobPubKey", bobPubKey);
+  CRYPTO_LOG(Debug, "testDoubleRatchet", "created Bob's KeyEnv and got public key");
+  CRYPTO_LOG(Trace, "testDoubleRatchet", "bobPubKey=", CryptoLog::Hex{bobPubKey});
 
   DoubleRatchet alice(SessionType::DUO, ConstructType::INIT, nullptr, nullptr, bobPubKey);
-  if constexpr (printNormDebug) std::cout << "[testDoubleRatchet] created test alice" << std::endl;
+  CRYPTO_LOG(Debug, "testDoubleRatchet", "created test alice");
 
   // Get Alice's public key
   auto alicePubKey = alice.ownPubKey();
-  if constexpr (printHexDebug) Converter::HexConverter::printBytesAsHex("[testDoubleRatchet] alicePubKey", alicePubKey);
+  CRYPTO_LOG(Trace, "testDoubleRatchet", "alicePubKey=", CryptoLog::Hex{alicePubKey});
 
   // Create Bob with Alice's pubkey
   DoubleRatchet bob(SessionType::DUO, ConstructType::FOLLOWINIT, nullptr, std::move(bobKeyEnv), alicePubKey);
-  if constexpr (printNormDebug) std::cout << "[testDoubleRatchet] created test bob" << std::endl;
+  CRYPTO_LOG(Debug, "testDoubleRatchet", "created test bob");
 
   // Now the shared secrets should match
   if (alice.getState()->sharedSecret == bob.getState()->sharedSecret) {
-    if constexpr (printNormDebug) std::cerr << "[testDoubleRatchet] shared secrets match" << std::endl;
+    CRYPTO_LOG(Debug, "testDoubleRatchet", "shared secrets match");
   } else {
-    if constexpr (printNormDebug) std::cerr << "[testDoubleRatchet] shared secrets do not match" << std::endl;
-    if constexpr (printHexDebug)
-      Converter::HexConverter::printBytesAsHex("[testDoubleRatchet] alice sharedSecret",
-                                   alice.getState()->sharedSecret);
-    if constexpr (printHexDebug)
-      Converter::HexConverter::printBytesAsHex("[testDoubleRatchet] bob sharedSecret",
-                                   bob.getState()->sharedSecret);
+    CRYPTO_LOG(Warn, "testDoubleRatchet", "shared secrets do not match");
+    CRYPTO_LOG(Trace, "testDoubleRatchet", "alice sharedSecret=", CryptoLog::Hex{alice.getState()->sharedSecret.span()});
+    CRYPTO_LOG(Trace, "testDoubleRatchet", "bob sharedSecret=", CryptoLog::Hex{bob.getState()->sharedSecret.span()});
     return false;
   }
 
@@ -555,43 +574,43 @@ bool DoubleRatchet::testMixedDoubleRatchet() {
   bool ok = true;
   for (size_t i = 0; i < testAmount; ++i) {
     std::string msg = "Test Nachricht: " + std::to_string(i);
-    if constexpr (printNormDebug) std::cerr << "[testDoubleRatchet] encrypting message: " << msg << std::endl;
+    CRYPTO_LOG(Debug, "testDoubleRatchet", "encrypting message: ", msg);
 
     try {
       std::string dec;
       if (i % 2 == 0) {
         auto pkg = alice.packEncMessage(msg);
         if (pkg == "") {
-          if constexpr (printNormDebug) std::cerr << "[testDoubleRatchet] Error: empty package" << std::endl;
+          CRYPTO_LOG(Warn, "testDoubleRatchet", "empty package");
           ok = false;
           continue;
         }
-        if constexpr (printNormDebug) std::cout << "[testDoubleRatchet] encrypted message, package size: " << pkg.size() << std::endl;
+        CRYPTO_LOG(Debug, "testDoubleRatchet", "encrypted message, package size: ", pkg.size());
 
         dec = bob.unpackDecMessage(pkg);
-        if constexpr (printNormDebug) std::cout << "[testDoubleRatchet] decrypted message: " << dec << std::endl;
+        CRYPTO_LOG(Debug, "testDoubleRatchet", "decrypted message: ", dec);
       } else {
         auto pkg = bob.packEncMessage(msg);
         if (pkg == "") {
-          if constexpr (printNormDebug) std::cerr << "[testDoubleRatchet] Error: empty package" << std::endl;
+          CRYPTO_LOG(Warn, "testDoubleRatchet", "empty package");
           ok = false;
           continue;
         }
-        if constexpr (printNormDebug) std::cout << "[testDoubleRatchet] encrypted message, package size: " << pkg.size() << std::endl;
+        CRYPTO_LOG(Debug, "testDoubleRatchet", "encrypted message, package size: ", pkg.size());
 
         dec = alice.unpackDecMessage(pkg);
-        if constexpr (printNormDebug) std::cout << "[testDoubleRatchet] decrypted message: " << dec << std::endl;
+        CRYPTO_LOG(Debug, "testDoubleRatchet", "decrypted message: ", dec);
       }
 
 
       if (dec != msg) {
-        if constexpr (printNormDebug) std::cerr << "[testDoubleRatchet] Error: decrypted message does not match original" << std::endl;
+        CRYPTO_LOG(Warn, "testDoubleRatchet", "decrypted message does not match original");
         ok = false;
       } else {
-        if constexpr (printNormDebug) std::cerr << "[testDoubleRatchet] Success: message correctly encrypted and decrypted" << std::endl;
+        CRYPTO_LOG(Debug, "testDoubleRatchet", "Success: message correctly encrypted and decrypted");
       }
     } catch (const std::exception &e) {
-      if constexpr (printNormDebug) std::cerr << "[testDoubleRatchet] Exception: " << e.what() << std::endl;
+      CRYPTO_LOG(Warn, "testDoubleRatchet", "Exception: ", e.what());
       ok = false;
     }
   }
@@ -1,14 +1,17 @@
 #ifndef DOUBLERATCHET_H
 #define DOUBLERATCHET_H
 
-#include <map>
 #include <vector>
 #include <string>
 #include <memory>
 #include <iomanip>
 #include "../../Converter/HexConverter.h"
 #include "../KeyEnv/KeyEnv.h"
+#include "../KeyEnv/SecureKey.h"
+#include "SkippedKeyStore.h"
+#include "RatchetEnvelope.h"
 #include "../Encryption/EncryptionEnv.h"
+#include "../Encryption/AeadRegistry.h"
 #include "../KDF/KDFEnv.h"
 #include "../Hash/HashingEnv.h"
 
@@ -17,32 +20,27 @@ enum class ConstructType { INIT, EXISTING, FOLLOWINIT };
 
 enum class SessionType { DUO, MULTI };
 
-struct RatchetHeader {
-  std::vector<uint8_t> iv;
-  std::vector<uint8_t> authTag;
-  std::vector<uint8_t> SenderPubKey;
-  std::vector<uint8_t> ReceiverPubKey;
-  uint32_t sendMessageNum;
-  uint32_t messageLength;
-};
-
+// Flat and trivially copyable, a session can be stored and restored as raw bytes. Unset keys are
+// all zero. Holds secrets, wipe it with Crypto::secureWipe when a copy is no longer needed.
 struct RatchetState {
   SessionType sessionType;
-  std::vector<uint8_t> sharedSecret;
-  std::vector<uint8_t> rootKey;
-  std::vector<uint8_t> ownPrivKey;
-  std::vector<uint8_t> ownPubKey;
-  std::vector<uint8_t> theirPubKey;
-
-  std::vector<uint8_t> sendChainKey;
-  std::map<uint32_t, std::vector<uint8_t> > send_message_keys;
-  uint32_t send_msg_num = 0;
-
-  std::vector<uint8_t> recvChainKey;
-  std::map<uint32_t, std::vector<uint8_t> > recv_message_keys;
-  uint32_t recv_msg_num = 0;
+  Crypto::Key32 sharedSecret;
+  Crypto::Key32 rootKey;
+  Crypto::Key32 ownPrivKey;
+  Crypto::Key32 ownPubKey;
+  Crypto::Key32 theirPubKey;
+
+  Crypto::Key32 sendChainKey;
+  // Key of the last sent message, only needed until that message is encrypted
+  Crypto::Key32 sendMessageKey;
+  uint32_t send_msg_num;
+
+  Crypto::Key32 recvChainKey;
+  uint32_t recv_msg_num;
 };
 
+static_assert(std::is_trivially_copyable_v<RatchetState> && std::is_standard_layout_v<RatchetState>);
+
 class DoubleRatchet {
 public:
   // Construction
@@ -52,6 +50,8 @@ public:
                 std::unique_ptr<Crypto::KeyEnv> keyEnv = nullptr,
                 const std::vector<uint8_t> &theirPubKey = {});
 
+  ~DoubleRatchet();
+
   // Manual initialization:
   // 1) Generate keypair
   bool generateKeypair();
@@ -66,16 +66,26 @@ public:
   // Updates the root key and performs an asymmetric ratchet step using the provided public key.
   bool updateRootKey(const std::vector<uint8_t> &newPubKey);
 
-  // Message package
+  // Message package, see Crypto::RatchetEnvelope for the layout
   std::string packEncMessage(const std::string &plaintext);
 
   std::string unpackDecMessage(const std::string &package);
 
+  std::string unpackDecMessage(std::span<const uint8_t> package);
+
   // Access to State
   RatchetState *getState() const;
 
   std::vector<uint8_t> ownPubKey() const;
 
+  // maxSkip bounds how far ahead of the next expected message a received number may be,
+  // maxStoredKeys how many keys of skipped messages are kept for late delivery. The store holds
+  // at least twice maxSkip keys, so a single jump cannot evict every key of an earlier one.
+  void setSkippedKeyLimits(uint32_t maxSkip, size_t maxStoredKeys);
+
+  static constexpr uint32_t defaultMaxSkip = 1000;
+  static constexpr size_t defaultMaxStoredKeys = 2 * defaultMaxSkip;
+
   static bool testOneSideDoubleRatchet();
 
   static bool testMixedDoubleRatchet();
@@ -87,16 +97,18 @@ private:
 
   bool importKeyEnv(std::unique_ptr<Crypto::KeyEnv> keyEnv);
 
-  bool encryptMessage(const std::vector<uint8_t> &message,
-                      std::vector<uint8_t> &ciphertext,
-                      std::vector<uint8_t> &authTag,
-                      std::vector<uint8_t> &iv
+  // ciphertext and message are the same size, both point into the caller's buffers
+  bool encryptMessage(std::span<const uint8_t> message,
+                      std::span<uint8_t> ciphertext,
+                      std::span<uint8_t> authTag,
+                      std::span<const uint8_t> iv
   );
 
-  bool decryptMessage(const std::vector<uint8_t> &ciphertext,
-                      std::vector<uint8_t> &message,
-                      const std::vector<uint8_t> &authTag,
-                      const std::vector<uint8_t> &iv,
+  bool decryptMessage(std::span<const uint8_t> ciphertext,
+                      std::span<uint8_t> message,
+                      std::span<const uint8_t> authTag,
+                      std::span<const uint8_t> iv,
+                      const Crypto::Key32 &senderPubKey,
                       uint32_t sendMessageNum
   );
 
@@ -107,16 +119,23 @@ private:
 
   bool symmetricRatchetStep();
 
-  bool receiveSymmetricRatchetStep(uint32_t msg_num); // New function for receive chain
+  // Settles the send side on the cipher negotiated with the peer's choice
+  void adoptPeerAead(Crypto::EncAlgorithm peerAead);
+
+  bool receiveSymmetricRatchetStep(Crypto::Key32 &msgKey); // New function for receive chain
   bool asymmetricRatchetStep(const std::vector<uint8_t> &theirPub);
 
   std::unique_ptr<RatchetState> state;
   std::unique_ptr<Crypto::KeyEnv> ownKeyEnv;
   std::unique_ptr<Crypto::KeyEnv> theirKeyEnv;
+  Crypto::EncAlgorithm sendAead;
   std::unique_ptr<Crypto::EncryptionEnv> encryptionEnv;
   std::unique_ptr<Crypto::EncryptionEnv> decryptionEnv;
   std::unique_ptr<Crypto::KDFEnv> kdfEnv;
   std::unique_ptr<Crypto::HashingEnv> hashingEnv;
+  // Keys of skipped messages, not part of the flat state
+  std::unique_ptr<Crypto::SkippedKeyStore> skippedKeys;
+  uint32_t maxSkip = defaultMaxSkip;
 };
 
 #endif // DOUBLERATCHET_H
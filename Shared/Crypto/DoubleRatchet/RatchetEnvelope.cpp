@@ -0,0 +1,78 @@
+//
+// Created by deanprangenberg on 29.07.25.
+//
+
+#include "RatchetEnvelope.h"
+#include <cstring>
+
+namespace Crypto {
+  namespace {
+    constexpr size_t versionOffset = 0;
+    constexpr size_t aeadOffset = 1;
+    constexpr size_t ivOffset = 2;
+    constexpr size_t tagOffset = ivOffset + RatchetEnvelope::ivSize;
+    constexpr size_t senderOffset = tagOffset + RatchetEnvelope::tagSize;
+    constexpr size_t receiverOffset = senderOffset + RatchetEnvelope::pubKeySize;
+    constexpr size_t numOffset = receiverOffset + RatchetEnvelope::pubKeySize;
+    constexpr size_t lengthOffset = numOffset + 4;
+
+    static_assert(lengthOffset + 4 == RatchetEnvelope::headerSize);
+  }
+
+  std::optional<RatchetEnvelopeView> RatchetEnvelope::parse(std::span<const uint8_t> package) {
+    if (package.size() < headerSize || package[versionOffset] != currentVersion) {
+      return std::nullopt;
+    }
+
+    const uint32_t cipherLength = readU32(package.data() + lengthOffset);
+    if (cipherLength != package.size() - headerSize) {
+      return std::nullopt;
+    }
+
+    return RatchetEnvelopeView{
+      package[versionOffset],
+      package[aeadOffset],
+      package.subspan<ivOffset, ivSize>(),
+      package.subspan<tagOffset, tagSize>(),
+      package.subspan<senderOffset, pubKeySize>(),
+      package.subspan<receiverOffset, pubKeySize>(),
+      readU32(package.data() + numOffset),
+      package.subspan(headerSize)
+    };
+  }
+
+  std::optional<RatchetEnvelopeSlots> RatchetEnvelope::writeHeader(std::span<uint8_t> package,
+                                                                   uint8_t aeadId,
+                                                                   std::span<const uint8_t, 32> senderPubKey,
+                                                                   std::span<const uint8_t, 32> receiverPubKey,
+                                                                   uint32_t messageNum) {
+    if (package.size() < headerSize || package.size() - headerSize > UINT32_MAX) {
+      return std::nullopt;
+    }
+
+    package[versionOffset] = currentVersion;
+    package[aeadOffset] = aeadId;
+    std::memcpy(package.data() + senderOffset, senderPubKey.data(), pubKeySize);
+    std::memcpy(package.data() + receiverOffset, receiverPubKey.data(), pubKeySize);
+    writeU32(package.data() + numOffset, messageNum);
+    writeU32(package.data() + lengthOffset, static_cast<uint32_t>(package.size() - headerSize));
+
+    return RatchetEnvelopeSlots{
+      package.subspan<ivOffset, ivSize>(), package.subspan<tagOffset, tagSize>(), package.subspan(headerSize)
+    };
+  }
+
+  uint32_t RatchetEnvelope::readU32(const uint8_t *in) {
+    return static_cast<uint32_t>(in[0])
+           | static_cast<uint32_t>(in[1]) << 8
+           | static_cast<uint32_t>(in[2]) << 16
+           | static_cast<uint32_t>(in[3]) << 24;
+  }
+
+  void RatchetEnvelope::writeU32(uint8_t *out, uint32_t value) {
+    out[0] = static_cast<uint8_t>(value);
+    out[1] = static_cast<uint8_t>(value >> 8);
+    out[2] = static_cast<uint8_t>(value >> 16);
+    out[3] = static_cast<uint8_t>(value >> 24);
+  }
+} // Crypto
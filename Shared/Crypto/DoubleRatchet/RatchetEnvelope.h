@@ -0,0 +1,65 @@
+//
+// Created by deanprangenberg on 29.07.25.
+//
+
+#ifndef RATCHETENVELOPE_H
+#define RATCHETENVELOPE_H
+
+#include <cstdint>
+#include <optional>
+#include <span>
+
+namespace Crypto {
+  // Wire format of one ratchet message, all integers little endian:
+  //
+  //   version(1) | aeadId(1) | iv(12) | tag(16) | senderPubKey(32) | receiverPubKey(32)
+  //   | messageNum(4) | cipherLength(4) | cipher(cipherLength)
+  //
+  // The header has a fixed size, so fields are read in place. cipherLength has to match the rest
+  // of the package exactly, trailing bytes are rejected.
+  struct RatchetEnvelopeView {
+    uint8_t version;
+    uint8_t aeadId;
+    std::span<const uint8_t, 12> iv;
+    std::span<const uint8_t, 16> authTag;
+    std::span<const uint8_t, 32> senderPubKey;
+    std::span<const uint8_t, 32> receiverPubKey;
+    uint32_t messageNum;
+    std::span<const uint8_t> cipher;
+  };
+
+  // Writable regions of an envelope being built, the caller fills iv, tag and cipher in place
+  struct RatchetEnvelopeSlots {
+    std::span<uint8_t, 12> iv;
+    std::span<uint8_t, 16> authTag;
+    std::span<uint8_t> cipher;
+  };
+
+  class RatchetEnvelope {
+  public:
+    static constexpr uint8_t currentVersion = 1;
+    static constexpr size_t ivSize = 12;
+    static constexpr size_t tagSize = 16;
+    static constexpr size_t pubKeySize = 32;
+    static constexpr size_t headerSize = 1 + 1 + ivSize + tagSize + 2 * pubKeySize + 4 + 4;
+
+    static constexpr size_t sizeFor(size_t cipherLength) { return headerSize + cipherLength; }
+
+    // Views into package, valid as long as package is. nullopt on malformed input or an unknown version.
+    static std::optional<RatchetEnvelopeView> parse(std::span<const uint8_t> package);
+
+    // package must hold exactly sizeFor(cipherLength) bytes, nullopt if it cannot
+    static std::optional<RatchetEnvelopeSlots> writeHeader(std::span<uint8_t> package,
+                                                           uint8_t aeadId,
+                                                           std::span<const uint8_t, 32> senderPubKey,
+                                                           std::span<const uint8_t, 32> receiverPubKey,
+                                                           uint32_t messageNum);
+
+  private:
+    static uint32_t readU32(const uint8_t *in);
+
+    static void writeU32(uint8_t *out, uint32_t value);
+  };
+} // Crypto
+
+#endif //RATCHETENVELOPE_H
@@ -0,0 +1,121 @@
+//
+// Created by deanprangenberg on 29.07.25.
+//
+
+#include "SkippedKeyStore.h"
+#include <algorithm>
+#include <bit>
+#include <cstring>
+
+namespace Crypto {
+  SkippedKeyStore::SkippedKeyStore(size_t capacity)
+    : entries(std::max<size_t>(capacity, 1)) {
+    // At most half of the index is ever live, probes always hit an empty slot quickly
+    index.assign(std::bit_ceil(entries.size() * 2), emptySlot);
+    indexMask = index.size() - 1;
+  }
+
+  SkippedKeyStore::~SkippedKeyStore() {
+    OPENSSL_cleanse(entries.data(), entries.size() * sizeof(Entry));
+  }
+
+  void SkippedKeyStore::put(const Key32 &ratchetPubKey, uint32_t messageNum, const Key32 &messageKey) {
+    if (int64_t existing = findSlot(ratchetPubKey, messageNum); existing >= 0) {
+      entries[index[existing]].messageKey = messageKey;
+      return;
+    }
+
+    const size_t entrySlot = nextEntry;
+    if (entries[entrySlot].live) {
+      // Oldest entry in the ring, its message is most likely lost
+      removeEntry(findSlot(entries[entrySlot].ratchetPubKey, entries[entrySlot].messageNum));
+      ++evictedEntries;
+    }
+
+    Entry &entry = entries[entrySlot];
+    entry.ratchetPubKey = ratchetPubKey;
+    entry.messageKey = messageKey;
+    entry.messageNum = messageNum;
+    entry.live = true;
+
+    size_t slot = hashOf(ratchetPubKey, messageNum);
+    while (index[slot] >= 0) {
+      slot = (slot + 1) & indexMask;
+    }
+    if (index[slot] == deletedSlot) --deletedSlots;
+    index[slot] = static_cast<int32_t>(entrySlot);
+
+    nextEntry = (entrySlot + 1) % entries.size();
+    ++liveEntries;
+  }
+
+  bool SkippedKeyStore::take(const Key32 &ratchetPubKey, uint32_t messageNum, Key32 &messageKey) {
+    const int64_t slot = findSlot(ratchetPubKey, messageNum);
+    if (slot < 0) return false;
+
+    messageKey = entries[index[slot]].messageKey;
+    removeEntry(slot);
+    return true;
+  }
+
+  void SkippedKeyStore::clear() {
+    OPENSSL_cleanse(entries.data(), entries.size() * sizeof(Entry));
+    std::fill(index.begin(), index.end(), emptySlot);
+    nextEntry = 0;
+    liveEntries = 0;
+    deletedSlots = 0;
+  }
+
+  size_t SkippedKeyStore::hashOf(const Key32 &ratchetPubKey, uint32_t messageNum) const {
+    // Public keys are uniformly random, a few bytes of them are as good as a hash
+    uint64_t h;
+    std::memcpy(&h, ratchetPubKey.data(), sizeof(h));
+    h ^= (static_cast<uint64_t>(messageNum) + 1) * 0x9E3779B97F4A7C15ull;
+    h ^= h >> 31;
+    h *= 0xBF58476D1CE4E5B9ull;
+    h ^= h >> 29;
+    return static_cast<size_t>(h) & indexMask;
+  }
+
+  int64_t SkippedKeyStore::findSlot(const Key32 &ratchetPubKey, uint32_t messageNum) const {
+    size_t slot = hashOf(ratchetPubKey, messageNum);
+    while (index[slot] != emptySlot) {
+      if (index[slot] >= 0) {
+        const Entry &entry = entries[index[slot]];
+        if (entry.messageNum == messageNum && entry.ratchetPubKey == ratchetPubKey) {
+          return static_cast<int64_t>(slot);
+        }
+      }
+      slot = (slot + 1) & indexMask;
+    }
+    return -1;
+  }
+
+  void SkippedKeyStore::removeEntry(size_t indexSlot) {
+    Entry &entry = entries[index[indexSlot]];
+    entry.messageKey.wipe();
+    entry.live = false;
+
+    index[indexSlot] = deletedSlot;
+    ++deletedSlots;
+    --liveEntries;
+
+    if (deletedSlots > index.size() / 4) {
+      rebuildIndex();
+    }
+  }
+
+  void SkippedKeyStore::rebuildIndex() {
+    std::fill(index.begin(), index.end(), emptySlot);
+    deletedSlots = 0;
+
+    for (size_t i = 0; i < entries.size(); ++i) {
+      if (!entries[i].live) continue;
+      size_t slot = hashOf(entries[i].ratchetPubKey, entries[i].messageNum);
+      while (index[slot] != emptySlot) {
+        slot = (slot + 1) & indexMask;
+      }
+      index[slot] = static_cast<int32_t>(i);
+    }
+  }
+} // Crypto
@@ -0,0 +1,73 @@
+//
+// Created by deanprangenberg on 29.07.25.
+//
+
+#ifndef SKIPPEDKEYSTORE_H
+#define SKIPPEDKEYSTORE_H
+
+#include <cstdint>
+#include <vector>
+#include "../KeyEnv/SecureKey.h"
+
+namespace Crypto {
+  // Message keys of skipped (not yet received) messages, keyed by the sender's ratchet public key
+  // and the message number. All memory is allocated up front: entries live in a ring that is
+  // overwritten oldest first once full, and an open addressing index gives O(1) lookups. A key is
+  // wiped as soon as it is taken or evicted.
+  class SkippedKeyStore {
+  public:
+    static constexpr size_t defaultCapacity = 1000;
+
+    explicit SkippedKeyStore(size_t capacity = defaultCapacity);
+    ~SkippedKeyStore();
+
+    SkippedKeyStore(const SkippedKeyStore &) = delete;
+    SkippedKeyStore &operator=(const SkippedKeyStore &) = delete;
+
+    // Evicts the oldest stored key when full, replaces an existing key for the same message
+    void put(const Key32 &ratchetPubKey, uint32_t messageNum, const Key32 &messageKey);
+
+    // Copies the key out and deletes it from the store
+    bool take(const Key32 &ratchetPubKey, uint32_t messageNum, Key32 &messageKey);
+
+    bool contains(const Key32 &ratchetPubKey, uint32_t messageNum) const {
+      return findSlot(ratchetPubKey, messageNum) >= 0;
+    }
+
+    void clear();
+
+    size_t size() const { return liveEntries; }
+    size_t capacity() const { return entries.size(); }
+    size_t evictions() const { return evictedEntries; }
+
+  private:
+    static constexpr int32_t emptySlot = -1;
+    static constexpr int32_t deletedSlot = -2;
+
+    struct Entry {
+      Key32 ratchetPubKey;
+      Key32 messageKey;
+      uint32_t messageNum;
+      bool live;
+    };
+
+    size_t hashOf(const Key32 &ratchetPubKey, uint32_t messageNum) const;
+
+    // Index slot holding the entry, or -1
+    int64_t findSlot(const Key32 &ratchetPubKey, uint32_t messageNum) const;
+
+    void removeEntry(size_t indexSlot);
+
+    void rebuildIndex();
+
+    std::vector<Entry> entries;
+    std::vector<int32_t> index;
+    size_t indexMask = 0;
+    size_t nextEntry = 0;
+    size_t liveEntries = 0;
+    size_t deletedSlots = 0;
+    size_t evictedEntries = 0;
+  };
+} // Crypto
+
+#endif //SKIPPEDKEYSTORE_H
@@ -10,18 +10,23 @@
 #include <openssl/err.h>
 #include <iostream>
 #include <cstring>
+#include "CipherContext.h"
 
 namespace Crypto {
   class EncryptionEnv;
+  class AeadRegistry;
 
   class AES256 {
     friend class EncryptionEnv;
+    friend class AeadRegistry;
   private:
-    static bool encrypt(const uint8_t *plaintext, size_t plaintext_len, const uint8_t *key, const uint8_t *iv,
-                        uint8_t *tag, uint8_t *ciphertext, int &ciphertext_len);
+    static constexpr const char *cipherName = "AES-256-GCM";
 
-    static bool decrypt(const uint8_t *ciphertext, size_t ciphertext_len, const uint8_t *key, const uint8_t *iv,
-                        const uint8_t *tag, uint8_t *plaintext, int &plaintext_len);
+    static bool encrypt(CipherContext &cipherCtx, const uint8_t *plaintext, size_t plaintext_len,
+                        const uint8_t *key, const uint8_t *iv, uint8_t *tag, uint8_t *ciphertext, int &ciphertext_len);
+
+    static bool decrypt(CipherContext &cipherCtx, const uint8_t *ciphertext, size_t ciphertext_len,
+                        const uint8_t *key, const uint8_t *iv, const uint8_t *tag, uint8_t *plaintext, int &plaintext_len);
   };
 } // Crypto
 
@@ -0,0 +1,116 @@
+//
+// Created by deanprangenberg on 27.07.25.
+//
+
+#include "AeadRegistry.h"
+#include "../Log/CryptoLog.h"
+#include <chrono>
+#include <cstdlib>
+#include <vector>
+
+namespace Crypto {
+  AeadRegistry &AeadRegistry::getInstance() {
+    static AeadRegistry instance;
+    return instance;
+  }
+
+  EncAlgorithm AeadRegistry::preferred() {
+    return selection().algorithm;
+  }
+
+  AeadRegistry::Selection AeadRegistry::selection() {
+    std::call_once(selectOnce, [this]() {
+      selected = select();
+      if (selected.fromOverride) {
+        CRYPTO_LOG(Info, "AeadRegistry", "Using ", algorithmName(selected.algorithm), " (VENTRA_AEAD override)");
+      } else {
+        CRYPTO_LOG(Info, "AeadRegistry", "Using ", algorithmName(selected.algorithm),
+                   ", AES-256-GCM ", static_cast<long long>(selected.aesNsPerMessage),
+                   " ns/msg, ChaCha20-Poly1305 ", static_cast<long long>(selected.chachaNsPerMessage), " ns/msg");
+      }
+    });
+    return selected;
+  }
+
+  EncAlgorithm AeadRegistry::negotiate(EncAlgorithm own, EncAlgorithm peer) {
+    return own == peer ? own : EncAlgorithm::AES256;
+  }
+
+  const char *AeadRegistry::algorithmName(EncAlgorithm algorithm) {
+    return algorithm == EncAlgorithm::ChaCha20 ? ChaCha20::cipherName : AES256::cipherName;
+  }
+
+  std::optional<EncAlgorithm> AeadRegistry::parseAlgorithm(std::string_view name) {
+    if (name == "aes256" || name == AES256::cipherName) return EncAlgorithm::AES256;
+    if (name == "chacha20" || name == ChaCha20::cipherName) return EncAlgorithm::ChaCha20;
+    return std::nullopt;
+  }
+
+  uint8_t AeadRegistry::algorithmId(EncAlgorithm algorithm) {
+    return algorithm == EncAlgorithm::ChaCha20 ? 2 : 1;
+  }
+
+  std::optional<EncAlgorithm> AeadRegistry::algorithmFromId(uint8_t id) {
+    switch (id) {
+      case 1: return EncAlgorithm::AES256;
+      case 2: return EncAlgorithm::ChaCha20;
+      default: return std::nullopt;
+    }
+  }
+
+  AeadRegistry::Selection AeadRegistry::select() {
+    Selection result;
+
+    if (const char *overrideName = std::getenv("VENTRA_AEAD")) {
+      if (auto algorithm = parseAlgorithm(overrideName)) {
+        result.algorithm = *algorithm;
+        result.fromOverride = true;
+        return result;
+      }
+      CRYPTO_LOG(Warn, "AeadRegistry", "Ignoring unknown VENTRA_AEAD value: ", overrideName);
+    }
+
+    try {
+      result.aesNsPerMessage = measureNsPerMessage(AES256::cipherName);
+      result.chachaNsPerMessage = measureNsPerMessage(ChaCha20::cipherName);
+    } catch (const std::exception &e) {
+      CRYPTO_LOG(Error, "AeadRegistry", "Benchmark failed, staying on AES-256-GCM: ", e.what());
+      return result;
+    }
+
+    if (result.chachaNsPerMessage > 0 && result.chachaNsPerMessage < result.aesNsPerMessage) {
+      result.algorithm = EncAlgorithm::ChaCha20;
+    }
+    return result;
+  }
+
+  double AeadRegistry::measureNsPerMessage(const char *cipherName) {
+    // Chat sized messages, a few milliseconds per cipher at startup
+    constexpr size_t messages = 2000;
+    constexpr size_t payloadSize = 256;
+
+    CipherContext context(cipherName, true);
+    std::vector<uint8_t> key(CipherContext::keySize, 0x11);
+    std::vector<uint8_t> iv(CipherContext::ivSize, 0x22);
+    std::vector<uint8_t> plaintext(payloadSize, 0x33);
+    std::vector<uint8_t> ciphertext(payloadSize);
+    uint8_t tag[CipherContext::tagSize];
+
+    const auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < messages; ++i) {
+      iv[0] = static_cast<uint8_t>(i);
+      iv[1] = static_cast<uint8_t>(i >> 8);
+
+      int len = 0;
+      int finalLen = 0;
+      if (!context.init(key.data(), iv.data())
+          || EVP_EncryptUpdate(context.get(), ciphertext.data(), &len, plaintext.data(), payloadSize) != 1
+          || EVP_EncryptFinal_ex(context.get(), ciphertext.data() + len, &finalLen) != 1
+          || EVP_CIPHER_CTX_ctrl(context.get(), EVP_CTRL_AEAD_GET_TAG, CipherContext::tagSize, tag) != 1) {
+        throw std::runtime_error(std::string("sealing failed for ") + cipherName);
+      }
+    }
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+    return std::chrono::duration<double, std::nano>(elapsed).count() / messages;
+  }
+} // Crypto
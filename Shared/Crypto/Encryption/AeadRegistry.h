@@ -0,0 +1,56 @@
+//
+// Created by deanprangenberg on 27.07.25.
+//
+
+#ifndef AEADREGISTRY_H
+#define AEADREGISTRY_H
+
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <string_view>
+#include "EncryptionEnv.h"
+
+namespace Crypto {
+  // Picks the AEAD backend for this machine once per process. VENTRA_AEAD=aes256|chacha20
+  // overrides the choice, otherwise both ciphers seal a short burst of messages and the faster
+  // one wins, which is ChaCha20-Poly1305 on CPUs without AES-NI/VAES.
+  class AeadRegistry {
+  public:
+    struct Selection {
+      EncAlgorithm algorithm = EncAlgorithm::AES256;
+      bool fromOverride = false;
+      double aesNsPerMessage = 0;
+      double chachaNsPerMessage = 0;
+    };
+
+    static AeadRegistry &getInstance();
+
+    EncAlgorithm preferred();
+
+    // What was chosen and why, for logs and diagnostics
+    Selection selection();
+
+    // Both sides run the same rule with the arguments swapped, so they always end up on the same
+    // cipher. AES-256-GCM is the common baseline when the preferences differ.
+    static EncAlgorithm negotiate(EncAlgorithm own, EncAlgorithm peer);
+
+    static const char *algorithmName(EncAlgorithm algorithm);
+    static std::optional<EncAlgorithm> parseAlgorithm(std::string_view name);
+
+    // Wire ids used in ratchet headers and the handshake
+    static uint8_t algorithmId(EncAlgorithm algorithm);
+    static std::optional<EncAlgorithm> algorithmFromId(uint8_t id);
+
+  private:
+    AeadRegistry() = default;
+
+    static Selection select();
+    static double measureNsPerMessage(const char *cipherName);
+
+    std::once_flag selectOnce;
+    Selection selected;
+  };
+} // Crypto
+
+#endif //AEADREGISTRY_H
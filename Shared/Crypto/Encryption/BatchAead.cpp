@@ -0,0 +1,81 @@
+//
+// Created by deanprangenberg on 27.07.25.
+//
+
+#include "BatchAead.h"
+#include <algorithm>
+#include <chrono>
+#include <future>
+#include "../Log/CryptoLog.h"
+#include "../../ThreadPool/ThreadPool.h"
+
+namespace Crypto {
+  BatchAead::BatchAead(EncAlgorithm algorithm) : algorithm(algorithm) {
+  }
+
+  BatchStats BatchAead::sealAll(std::span<AeadJob> jobs, size_t threads) {
+    return run(jobs, threads, true);
+  }
+
+  BatchStats BatchAead::openAll(std::span<AeadJob> jobs, size_t threads) {
+    return run(jobs, threads, false);
+  }
+
+  BatchStats BatchAead::run(std::span<AeadJob> jobs, size_t threads, bool forEncryption) {
+    BatchStats stats;
+    stats.messages = jobs.size();
+    for (const auto &job: jobs) {
+      stats.bytes += job.in.size();
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+
+    threads = std::clamp<size_t>(threads, 1, std::max<size_t>(1, jobs.size() / minJobsPerThread));
+    const size_t chunkSize = (jobs.size() + threads - 1) / threads;
+
+    std::vector<std::future<size_t> > pending;
+    for (size_t slot = 1; slot < threads; ++slot) {
+      const size_t first = slot * chunkSize;
+      if (first >= jobs.size()) break;
+      auto chunk = jobs.subspan(first, std::min(chunkSize, jobs.size() - first));
+      EncryptionEnv &env = workerEnv(slot);
+      try {
+        pending.push_back(Utils::ThreadPool::getInstance().addTask([&env, chunk, forEncryption]() {
+          return runChunk(env, chunk, forEncryption);
+        }));
+      } catch (const std::exception &e) {
+        CRYPTO_LOG(Warn, "BatchAead", "ThreadPool rejected chunk, running it inline: ", e.what());
+        stats.failed += runChunk(env, chunk, forEncryption);
+      }
+    }
+
+    stats.failed += runChunk(workerEnv(0), jobs.first(std::min(chunkSize, jobs.size())), forEncryption);
+    for (auto &future: pending) {
+      stats.failed += future.get();
+    }
+
+    stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return stats;
+  }
+
+  size_t BatchAead::runChunk(EncryptionEnv &env, std::span<AeadJob> chunk, bool forEncryption) {
+    size_t failed = 0;
+    for (auto &job: chunk) {
+      job.ok = forEncryption
+                 ? env.sealAppendedTag(job.key, job.nonce, job.in, job.out)
+                 : env.openAppendedTag(job.key, job.nonce, job.in, job.out);
+      if (!job.ok) ++failed;
+    }
+    return failed;
+  }
+
+  EncryptionEnv &BatchAead::workerEnv(size_t slot) {
+    if (envs.size() <= slot) {
+      envs.resize(slot + 1);
+    }
+    if (!envs[slot]) {
+      envs[slot] = std::make_unique<EncryptionEnv>(algorithm);
+    }
+    return *envs[slot];
+  }
+} // Crypto
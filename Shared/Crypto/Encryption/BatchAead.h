@@ -0,0 +1,62 @@
+//
+// Created by deanprangenberg on 27.07.25.
+//
+
+#ifndef BATCHAEAD_H
+#define BATCHAEAD_H
+
+#include <memory>
+#include <span>
+#include <vector>
+#include "EncryptionEnv.h"
+
+namespace Crypto {
+  // One message of a batch. Sealed messages carry the tag behind the ciphertext, so out needs
+  // EncryptionEnv::sealedSize(in.size()) bytes when sealing and in.size() - tagSize when opening.
+  struct AeadJob {
+    std::span<const uint8_t> key;
+    std::span<const uint8_t> nonce;
+    std::span<const uint8_t> in;
+    std::span<uint8_t> out;
+    bool ok = false;
+  };
+
+  struct BatchStats {
+    size_t messages = 0;
+    size_t failed = 0;
+    size_t bytes = 0;
+    double seconds = 0;
+
+    double messagesPerSecond() const { return seconds > 0 ? messages / seconds : 0; }
+    double gigabytesPerSecond() const { return seconds > 0 ? bytes / seconds / 1e9 : 0; }
+  };
+
+  // Seals or opens many messages per call. Every worker slot keeps its own EncryptionEnv, so the
+  // cipher contexts are set up once and consecutive jobs with the same key skip the key schedule.
+  // With threads > 1 the batch is split into contiguous chunks, the calling thread takes the first
+  // one and the rest go to Utils::ThreadPool. Do not call with threads > 1 from a pool task, and do
+  // not share one BatchAead between threads.
+  class BatchAead {
+  public:
+    explicit BatchAead(EncAlgorithm algorithm);
+
+    BatchStats sealAll(std::span<AeadJob> jobs, size_t threads = 1);
+
+    BatchStats openAll(std::span<AeadJob> jobs, size_t threads = 1);
+
+  private:
+    // Below this many jobs per chunk the hand off to the pool costs more than it saves
+    static constexpr size_t minJobsPerThread = 64;
+
+    BatchStats run(std::span<AeadJob> jobs, size_t threads, bool forEncryption);
+
+    static size_t runChunk(EncryptionEnv &env, std::span<AeadJob> chunk, bool forEncryption);
+
+    EncryptionEnv &workerEnv(size_t slot);
+
+    EncAlgorithm algorithm;
+    std::vector<std::unique_ptr<EncryptionEnv> > envs;
+  };
+} // Crypto
+
+#endif //BATCHAEAD_H
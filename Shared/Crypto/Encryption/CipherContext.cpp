@@ -0,0 +1,60 @@
+//
+// Created by deanprangenberg on 26.07.25.
+//
+
+#include "CipherContext.h"
+#include <openssl/crypto.h>
+#include <openssl/err.h>
+#include <cstring>
+#include "../Log/CryptoLog.h"
+#include <stdexcept>
+
+namespace Crypto {
+  CipherContext::CipherContext(const char *cipherName, bool forEncryption)
+    : cipherName(cipherName), forEncryption(forEncryption) {
+    cipher = EVP_CIPHER_fetch(nullptr, cipherName, nullptr);
+    if (!cipher) {
+      throw std::runtime_error("[CipherContext] EVP_CIPHER_fetch failed for " + this->cipherName);
+    }
+
+    ctx = EVP_CIPHER_CTX_new();
+    if (!ctx) {
+      EVP_CIPHER_free(cipher);
+      throw std::runtime_error("[CipherContext] EVP_CIPHER_CTX_new failed");
+    }
+  }
+
+  CipherContext::~CipherContext() {
+    OPENSSL_cleanse(scheduledKey.data(), scheduledKey.size());
+    EVP_CIPHER_CTX_free(ctx);
+    EVP_CIPHER_free(cipher);
+  }
+
+  bool CipherContext::init(const uint8_t *key, const uint8_t *iv) {
+    const int enc = forEncryption ? 1 : 0;
+
+    if (keyScheduled && CRYPTO_memcmp(scheduledKey.data(), key, keySize) == 0) {
+      // Same key as the last message, keep the expanded key and only load the new IV
+      if (EVP_CipherInit_ex2(ctx, nullptr, nullptr, iv, enc, nullptr) == 1) {
+        return true;
+      }
+      CRYPTO_LOG(Warn, "CipherContext::init", "IV reload failed for ", cipherName, ", doing a full init");
+    }
+
+    keyScheduled = false;
+    if (EVP_CipherInit_ex2(ctx, cipher, key, iv, enc, nullptr) != 1) {
+      CRYPTO_LOG(Error, "CipherContext::init", "EVP_CipherInit_ex2 failed for ", cipherName, ": ",
+                 ERR_error_string(ERR_get_error(), nullptr));
+      return false;
+    }
+
+    std::memcpy(scheduledKey.data(), key, keySize);
+    keyScheduled = true;
+    return true;
+  }
+
+  void CipherContext::forgetKey() {
+    OPENSSL_cleanse(scheduledKey.data(), scheduledKey.size());
+    keyScheduled = false;
+  }
+} // Crypto
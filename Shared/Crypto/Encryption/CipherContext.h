@@ -0,0 +1,50 @@
+//
+// Created by deanprangenberg on 26.07.25.
+//
+
+#ifndef CIPHERCONTEXT_H
+#define CIPHERCONTEXT_H
+
+#include <openssl/evp.h>
+#include <array>
+#include <cstdint>
+#include <string>
+
+namespace Crypto {
+  // One EVP_CIPHER_CTX for one AEAD cipher and direction. The cipher is fetched once and the
+  // context is reset between messages instead of reallocated. As long as the key stays the same
+  // only the IV is reloaded, so the key schedule runs once per key and not once per message.
+  // Not thread safe, every thread or EncryptionEnv owns its own contexts.
+  class CipherContext {
+  public:
+    static constexpr size_t keySize = 32;
+    static constexpr size_t ivSize = 12;
+    static constexpr size_t tagSize = 16;
+
+    CipherContext(const char *cipherName, bool forEncryption);
+    ~CipherContext();
+
+    CipherContext(const CipherContext &) = delete;
+    CipherContext &operator=(const CipherContext &) = delete;
+
+    // Prepares the context for the next message, key has keySize and iv has ivSize bytes
+    bool init(const uint8_t *key, const uint8_t *iv);
+
+    // Forces a full key schedule on the next init, also wipes the cached key copy
+    void forgetKey();
+
+    EVP_CIPHER_CTX *get() const { return ctx; }
+    const std::string &name() const { return cipherName; }
+
+  private:
+    std::string cipherName;
+    bool forEncryption;
+    EVP_CIPHER *cipher = nullptr;
+    EVP_CIPHER_CTX *ctx = nullptr;
+
+    std::array<uint8_t, keySize> scheduledKey{};
+    bool keyScheduled = false;
+  };
+} // Crypto
+
+#endif //CIPHERCONTEXT_H
@@ -1,6 +1,6 @@
 #include "EncryptionEnv.h"
-#include <iostream>
-#include <iomanip>
+#include "../Log/CryptoLog.h"
+#include <limits>
 
 namespace Crypto {
 
@@ -14,25 +14,12 @@ namespace Crypto {
       throw std::logic_error("[Crypto::startEncryption] Invalid encryption parameters");
     }
 
-    ciphertext.resize(plaintext.size() + 16); // AES-GCM needs space for tag
+    ciphertext.resize(plaintext.size());
+    authTag.resize(tagSize);
 
-    bool result = false;
-    int ciphertext_len = 0;
-    if (algorithm == EncAlgorithm::AES256) {
-      authTag.resize(16);
-      result = AES256::encrypt(plaintext.data(), plaintext.size(), key.data(), iv.data(),
-                               authTag.data(), ciphertext.data(), ciphertext_len);
-    } else if (algorithm == EncAlgorithm::ChaCha20) {
-      authTag.resize(16);
-      result = ChaCha20::encrypt(plaintext.data(), plaintext.size(), key.data(), iv.data(),
-                                 authTag.data(), ciphertext.data(), ciphertext_len);
-    }
-
-
-    if (result) {
-      ciphertext.resize(ciphertext_len);
-    } else {
-      std::cerr << "[ERROR] Encryption failed: authentication tag mismatch or data corrupt." << std::endl;
+    bool result = runCipher(true, key.data(), iv.data(), plaintext, ciphertext.data(), authTag.data());
+    if (!result) {
+      CRYPTO_LOG(Error, "EncryptionEnv::startEncryption", "Encryption failed");
     }
     return result;
   }
@@ -42,25 +29,94 @@ namespace Crypto {
       throw std::logic_error("[Crypto::startDecryption] Invalid encryption parameters");
     }
 
-    plaintext.resize(ciphertext.size()); // Max size of decrypted data
+    if (authTag.size() != tagSize) {
+      CRYPTO_LOG(Warn, "EncryptionEnv::startDecryption", "authentication tag has ", authTag.size(), " bytes");
+      return false;
+    }
+
+    plaintext.resize(ciphertext.size());
+
+    bool result = runCipher(false, key.data(), iv.data(), ciphertext, plaintext.data(), authTag.data());
+    if (!result) {
+      CRYPTO_LOG(Warn, "EncryptionEnv::startDecryption", "authentication tag mismatch or data corrupt");
+    }
+    return result;
+  }
+
+  bool EncryptionEnv::seal(std::span<const uint8_t> sealKey, std::span<const uint8_t> sealIv,
+                           std::span<const uint8_t> in, std::span<uint8_t> out, std::span<uint8_t> tag) {
+    if (!checkSizes("seal", sealKey, sealIv, in.size(), out.size())) return false;
+    if (tag.size() != tagSize) {
+      CRYPTO_LOG(Error, "EncryptionEnv::seal", "tag buffer has ", tag.size(), " bytes");
+      return false;
+    }
+    return runCipher(true, sealKey.data(), sealIv.data(), in, out.data(), tag.data());
+  }
 
+  bool EncryptionEnv::sealAppendedTag(std::span<const uint8_t> sealKey, std::span<const uint8_t> sealIv,
+                                      std::span<const uint8_t> in, std::span<uint8_t> out) {
+    if (out.size() != sealedSize(in.size())) {
+      CRYPTO_LOG(Error, "EncryptionEnv::sealAppendedTag", "output buffer has ", out.size(), " bytes, needs ",
+                 sealedSize(in.size()));
+      return false;
+    }
+    return seal(sealKey, sealIv, in, out.first(in.size()), out.subspan(in.size()));
+  }
+
+  bool EncryptionEnv::open(std::span<const uint8_t> openKey, std::span<const uint8_t> openIv,
+                           std::span<const uint8_t> in, std::span<const uint8_t> tag, std::span<uint8_t> out) {
+    if (!checkSizes("open", openKey, openIv, in.size(), out.size())) return false;
+    if (tag.size() != tagSize) {
+      CRYPTO_LOG(Warn, "EncryptionEnv::open", "tag has ", tag.size(), " bytes");
+      return false;
+    }
+    // The tag is only read after all ciphertext is processed, so it may sit right behind in-place output
+    return runCipher(false, openKey.data(), openIv.data(), in, out.data(), const_cast<uint8_t *>(tag.data()));
+  }
+
+  bool EncryptionEnv::openAppendedTag(std::span<const uint8_t> openKey, std::span<const uint8_t> openIv,
+                                      std::span<const uint8_t> in, std::span<uint8_t> out) {
+    if (in.size() < tagSize) {
+      CRYPTO_LOG(Warn, "EncryptionEnv::openAppendedTag", "input shorter than the tag");
+      return false;
+    }
+    const size_t cipherSize = in.size() - tagSize;
+    return open(openKey, openIv, in.first(cipherSize), in.subspan(cipherSize), out);
+  }
+
+  bool EncryptionEnv::checkSizes(const char *caller, std::span<const uint8_t> cipherKey,
+                                 std::span<const uint8_t> cipherIv, size_t inSize, size_t outSize) const {
+    if (cipherKey.size() != CipherContext::keySize || cipherIv.size() != CipherContext::ivSize) {
+      CRYPTO_LOG(Error, "EncryptionEnv", caller, ": key/iv have ", cipherKey.size(), "/", cipherIv.size(), " bytes");
+      return false;
+    }
+    if (outSize != inSize) {
+      CRYPTO_LOG(Error, "EncryptionEnv", caller, ": output buffer has ", outSize, " bytes, input has ", inSize);
+      return false;
+    }
+    if (inSize > static_cast<size_t>(std::numeric_limits<int>::max())) {
+      CRYPTO_LOG(Error, "EncryptionEnv", caller, ": input too large");
+      return false;
+    }
+    return true;
+  }
+
+  bool EncryptionEnv::runCipher(bool forEncryption, const uint8_t *cipherKey, const uint8_t *cipherIv,
+                                std::span<const uint8_t> in, uint8_t *out, uint8_t *tag) {
     bool result = false;
-    int plaintext_len = 0;
+    int outLen = 0;
     if (algorithm == EncAlgorithm::AES256) {
-      result = AES256::decrypt(ciphertext.data(), ciphertext.size(), key.data(), iv.data(),
-                               authTag.data(), plaintext.data(), plaintext_len);
+      result = forEncryption
+                 ? AES256::encrypt(cipherContext(true), in.data(), in.size(), cipherKey, cipherIv, tag, out, outLen)
+                 : AES256::decrypt(cipherContext(false), in.data(), in.size(), cipherKey, cipherIv, tag, out, outLen);
     } else if (algorithm == EncAlgorithm::ChaCha20) {
-      result = ChaCha20::decrypt(ciphertext.data(), ciphertext.size(), key.data(), iv.data(),
-                                 authTag.data(), plaintext.data(), plaintext_len);
-    }
-
-    if (result) {
-      plaintext.resize(plaintext_len);
-    } else {
-      std::cerr << "[ERROR] Decryption failed: authentication tag mismatch or data corrupt." << std::endl;
+      result = forEncryption
+                 ? ChaCha20::encrypt(cipherContext(true), in.data(), in.size(), cipherKey, cipherIv, tag, out, outLen)
+                 : ChaCha20::decrypt(cipherContext(false), in.data(), in.size(), cipherKey, cipherIv, tag, out, outLen);
     }
 
-    return result;
+    // GCM and ChaCha20-Poly1305 are stream modes, anything else means the output buffer was wrong
+    return result && static_cast<size_t>(outLen) == in.size();
   }
 
   bool EncryptionEnv::generateParameters() {
@@ -74,13 +130,22 @@ namespace Crypto {
       keyEnv.startKeyIvGeneration(key, iv);
       return true;
     } catch (const std::exception &e) {
-      std::cerr << "[ERROR] Key/IV generation failed: " << e.what() << std::endl;
+      CRYPTO_LOG(Error, "EncryptionEnv::generateParameters", "Key/IV generation failed: ", e.what());
       return false;
     }
   }
 
+  CipherContext &EncryptionEnv::cipherContext(bool forEncryption) {
+    auto &context = forEncryption ? encryptContext : decryptContext;
+    if (!context) {
+      const char *cipherName = algorithm == EncAlgorithm::AES256 ? AES256::cipherName : ChaCha20::cipherName;
+      context = std::make_unique<CipherContext>(cipherName, forEncryption);
+    }
+    return *context;
+  }
+
   bool EncryptionEnv::isValid() const {
     return (algorithm == EncAlgorithm::AES256 || algorithm == EncAlgorithm::ChaCha20)
-           && !key.empty() && !iv.empty();
+           && key.size() == CipherContext::keySize && iv.size() == CipherContext::ivSize;
   }
 }
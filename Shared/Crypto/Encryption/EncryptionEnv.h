@@ -10,6 +10,7 @@
 #include "AES256.h"
 #include "../KeyEnv/KeyEnv.h"
 #include <memory>
+#include <span>
 
 namespace Crypto {
   enum class EncAlgorithm {
@@ -33,10 +34,44 @@ namespace Crypto {
 
     bool generateParameters();
 
+    EncAlgorithm getAlgorithm() const { return algorithm; }
+
+    // Span API, works on caller memory and leaves the member vectors untouched. The ciphertext has
+    // the same length as the plaintext, out may be the same buffer as in but must not partially
+    // overlap it. The *AppendedTag variants expect the tag directly behind the ciphertext.
+    static constexpr size_t tagSize = CipherContext::tagSize;
+
+    static constexpr size_t sealedSize(size_t plaintextSize) { return plaintextSize + tagSize; }
+
+    bool seal(std::span<const uint8_t> sealKey, std::span<const uint8_t> sealIv,
+              std::span<const uint8_t> in, std::span<uint8_t> out, std::span<uint8_t> tag);
+
+    // out holds sealedSize(in.size()) bytes, ciphertext followed by the tag
+    bool sealAppendedTag(std::span<const uint8_t> sealKey, std::span<const uint8_t> sealIv,
+                         std::span<const uint8_t> in, std::span<uint8_t> out);
+
+    bool open(std::span<const uint8_t> openKey, std::span<const uint8_t> openIv,
+              std::span<const uint8_t> in, std::span<const uint8_t> tag, std::span<uint8_t> out);
+
+    // in is ciphertext followed by the tag, out holds in.size() - tagSize bytes
+    bool openAppendedTag(std::span<const uint8_t> openKey, std::span<const uint8_t> openIv,
+                         std::span<const uint8_t> in, std::span<uint8_t> out);
+
   private:
     bool isValid() const;
 
+    bool checkSizes(const char *caller, std::span<const uint8_t> cipherKey, std::span<const uint8_t> cipherIv,
+                    size_t inSize, size_t outSize) const;
+
+    bool runCipher(bool forEncryption, const uint8_t *cipherKey, const uint8_t *cipherIv,
+                   std::span<const uint8_t> in, uint8_t *out, uint8_t *tag);
+
+    // Created on first use and kept for the lifetime of the env, see CipherContext
+    CipherContext &cipherContext(bool forEncryption);
+
     EncAlgorithm algorithm;
+    std::unique_ptr<CipherContext> encryptContext;
+    std::unique_ptr<CipherContext> decryptContext;
   };
 }
 
@@ -3,8 +3,8 @@
 //
 
 #include "HKDF.h"
+#include <openssl/core_names.h>
 #include <openssl/err.h>
-#include <openssl/kdf.h>
 #include <memory>
 
 namespace Crypto {
@@ -14,69 +14,60 @@ namespace Crypto {
     return std::string(err_buf);
   }
 
-  struct EVP_PKEY_CTX_deleter {
-    void operator()(EVP_PKEY_CTX *ctx) const {
-      EVP_PKEY_CTX_free(ctx);
+  struct EVP_KDF_deleter {
+    void operator()(EVP_KDF *kdf) const {
+      EVP_KDF_free(kdf);
     }
   };
 
-  using EVP_PKEY_CTX_ptr = std::unique_ptr<EVP_PKEY_CTX, EVP_PKEY_CTX_deleter>;
-
-  std::vector<uint8_t> HKDF::derive(
-    const EVP_MD *digest,
-    const std::vector<uint8_t> &ikm,
-    const std::vector<uint8_t> &salt,
-    const std::string &info,
-    size_t output_length
-  ) {
-
-    std::vector<uint8_t> infoVec(info.begin(), info.end());
-
-    EVP_PKEY_CTX *raw_ctx = EVP_PKEY_CTX_new_id(EVP_PKEY_HKDF, nullptr);
-    if (!raw_ctx) {
-      throw std::runtime_error("EVP_PKEY_CTX_new_id failed: " + getOpenSSLError());
-    }
-    EVP_PKEY_CTX_ptr ctx(raw_ctx);
-
-    if (EVP_PKEY_derive_init(ctx.get()) <= 0) {
-      throw std::runtime_error("EVP_PKEY_derive_init failed: " + getOpenSSLError());
-    }
-
-    if (EVP_PKEY_CTX_set_hkdf_md(ctx.get(), digest) <= 0) {
-      throw std::runtime_error("EVP_PKEY_CTX_set_hkdf_md failed: " + getOpenSSLError());
-    }
-
-    if (EVP_PKEY_CTX_set_hkdf_mode(ctx.get(), EVP_PKEY_HKDEF_MODE_EXTRACT_AND_EXPAND) <= 0) {
-      throw std::runtime_error("EVP_PKEY_CTX_set_hkdf_mode failed: " + getOpenSSLError());
+  EVP_KDF *HKDF::fetch() {
+    static const std::unique_ptr<EVP_KDF, EVP_KDF_deleter> kdf(EVP_KDF_fetch(nullptr, OSSL_KDF_NAME_HKDF, nullptr));
+    if (!kdf) {
+      throw std::runtime_error("EVP_KDF_fetch(HKDF) failed: " + getOpenSSLError());
     }
+    return kdf.get();
+  }
 
-    if (!salt.empty()) {
-      if (EVP_PKEY_CTX_set1_hkdf_salt(ctx.get(), salt.data(), salt.size()) <= 0) {
-        throw std::runtime_error("EVP_PKEY_CTX_set1_hkdf_salt failed: " + getOpenSSLError());
-      }
+  EVP_KDF_CTX *HKDF::newContext(const char *digestName) {
+    EVP_KDF_CTX *ctx = EVP_KDF_CTX_new(fetch());
+    if (!ctx) {
+      throw std::runtime_error("EVP_KDF_CTX_new failed: " + getOpenSSLError());
     }
 
-    if (EVP_PKEY_CTX_set1_hkdf_key(ctx.get(), ikm.data(), ikm.size()) <= 0) {
-      throw std::runtime_error("EVP_PKEY_CTX_set1_hkdf_key failed: " + getOpenSSLError());
+    int mode = EVP_KDF_HKDF_MODE_EXTRACT_AND_EXPAND;
+    const OSSL_PARAM params[] = {
+      OSSL_PARAM_construct_utf8_string(OSSL_KDF_PARAM_DIGEST, const_cast<char *>(digestName), 0),
+      OSSL_PARAM_construct_int(OSSL_KDF_PARAM_MODE, &mode),
+      OSSL_PARAM_construct_end()
+    };
+    if (EVP_KDF_CTX_set_params(ctx, params) != 1) {
+      EVP_KDF_CTX_free(ctx);
+      throw std::runtime_error("EVP_KDF_CTX_set_params failed: " + getOpenSSLError());
     }
+    return ctx;
+  }
 
-    if (!info.empty()) {
-      if (EVP_PKEY_CTX_add1_hkdf_info(ctx.get(), infoVec.data(), infoVec.size()) <= 0) {
-        throw std::runtime_error("EVP_PKEY_CTX_add1_hkdf_info failed: " + getOpenSSLError());
-      }
+  void HKDF::derive(
+    EVP_KDF_CTX *ctx,
+    std::span<const uint8_t> ikm,
+    std::span<const uint8_t> salt,
+    std::string_view info,
+    std::span<uint8_t> out
+  ) {
+    // The context keeps the salt of the previous call when none is given, so an empty salt is refused
+    if (salt.empty()) {
+      throw std::invalid_argument("HKDF salt must not be empty");
     }
 
-    std::vector<uint8_t> out(output_length);
-    size_t outlen = output_length;
-
-    if (EVP_PKEY_derive(ctx.get(), out.data(), &outlen) <= 0) {
-      throw std::runtime_error("EVP_PKEY_derive failed: " + getOpenSSLError());
-    }
+    const OSSL_PARAM params[] = {
+      OSSL_PARAM_construct_octet_string(OSSL_KDF_PARAM_KEY, const_cast<uint8_t *>(ikm.data()), ikm.size()),
+      OSSL_PARAM_construct_octet_string(OSSL_KDF_PARAM_SALT, const_cast<uint8_t *>(salt.data()), salt.size()),
+      OSSL_PARAM_construct_octet_string(OSSL_KDF_PARAM_INFO, const_cast<char *>(info.data()), info.size()),
+      OSSL_PARAM_construct_end()
+    };
 
-    if (outlen != output_length) {
-      throw std::runtime_error("HKDF output length mismatch");
+    if (EVP_KDF_derive(ctx, out.data(), out.size(), params) != 1) {
+      throw std::runtime_error("EVP_KDF_derive failed: " + getOpenSSLError());
     }
-
-    return out;
   }
 }
@@ -6,8 +6,12 @@
 #define HKDF_H
 
 #include <vector>
+#include <span>
 #include <stdexcept>
+#include <string>
+#include <string_view>
 #include <openssl/evp.h>
+#include <openssl/kdf.h>
 
 namespace Crypto {
   class KDFEnv;
@@ -16,12 +20,19 @@ namespace Crypto {
     friend class KDFEnv;
 
   private:
-    static std::vector<uint8_t> derive(
-      const EVP_MD *digest,
-      const std::vector<uint8_t> &ikm,
-      const std::vector<uint8_t> &salt,
-      const std::string &info,
-      size_t output_length
+    // Fetched once per process and shared by every context
+    static EVP_KDF *fetch();
+
+    // New context bound to the digest, reused for every derivation of one KDFEnv
+    static EVP_KDF_CTX *newContext(const char *digestName);
+
+    // Writes out.size() bytes straight into caller memory, only key, salt and info change per call
+    static void derive(
+      EVP_KDF_CTX *ctx,
+      std::span<const uint8_t> ikm,
+      std::span<const uint8_t> salt,
+      std::string_view info,
+      std::span<uint8_t> out
     );
 
     static std::string getOpenSSLError();
@@ -9,39 +9,56 @@ namespace Crypto {
     changeAlgorithm(inAlgorithm);
   }
 
+  KDFEnv::~KDFEnv() {
+    EVP_KDF_CTX_free(ctx);
+  }
+
   void KDFEnv::changeAlgorithm(KDFType inAlgorithm) {
+    const char *digestName = nullptr;
     switch (inAlgorithm) {
       case KDFType::SHA3_512:
-        algo = EVP_sha3_512(); // Kein Cast benötigt
+        digestName = "SHA3-512";
         break;
       case KDFType::SHA3_256:
-        algo = EVP_sha3_256();
+        digestName = "SHA3-256";
         break;
       case KDFType::SHA2_512:
-        algo = EVP_sha512();
+        digestName = "SHA2-512";
         break;
       case KDFType::SHA2_256:
-        algo = EVP_sha256();
+        digestName = "SHA2-256";
         break;
       default:
         throw std::invalid_argument("Unknown KDF algorithm");
     }
+
+    EVP_KDF_CTX *newCtx = HKDF::newContext(digestName);
+    EVP_KDF_CTX_free(ctx);
+    ctx = newCtx;
   }
 
   bool KDFEnv::startKDF(const std::vector<uint8_t> &ikm, const std::vector<uint8_t> &salt, const std::string &info,
                         std::vector<uint8_t> &out,
                         size_t output_length) {
-    if (algo == nullptr) {
+    if (output_length == 0 || out.empty()) {
       return false;
     }
 
-    if (ikm.empty() || output_length == 0 || salt.empty() || info.empty() || out.empty()) {
+    out.resize(output_length);
+    return startKDF(std::span<const uint8_t>(ikm), std::span<const uint8_t>(salt), info, std::span<uint8_t>(out));
+  }
+
+  bool KDFEnv::startKDF(std::span<const uint8_t> ikm, std::span<const uint8_t> salt, std::string_view info,
+                        std::span<uint8_t> out) {
+    if (ctx == nullptr) {
       return false;
     }
 
-    out.resize(output_length);
+    if (ikm.empty() || salt.empty() || info.empty() || out.empty()) {
+      return false;
+    }
 
-    out = HKDF::derive(algo, ikm, salt, info, output_length);
+    HKDF::derive(ctx, ikm, salt, info, out);
     return true;
   }
 } // Crypto
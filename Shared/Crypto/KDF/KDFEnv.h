@@ -6,7 +6,9 @@
 #define KDFENV_H
 
 #include <vector>
+#include <span>
 #include <string>
+#include <string_view>
 #include <unordered_map>
 #include "HKDF.h"
 
@@ -18,17 +20,28 @@ namespace Crypto {
     SHA2_256
   };
 
+  // Owns one HKDF context that is set up with the digest once and reused for every derivation.
+  // Not thread safe, like the other *Env classes every user keeps its own.
   class KDFEnv {
   public:
     explicit KDFEnv(KDFType inAlgorithm);
+    ~KDFEnv();
+
+    KDFEnv(const KDFEnv &) = delete;
+    KDFEnv &operator=(const KDFEnv &) = delete;
+
     void changeAlgorithm(KDFType inAlgorithm);
 
     bool startKDF(const std::vector<uint8_t> &ikm, const std::vector<uint8_t> &salt, const std::string &info,
                         std::vector<uint8_t> &out,
                         size_t output_length);
 
+    // Allocation free variant, fills all of out
+    bool startKDF(std::span<const uint8_t> ikm, std::span<const uint8_t> salt, std::string_view info,
+                  std::span<uint8_t> out);
+
   private:
-    const EVP_MD *algo = nullptr;
+    EVP_KDF_CTX *ctx = nullptr;
   };
 } // Crypto
 
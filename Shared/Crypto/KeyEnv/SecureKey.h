@@ -0,0 +1,68 @@
+//
+// Created by deanprangenberg on 28.07.25.
+//
+
+#ifndef SECUREKEY_H
+#define SECUREKEY_H
+
+#include <openssl/crypto.h>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+namespace Crypto {
+  // Fixed size key material stored inline. Kept trivially copyable so structs made of keys can be
+  // copied and persisted as flat bytes, which is why nothing is wiped automatically: whoever owns
+  // the key calls wipe() (or secureWipe() on the enclosing struct) once it is no longer needed.
+  template<size_t N>
+  struct SecureKey {
+    static constexpr size_t keySize = N;
+
+    std::array<uint8_t, N> bytes;
+
+    uint8_t *data() { return bytes.data(); }
+    const uint8_t *data() const { return bytes.data(); }
+    static constexpr size_t size() { return N; }
+
+    std::span<uint8_t, N> span() { return std::span<uint8_t, N>(bytes); }
+    std::span<const uint8_t, N> span() const { return std::span<const uint8_t, N>(bytes); }
+
+    // Copies exactly N bytes, anything else leaves the key untouched
+    bool assign(std::span<const uint8_t> source) {
+      if (source.size() != N) return false;
+      std::memcpy(bytes.data(), source.data(), N);
+      return true;
+    }
+
+    // An all zero key only exists before the key was set or after it was wiped
+    bool isZero() const {
+      uint8_t acc = 0;
+      for (uint8_t b: bytes) acc |= b;
+      return acc == 0;
+    }
+
+    void wipe() { OPENSSL_cleanse(bytes.data(), N); }
+
+    // Debug output only, allocates
+    std::vector<uint8_t> toVector() const { return std::vector<uint8_t>(bytes.begin(), bytes.end()); }
+
+    // Constant time, keys are compared where timing must not leak how many bytes matched
+    bool operator==(const SecureKey &other) const { return CRYPTO_memcmp(bytes.data(), other.bytes.data(), N) == 0; }
+  };
+
+  using Key32 = SecureKey<32>;
+  using Key64 = SecureKey<64>;
+
+  static_assert(std::is_trivially_copyable_v<Key32> && std::is_standard_layout_v<Key32>);
+
+  template<typename T>
+  void secureWipe(T &value) {
+    static_assert(std::is_trivially_copyable_v<T>, "secureWipe is meant for flat key structs");
+    OPENSSL_cleanse(&value, sizeof(T));
+  }
+} // Crypto
+
+#endif //SECUREKEY_H
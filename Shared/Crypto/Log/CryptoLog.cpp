@@ -0,0 +1,92 @@
+//
+// Created by deanprangenberg on 30.07.25.
+//
+
+#include "CryptoLog.h"
+#include <iostream>
+
+namespace Crypto {
+  CryptoLog &CryptoLog::getInstance() {
+    static CryptoLog instance;
+    return instance;
+  }
+
+  CryptoLog::CryptoLog() : writer(&CryptoLog::run, this) {
+  }
+
+  CryptoLog::~CryptoLog() {
+    {
+      std::lock_guard lock(mutex);
+      stopping = true;
+    }
+    wake.notify_one();
+    writer.join();
+  }
+
+  void CryptoLog::flush() {
+    std::unique_lock lock(mutex);
+    const uint64_t target = queuedLines;
+    wake.notify_one();
+    written.wait(lock, [&]() { return writtenLines >= target || stopping; });
+  }
+
+  void CryptoLog::appendPrefix(std::string &line, LogLevel level, std::string_view tag) {
+    static constexpr std::string_view names[] = {"[Trace]", "[Debug]", "[Info]", "[Warn]", "[Error]", "[Off]"};
+    line.append(names[static_cast<int>(level)]);
+    line.push_back('[');
+    line.append(tag);
+    line.append("] ");
+  }
+
+  void CryptoLog::appendHex(std::string &line, std::span<const uint8_t> bytes) {
+    static constexpr char digits[] = "0123456789abcdef";
+    for (uint8_t b: bytes) {
+      line.push_back(digits[b >> 4]);
+      line.push_back(digits[b & 0x0F]);
+    }
+  }
+
+  void CryptoLog::push(std::string &&line) {
+    {
+      std::lock_guard lock(mutex);
+      if (pending.size() >= maxPendingLines) {
+        ++droppedLines;
+        return;
+      }
+      pending.push_back(std::move(line));
+      ++queuedLines;
+    }
+    wake.notify_one();
+  }
+
+  void CryptoLog::run() {
+    std::vector<std::string> batch;
+    std::string out;
+
+    std::unique_lock lock(mutex);
+    while (true) {
+      wake.wait(lock, [this]() { return stopping || !pending.empty(); });
+      if (pending.empty() && stopping) break;
+
+      batch.swap(pending);
+      const uint64_t dropped = droppedLines;
+      droppedLines = 0;
+      lock.unlock();
+
+      // One write per batch instead of one flush per line
+      out.clear();
+      for (const auto &line: batch) out.append(line);
+      if (dropped > 0) {
+        out.append("[Warn][CryptoLog] dropped ").append(std::to_string(dropped)).append(" lines\n");
+      }
+      std::cerr.write(out.data(), static_cast<std::streamsize>(out.size()));
+      std::cerr.flush();
+
+      lock.lock();
+      writtenLines += batch.size();
+      batch.clear();
+      written.notify_all();
+    }
+    written.notify_all();
+  }
+} // Crypto
@@ -0,0 +1,110 @@
+//
+// Created by deanprangenberg on 30.07.25.
+//
+
+#ifndef CRYPTOLOG_H
+#define CRYPTOLOG_H
+
+#include <charconv>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <span>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// Lowest level that is compiled in, set by CMake (VENTRA_CRYPTO_LOG_LEVEL)
+#ifndef VENTRA_CRYPTO_LOG_LEVEL
+#define VENTRA_CRYPTO_LOG_LEVEL 3
+#endif
+
+// CRYPTO_LOG(Debug, "decryptMessage", "msgNum=", num);
+// Below the compiled level the call and its arguments disappear, nothing is evaluated.
+#define CRYPTO_LOG(level, tag, ...) \
+  do { \
+    if constexpr (Crypto::LogLevel::level >= Crypto::CryptoLog::compiledLevel) { \
+      Crypto::CryptoLog::getInstance().write(Crypto::LogLevel::level, tag, __VA_ARGS__); \
+    } \
+  } while (false)
+
+namespace Crypto {
+  enum class LogLevel : int { Trace = 0, Debug = 1, Info = 2, Warn = 3, Error = 4, Off = 5 };
+
+  // Log lines are formatted on the calling thread and handed to a writer thread, which writes
+  // them to stderr in batches. Callers never block on the terminal.
+  class CryptoLog {
+  public:
+    static constexpr LogLevel compiledLevel = static_cast<LogLevel>(VENTRA_CRYPTO_LOG_LEVEL);
+
+    // Lines beyond this many waiting ones are dropped and counted
+    static constexpr size_t maxPendingLines = 10000;
+
+    // Logs bytes as hex, for key material only at Trace level
+    struct Hex {
+      std::span<const uint8_t> bytes;
+    };
+
+    static CryptoLog &getInstance();
+
+    template<typename... Args>
+    void write(LogLevel level, std::string_view tag, const Args &... args) {
+      std::string line;
+      line.reserve(128);
+      appendPrefix(line, level, tag);
+      (append(line, args), ...);
+      line.push_back('\n');
+      push(std::move(line));
+    }
+
+    // Blocks until every line queued before the call has been written
+    void flush();
+
+  private:
+    CryptoLog();
+
+    ~CryptoLog();
+
+    CryptoLog(const CryptoLog &) = delete;
+    CryptoLog &operator=(const CryptoLog &) = delete;
+
+    static void appendPrefix(std::string &line, LogLevel level, std::string_view tag);
+
+    static void appendHex(std::string &line, std::span<const uint8_t> bytes);
+
+    template<typename T>
+    static void append(std::string &line, const T &value) {
+      if constexpr (std::is_same_v<T, Hex>) {
+        appendHex(line, value.bytes);
+      } else if constexpr (std::is_convertible_v<const T &, std::string_view>) {
+        line.append(std::string_view(value));
+      } else if constexpr (std::is_same_v<T, bool>) {
+        line.append(value ? "true" : "false");
+      } else if constexpr (std::is_arithmetic_v<T>) {
+        char buffer[32];
+        auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+        line.append(buffer, result.ptr);
+      } else {
+        static_assert(!sizeof(T), "CryptoLog cannot format this type");
+      }
+    }
+
+    void push(std::string &&line);
+
+    void run();
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable written;
+    std::vector<std::string> pending;
+    uint64_t queuedLines = 0;
+    uint64_t writtenLines = 0;
+    uint64_t droppedLines = 0;
+    bool stopping = false;
+    std::thread writer;
+  };
+} // Crypto
+
+#endif //CRYPTOLOG_H
@@ -0,0 +1,111 @@
+//
+// Created by deanprangenberg on 03.08.25.
+//
+
+#include "ConnectionManager.h"
+#include <QMetaObject>
+#include <algorithm>
+#include "NetLog.h"
+
+namespace Network {
+  ConnectionManager::ConnectionManager(size_t ioThreads) {
+    if (ioThreads == 0) ioThreads = std::max(1, QThread::idealThreadCount());
+
+    for (size_t i = 0; i < ioThreads; ++i) {
+      auto io = std::make_unique<IoThread>();
+      io->thread.setObjectName(QStringLiteral("VentraIo%1").arg(i));
+      io->context.moveToThread(&io->thread);
+      io->thread.start();
+      this->ioThreads.push_back(std::move(io));
+    }
+  }
+
+  ConnectionManager::~ConnectionManager() {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stopping = true;
+      sessionThreads.clear();
+    }
+
+    // Clients are destroyed on their own thread, their sockets and timers live there
+    for (auto &io: ioThreads) {
+      IoThread *target = io.get();
+      QMetaObject::invokeMethod(&target->context, [target]() { target->clients.clear(); },
+                                Qt::BlockingQueuedConnection);
+      target->thread.quit();
+      target->thread.wait();
+    }
+  }
+
+  ConnectionManager::SessionId ConnectionManager::addSession(const QUrl &url, SessionOptions options) {
+    IoThread *target = nullptr;
+    SessionId id = invalidSession;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (stopping) return invalidSession;
+
+      target = std::min_element(ioThreads.begin(), ioThreads.end(), [](const auto &a, const auto &b) {
+        return a->sessions < b->sessions;
+      })->get();
+      id = nextSessionId++;
+      ++target->sessions;
+      sessionThreads.emplace(id, target);
+    }
+
+    QMetaObject::invokeMethod(&target->context, [target, id, url, options = std::move(options)]() mutable {
+      auto client = std::make_unique<WebSocketClient>(url, options.outbox, &target->engines);
+      // Both are in place before the event loop sees the connection
+      client->setUserId(options.userId);
+      if (options.messageHandler) client->setMessageHandler(std::move(options.messageHandler));
+      target->clients.emplace(id, std::move(client));
+    }, Qt::QueuedConnection);
+    return id;
+  }
+
+  bool ConnectionManager::removeSession(SessionId id) {
+    IoThread *target = nullptr;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      auto it = sessionThreads.find(id);
+      if (it == sessionThreads.end()) return false;
+      target = it->second;
+      --target->sessions;
+      sessionThreads.erase(it);
+    }
+
+    QMetaObject::invokeMethod(&target->context, [target, id]() { target->clients.erase(id); },
+                              Qt::QueuedConnection);
+    return true;
+  }
+
+  bool ConnectionManager::sendMessage(SessionId id, const QJsonObject &message) {
+    return post(id, [message](WebSocketClient &client) { client.sendMessage(message); });
+  }
+
+  bool ConnectionManager::post(SessionId id, std::function<void(WebSocketClient &)> function) {
+    IoThread *target = owner(id);
+    if (!target) return false;
+
+    // Runs after the session's creation, both go through the same thread's queue in order
+    QMetaObject::invokeMethod(&target->context, [target, id, function = std::move(function)]() {
+      auto it = target->clients.find(id);
+      if (it == target->clients.end()) {
+        NET_LOG(Warn, "ConnectionManager", "Session ", id, " was removed before a queued call reached it");
+        return;
+      }
+      function(*it->second);
+    }, Qt::QueuedConnection);
+    return true;
+  }
+
+  size_t ConnectionManager::sessionCount() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return sessionThreads.size();
+  }
+
+  ConnectionManager::IoThread *ConnectionManager::owner(SessionId id) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = sessionThreads.find(id);
+    return it == sessionThreads.end() ? nullptr : it->second;
+  }
+} // Network
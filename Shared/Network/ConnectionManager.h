@@ -0,0 +1,93 @@
+//
+// Created by deanprangenberg on 03.08.25.
+//
+
+#ifndef CONNECTIONMANAGER_H
+#define CONNECTIONMANAGER_H
+
+#include <QJsonObject>
+#include <QObject>
+#include <QThread>
+#include <QUrl>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include "WebSocketClient.h"
+#include "CryptoEngines.h"
+
+namespace Network {
+  struct SessionOptions {
+    // Announced as userID in the handshake
+    QString userId;
+    // Has to outlive the session, nullptr keeps unsent messages in memory only
+    OutboxStore *outbox = nullptr;
+    // Called on the session's I/O thread
+    WebSocketClient::MessageHandler messageHandler;
+  };
+
+  // Runs many WebSocketClient sessions, e.g. several accounts or bots, on a fixed set of I/O
+  // threads instead of one thread per connection. Every thread runs one event loop for all of its
+  // sessions and owns one CryptoEngines set they share, a session only keeps its socket, keys and
+  // queues. New sessions go to the thread with the fewest sessions and stay there until removed.
+  // The public methods are thread safe, except that the manager must not be destroyed on one of
+  // its own I/O threads.
+  class ConnectionManager {
+  public:
+    using SessionId = uint64_t;
+
+    static constexpr SessionId invalidSession = 0;
+
+    // 0 starts one I/O thread per core
+    explicit ConnectionManager(size_t ioThreads = 0);
+
+    ConnectionManager(const ConnectionManager &) = delete;
+
+    ConnectionManager &operator=(const ConnectionManager &) = delete;
+
+    // Closes every session and stops the I/O threads
+    ~ConnectionManager();
+
+    // The client is created on its I/O thread and connects from there, invalidSession if the
+    // manager is shutting down
+    SessionId addSession(const QUrl &url, SessionOptions options = {});
+
+    // Closes the session, messages not yet written stay in its outbox. False if the id is unknown.
+    bool removeSession(SessionId id);
+
+    // Queues the message on the session's thread. False if the id is unknown, rejections by the
+    // client's queue are only logged there.
+    bool sendMessage(SessionId id, const QJsonObject &message);
+
+    // Runs function with the session's client on its I/O thread, e.g. to read outboundStats()
+    bool post(SessionId id, std::function<void(WebSocketClient &)> function);
+
+    size_t sessionCount() const;
+
+    size_t ioThreadCount() const { return ioThreads.size(); }
+
+  private:
+    struct IoThread {
+      QThread thread;
+      // Lives on the thread, queued calls run through it
+      QObject context;
+      CryptoEngines engines;
+      // Only touched on the thread
+      std::unordered_map<SessionId, std::unique_ptr<WebSocketClient> > clients;
+      // Guarded by the manager's mutex
+      size_t sessions = 0;
+    };
+
+    IoThread *owner(SessionId id) const;
+
+    std::vector<std::unique_ptr<IoThread> > ioThreads;
+    mutable std::mutex mutex;
+    std::unordered_map<SessionId, IoThread *> sessionThreads;
+    SessionId nextSessionId = 1;
+    bool stopping = false;
+  };
+} // Network
+
+#endif //CONNECTIONMANAGER_H
@@ -0,0 +1,24 @@
+//
+// Created by deanprangenberg on 03.08.25.
+//
+
+#include "CryptoEngines.h"
+
+namespace Network {
+  Crypto::EncryptionEnv &CryptoEngines::cipher(Crypto::EncAlgorithm algorithm) {
+    auto &env = ciphers[algorithm];
+    if (!env) env = std::make_unique<Crypto::EncryptionEnv>(algorithm);
+    return *env;
+  }
+
+  Crypto::BatchAead &CryptoEngines::sealer(Crypto::EncAlgorithm algorithm) {
+    auto &batchAead = sealers[algorithm];
+    if (!batchAead) batchAead = std::make_unique<Crypto::BatchAead>(algorithm);
+    return *batchAead;
+  }
+
+  Crypto::HashingEnv &CryptoEngines::hashing() {
+    if (!hashingEnv) hashingEnv = std::make_unique<Crypto::HashingEnv>(Crypto::HashAlgorithm::BLAKE2s256);
+    return *hashingEnv;
+  }
+} // Network
@@ -0,0 +1,35 @@
+//
+// Created by deanprangenberg on 03.08.25.
+//
+
+#ifndef CRYPTOENGINES_H
+#define CRYPTOENGINES_H
+
+#include <memory>
+#include <unordered_map>
+#include "../Crypto/Encryption/EncryptionEnv.h"
+#include "../Crypto/Encryption/BatchAead.h"
+#include "../Crypto/Hash/HashingEnv.h"
+
+namespace Network {
+  // Cipher, batch sealer and hash objects without any session state, keys are passed per call.
+  // One set serves every WebSocketClient on an event loop thread, so their number follows the
+  // thread count instead of the connection count. Created lazily per algorithm. Not thread safe,
+  // only used by the thread that runs the clients.
+  class CryptoEngines {
+  public:
+    Crypto::EncryptionEnv &cipher(Crypto::EncAlgorithm algorithm);
+
+    Crypto::BatchAead &sealer(Crypto::EncAlgorithm algorithm);
+
+    // BLAKE2s-256 for the handshake secret
+    Crypto::HashingEnv &hashing();
+
+  private:
+    std::unordered_map<Crypto::EncAlgorithm, std::unique_ptr<Crypto::EncryptionEnv> > ciphers;
+    std::unordered_map<Crypto::EncAlgorithm, std::unique_ptr<Crypto::BatchAead> > sealers;
+    std::unique_ptr<Crypto::HashingEnv> hashingEnv;
+  };
+} // Network
+
+#endif //CRYPTOENGINES_H
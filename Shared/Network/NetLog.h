@@ -0,0 +1,43 @@
+//
+// Created by deanprangenberg on 04.08.25.
+//
+
+#ifndef NETLOG_H
+#define NETLOG_H
+
+#include <atomic>
+#include "../Crypto/Log/CryptoLog.h"
+
+// Lowest level that is compiled in, set by CMake (VENTRA_NET_LOG_LEVEL)
+#ifndef VENTRA_NET_LOG_LEVEL
+#define VENTRA_NET_LOG_LEVEL 2
+#endif
+
+// NET_LOG(Info, "WebSocketClient", "Connected to server: ", url);
+// Shares the writer thread of CRYPTO_LOG. Below the compiled level nothing is evaluated, above it
+// the line is still skipped while it is below NetLog::setLevel().
+#define NET_LOG(level, tag, ...) \
+  do { \
+    if constexpr (Crypto::LogLevel::level >= Network::NetLog::compiledLevel) { \
+      if (Network::NetLog::enabled(Crypto::LogLevel::level)) { \
+        Crypto::CryptoLog::getInstance().write(Crypto::LogLevel::level, tag, __VA_ARGS__); \
+      } \
+    } \
+  } while (false)
+
+namespace Network {
+  class NetLog {
+  public:
+    static constexpr Crypto::LogLevel compiledLevel = static_cast<Crypto::LogLevel>(VENTRA_NET_LOG_LEVEL);
+
+    // Thousands of sessions in one process, e.g. the load generator, turn it down to Warn
+    static void setLevel(Crypto::LogLevel level) { runtimeLevel.store(level, std::memory_order_relaxed); }
+
+    static bool enabled(Crypto::LogLevel level) { return level >= runtimeLevel.load(std::memory_order_relaxed); }
+
+  private:
+    inline static std::atomic<Crypto::LogLevel> runtimeLevel{compiledLevel};
+  };
+} // Network
+
+#endif //NETLOG_H
@@ -0,0 +1,87 @@
+//
+// Created by deanprangenberg on 31.07.25.
+//
+
+#include "OutboundQueue.h"
+#include <algorithm>
+
+namespace Network {
+  OutboundQueue::OutboundQueue(size_t maxMessages, size_t maxBytes)
+    : maxMessages(maxMessages), maxBytes(maxBytes) {
+  }
+
+  bool OutboundQueue::fits(size_t bytes) const {
+    return queue.size() + inFlightMessages < maxMessages && queuedBytes + inFlightBytes + bytes <= maxBytes;
+  }
+
+  bool OutboundQueue::push(QByteArray plaintext, int64_t outboxId) {
+    const size_t size = plaintext.size();
+    if (!fits(size)) {
+      ++rejectedMessages;
+      return false;
+    }
+
+    queuedBytes += size;
+    queue.push_back({std::move(plaintext), std::chrono::steady_clock::now(), outboxId});
+    return true;
+  }
+
+  std::vector<OutboundMessage> OutboundQueue::takeBatch(size_t batchMessages, size_t batchBytes) {
+    std::vector<OutboundMessage> batch;
+    size_t bytes = 0;
+    while (!queue.empty() && batch.size() < batchMessages) {
+      const size_t size = queue.front().plaintext.size();
+      if (!batch.empty() && bytes + size > batchBytes) break;
+      bytes += size;
+      batch.push_back(std::move(queue.front()));
+      queue.pop_front();
+    }
+
+    queuedBytes -= bytes;
+    inFlightMessages += batch.size();
+    inFlightBytes += bytes;
+    return batch;
+  }
+
+  void OutboundQueue::finish(const OutboundMessage &message, bool sent) {
+    --inFlightMessages;
+    inFlightBytes -= message.plaintext.size();
+
+    if (!sent) {
+      ++droppedMessages;
+      return;
+    }
+
+    const double latencyMs = std::chrono::duration<double, std::milli>(
+      std::chrono::steady_clock::now() - message.queuedAt).count();
+    lastLatencyMs = latencyMs;
+    totalLatencyMs += latencyMs;
+    maxLatencyMs = std::max(maxLatencyMs, latencyMs);
+    ++sentMessages;
+  }
+
+  void OutboundQueue::requeue(std::vector<OutboundMessage> messages) {
+    for (auto it = messages.rbegin(); it != messages.rend(); ++it) {
+      const size_t size = it->plaintext.size();
+      --inFlightMessages;
+      inFlightBytes -= size;
+      queuedBytes += size;
+      queue.push_front(std::move(*it));
+    }
+  }
+
+  OutboundStats OutboundQueue::stats() const {
+    OutboundStats result;
+    result.queuedMessages = queue.size();
+    result.queuedBytes = queuedBytes;
+    result.inFlightMessages = inFlightMessages;
+    result.sentMessages = sentMessages;
+    result.sentFrames = sentFrames;
+    result.rejectedMessages = rejectedMessages;
+    result.droppedMessages = droppedMessages;
+    result.lastLatencyMs = lastLatencyMs;
+    result.averageLatencyMs = sentMessages > 0 ? totalLatencyMs / static_cast<double>(sentMessages) : 0;
+    result.maxLatencyMs = maxLatencyMs;
+    return result;
+  }
+} // Network
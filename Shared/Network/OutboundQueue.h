@@ -0,0 +1,86 @@
+//
+// Created by deanprangenberg on 31.07.25.
+//
+
+#ifndef OUTBOUNDQUEUE_H
+#define OUTBOUNDQUEUE_H
+
+#include <QByteArray>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+namespace Network {
+  struct OutboundMessage {
+    QByteArray plaintext;
+    std::chrono::steady_clock::time_point queuedAt;
+    // Row in the OutboxStore, noOutboxId when the client runs without one
+    int64_t outboxId = -1;
+  };
+
+  struct OutboundStats {
+    size_t queuedMessages = 0;
+    size_t queuedBytes = 0;
+    size_t inFlightMessages = 0;
+    uint64_t sentMessages = 0;
+    uint64_t sentFrames = 0;
+    uint64_t rejectedMessages = 0;
+    uint64_t droppedMessages = 0;
+    // Time from push() until the relay confirmed the message, or the socket wrote it for relays without acks
+    double lastLatencyMs = 0;
+    double averageLatencyMs = 0;
+    double maxLatencyMs = 0;
+    bool backpressured = false;
+  };
+
+  // Plaintext messages waiting to be sealed and sent. Messages count against the limits until
+  // they were sent, including while a batch of them is being encrypted, so a burst cannot grow
+  // memory past maxBytes. Not thread safe, owned by the thread of its WebSocketClient.
+  class OutboundQueue {
+  public:
+    static constexpr size_t defaultMaxMessages = 10000;
+    static constexpr size_t defaultMaxBytes = 16 * 1024 * 1024;
+    static constexpr int64_t noOutboxId = -1;
+
+    explicit OutboundQueue(size_t maxMessages = defaultMaxMessages, size_t maxBytes = defaultMaxBytes);
+
+    bool fits(size_t bytes) const;
+
+    // False if the message does not fit, the caller keeps it and may retry later
+    bool push(QByteArray plaintext, int64_t outboxId = noOutboxId);
+
+    // Oldest messages up to either limit, at least one if any is queued
+    std::vector<OutboundMessage> takeBatch(size_t maxMessages, size_t maxBytes);
+
+    // Releases a message taken by takeBatch, sent or dropped because it could not be sealed
+    void finish(const OutboundMessage &message, bool sent);
+
+    // Puts messages taken by takeBatch back in front of the queue in their order, e.g. after the
+    // connection dropped before they were written
+    void requeue(std::vector<OutboundMessage> messages);
+
+    void addSentFrames(size_t frames) { sentFrames += frames; }
+
+    bool empty() const { return queue.empty(); }
+
+    OutboundStats stats() const;
+
+  private:
+    size_t maxMessages;
+    size_t maxBytes;
+    std::deque<OutboundMessage> queue;
+    size_t queuedBytes = 0;
+    size_t inFlightMessages = 0;
+    size_t inFlightBytes = 0;
+    uint64_t sentMessages = 0;
+    uint64_t sentFrames = 0;
+    uint64_t rejectedMessages = 0;
+    uint64_t droppedMessages = 0;
+    double lastLatencyMs = 0;
+    double totalLatencyMs = 0;
+    double maxLatencyMs = 0;
+  };
+} // Network
+
+#endif //OUTBOUNDQUEUE_H
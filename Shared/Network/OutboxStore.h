@@ -0,0 +1,34 @@
+//
+// Created by deanprangenberg on 01.08.25.
+//
+
+#ifndef OUTBOXSTORE_H
+#define OUTBOXSTORE_H
+
+#include <QByteArray>
+#include <cstdint>
+#include <vector>
+
+namespace Network {
+  struct OutboxEntry {
+    int64_t id;
+    QByteArray plaintext;
+  };
+
+  // Durable copy of every outbound message until the socket wrote it, so messages survive a lost
+  // connection or a restart of the client. Implemented by the local database of the client.
+  class OutboxStore {
+  public:
+    virtual ~OutboxStore() = default;
+
+    // Appends and removes in one transaction, either all of it is written or nothing. ids of the
+    // appended messages only ever grow, loadPending returns messages in the order they were appended.
+    virtual bool commit(const std::vector<QByteArray> &appends, std::vector<int64_t> &appendedIds,
+                        const std::vector<int64_t> &removals) = 0;
+
+    // Up to limit messages with an id above afterId, oldest first
+    virtual bool loadPending(int64_t afterId, size_t limit, std::vector<OutboxEntry> &entries) = 0;
+  };
+} // Network
+
+#endif //OUTBOXSTORE_H
@@ -4,6 +4,7 @@
 
 #include "Packages.h"
 #include <QDateTime>
+#include <cstring>
 
 QJsonObject Packages::makeMessagePkg(const QString &content,
                                      const QString &timestamp, const QString &senderID,
@@ -19,6 +20,99 @@ QJsonObject Packages::makeMessagePkg(const QString &content,
   return data;
 }
 
+QByteArray Packages::makeBinaryFrame(FrameType type, std::span<const uint8_t> iv, size_t sealedSize) {
+  if (iv.size() > UINT8_MAX) {
+    qWarning() << "Packages::makeBinaryFrame: iv of" << iv.size() << "bytes does not fit the frame";
+    return {};
+  }
+
+  QByteArray frame(static_cast<qsizetype>(frameHeaderSize + iv.size() + sealedSize), Qt::Uninitialized);
+  frame[0] = static_cast<char>(type);
+  frame[1] = static_cast<char>(iv.size());
+  std::memcpy(frame.data() + frameHeaderSize, iv.data(), iv.size());
+  return frame;
+}
+
+std::span<uint8_t> Packages::binaryFrameSealed(QByteArray &frame) {
+  if (frame.size() < static_cast<qsizetype>(frameHeaderSize)) return {};
+  const size_t offset = frameHeaderSize + static_cast<uint8_t>(frame[1]);
+  if (offset > static_cast<size_t>(frame.size())) return {};
+  return {reinterpret_cast<uint8_t *>(frame.data()) + offset, static_cast<size_t>(frame.size()) - offset};
+}
+
+std::optional<BinaryFrameView> Packages::parseBinaryFrame(std::span<const uint8_t> frame) {
+  if (frame.size() < frameHeaderSize || frame[0] != static_cast<uint8_t>(FrameType::MessagePkg)) {
+    return std::nullopt;
+  }
+
+  const size_t ivSize = frame[1];
+  if (frame.size() < frameHeaderSize + ivSize) {
+    return std::nullopt;
+  }
+
+  return BinaryFrameView{
+    static_cast<FrameType>(frame[0]),
+    frame.subspan(frameHeaderSize, ivSize),
+    frame.subspan(frameHeaderSize + ivSize)
+  };
+}
+
+QByteArray Packages::makeBatchFrame(const std::vector<QByteArray> &frames) {
+  if (frames.size() > maxBatchFrames) {
+    qWarning() << "Packages::makeBatchFrame:" << frames.size() << "frames do not fit one batch";
+    return {};
+  }
+
+  size_t total = batchHeaderSize;
+  for (const auto &frame: frames) total += 4 + frame.size();
+
+  QByteArray batch(static_cast<qsizetype>(total), Qt::Uninitialized);
+  auto *out = reinterpret_cast<uint8_t *>(batch.data());
+  out[0] = static_cast<uint8_t>(FrameType::MessageBatch);
+  out[1] = static_cast<uint8_t>(frames.size());
+  out[2] = static_cast<uint8_t>(frames.size() >> 8);
+
+  size_t pos = batchHeaderSize;
+  for (const auto &frame: frames) {
+    const auto length = static_cast<uint32_t>(frame.size());
+    out[pos] = static_cast<uint8_t>(length);
+    out[pos + 1] = static_cast<uint8_t>(length >> 8);
+    out[pos + 2] = static_cast<uint8_t>(length >> 16);
+    out[pos + 3] = static_cast<uint8_t>(length >> 24);
+    std::memcpy(out + pos + 4, frame.constData(), length);
+    pos += 4 + length;
+  }
+  return batch;
+}
+
+bool Packages::parseBatchFrame(std::span<const uint8_t> batch, std::vector<std::span<const uint8_t> > &frames) {
+  frames.clear();
+  if (batch.size() < batchHeaderSize || batch[0] != static_cast<uint8_t>(FrameType::MessageBatch)) {
+    return false;
+  }
+
+  const size_t count = batch[1] | static_cast<size_t>(batch[2]) << 8;
+  size_t pos = batchHeaderSize;
+  for (size_t i = 0; i < count; ++i) {
+    if (batch.size() - pos < 4) return false;
+    const size_t length = batch[pos] | static_cast<size_t>(batch[pos + 1]) << 8
+                          | static_cast<size_t>(batch[pos + 2]) << 16 | static_cast<size_t>(batch[pos + 3]) << 24;
+    pos += 4;
+    if (batch.size() - pos < length) return false;
+    frames.push_back(batch.subspan(pos, length));
+    pos += length;
+  }
+  return pos == batch.size();
+}
+
+QJsonObject Packages::makeJsonFrame(std::span<const uint8_t> iv, std::span<const uint8_t> sealed) {
+  QJsonObject pkg;
+  pkg["type"] = "MessagePkg";
+  pkg["pkg"] = QString(QByteArray(reinterpret_cast<const char *>(sealed.data()), sealed.size()).toBase64());
+  pkg["IV"] = QString(QByteArray(reinterpret_cast<const char *>(iv.data()), iv.size()).toBase64());
+  return pkg;
+}
+
 QString Packages::convertPkgToJsonStr(const QJsonObject &pkg) {
   QJsonDocument doc(pkg);
   return QString::fromUtf8(doc.toJson(QJsonDocument::Compact));
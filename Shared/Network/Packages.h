@@ -9,9 +9,47 @@
 #include <QJsonObject>
 #include <QJsonDocument>
 #include <QDebug>
+#include <QByteArray>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <vector>
+
+// Binary WebSocket frame: type(1) | ivLength(1) | iv(ivLength) | ciphertext + tag (rest of the frame).
+// The WebSocket message boundary delimits the ciphertext, so it carries no length of its own.
+// A batch carries several of them in one WebSocket message:
+// type(1) | count(2) | count * (frameLength(4) | frame), integers little endian.
+enum class FrameType : uint8_t { MessagePkg = 1, MessageBatch = 2 };
+
+struct BinaryFrameView {
+  FrameType type;
+  std::span<const uint8_t> iv;
+  std::span<const uint8_t> sealed;
+};
 
 class Packages {
 public:
+  static constexpr size_t frameHeaderSize = 2;
+  static constexpr size_t batchHeaderSize = 3;
+  static constexpr size_t maxBatchFrames = UINT16_MAX;
+
+  // Header and iv are written, the sealedSize bytes behind them are left for the caller to encrypt into
+  static QByteArray makeBinaryFrame(FrameType type, std::span<const uint8_t> iv, size_t sealedSize);
+
+  // Writable ciphertext + tag region of a frame built by makeBinaryFrame
+  static std::span<uint8_t> binaryFrameSealed(QByteArray &frame);
+
+  // Views into frame, nullopt if it is truncated or of an unknown type
+  static std::optional<BinaryFrameView> parseBinaryFrame(std::span<const uint8_t> frame);
+
+  static QByteArray makeBatchFrame(const std::vector<QByteArray> &frames);
+
+  // Views of the contained frames, false if the batch is malformed
+  static bool parseBatchFrame(std::span<const uint8_t> batch, std::vector<std::span<const uint8_t> > &frames);
+
+  // Debug encoding of the same frame: { "type": "MessagePkg", "pkg": "<base64>", "IV": "<base64>" }
+  static QJsonObject makeJsonFrame(std::span<const uint8_t> iv, std::span<const uint8_t> sealed);
+
   QJsonObject makePkg(const QString& pkgType, const QJsonObject& data);
   QJsonObject makeMessagePkg(const QString& content,
                       const QString& timestamp, const QString& senderID,
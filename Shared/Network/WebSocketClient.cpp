@@ -1,108 +1,602 @@
 #include "WebSocketClient.h"
+#include "NetLog.h"
+#include <openssl/crypto.h>
+#include <openssl/rand.h>
+#include <QMetaObject>
+#include <QRandomGenerator>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include "../Crypto/KDF/KDFEnv.h"
+#include "../ThreadPool/ThreadPool.h"
 
 namespace Network {
-  WebSocketClient::WebSocketClient(const QUrl &url, QObject *parent) : QObject(parent), serverUrl(url),
-                                                                       handshakeDone(false) {
-    connect(&socket, &QWebSocket::connected, this, &WebSocketClient::onConnected);
+  struct WebSocketClient::SealedBatch {
+    std::vector<OutboundMessage> messages;
+    // Own copy, a re-handshake cleanses sharedSecret while the pool may still be sealing
+    std::vector<uint8_t> key;
+    bool binary = false;
+    bool batch = false;
 
-    connect(&socket, &QWebSocket::textMessageReceived, this, [=](const QString &message) {
-      QJsonDocument doc = QJsonDocument::fromJson(message.toUtf8());
-      if (!doc.isObject()) return;
-      QJsonObject obj = doc.object();
-      if (obj["type"].toString() == "HandshakeAck") {
-        std::string serverKeyStr = obj["serverPubKey"].toString().toStdString();
-        std::cout << "Received HandshakeAck with server public key: " << serverKeyStr << std::endl;
-        QByteArray serverKeyBytes = QByteArray::fromBase64(QString::fromStdString(serverKeyStr).toUtf8());
-        std::vector<uint8_t> serverKeyVec(serverKeyBytes.begin(), serverKeyBytes.end());
+    // Filled by sealBatch, one frame per message
+    std::vector<QByteArray> frames;
+    std::vector<bool> sealed;
+    QByteArray batchFrame;
+    std::vector<QString> textFrames;
 
-        Converter::HexConverter::printBytesAsHex("serverKeyVec Hex", serverKeyVec);
+    ~SealedBatch() { OPENSSL_cleanse(key.data(), key.size()); }
+  };
 
-        auto tmpSharedSecret = keyPairEnv->deriveSharedSecret(serverKeyVec);
-        hashingEnv->plainData = tmpSharedSecret;
-        hashingEnv->startHashing();
+  WebSocketClient::WebSocketClient(const QUrl &url, OutboxStore *outbox, CryptoEngines *sharedEngines,
+                                   QObject *parent)
+    : QObject(parent), engines(sharedEngines), serverUrl(url), handshakeDone(false), outboxStore(outbox) {
+    if (!engines) {
+      ownEngines = std::make_unique<CryptoEngines>();
+      engines = ownEngines.get();
+    }
 
-        sharedSecret = hashingEnv->hashValue;
+    // Messages a previous run could not send go out before anything new
+    outboxBacklog = outboxStore != nullptr;
 
-        std::cout << "Handshake acknowledged. Shared secret derived." << std::endl;
-        Converter::HexConverter::printBytesAsHex("SharedSecret", sharedSecret);
+    reconnectTimer.setSingleShot(true);
+    connect(&reconnectTimer, &QTimer::timeout, this, [this]() { socket.open(serverUrl); });
 
-        handshakeDone = true;
-        testPacket();
-      } else {
-        std::cout << "Received unknown message type: " << obj["type"].toString().toStdString() << std::endl;
-      }
+    connect(&socket, &QWebSocket::connected, this, &WebSocketClient::onConnected);
+    connect(&socket, &QWebSocket::stateChanged, this, [this](QAbstractSocket::SocketState state) {
+      // Also reached when opening failed, not only when an open connection dropped
+      if (state == QAbstractSocket::UnconnectedState) onDisconnected();
     });
+    connect(&socket, &QWebSocket::textMessageReceived, this, &WebSocketClient::onTextMessage);
+    connect(&socket, &QWebSocket::binaryMessageReceived, this, &WebSocketClient::onBinaryMessage);
+    connect(&socket, &QWebSocket::bytesWritten, this, &WebSocketClient::onBytesWritten);
 
     socket.open(serverUrl);
+  }
 
-    encEnv = std::make_unique<Crypto::EncryptionEnv>(Crypto::EncAlgorithm::AES256);
-    keyPairEnv = std::make_unique<Crypto::KeyEnv>(Crypto::KeyType::X25519Keypair);
-    keyPairEnv->startKeyPairGeneration();
-    ivEnv = std::make_unique<Crypto::KeyEnv>(Crypto::KeyType::KeyIv);
-    hashingEnv = std::make_unique<Crypto::HashingEnv>(Crypto::HashAlgorithm::BLAKE2s256);
+  WebSocketClient::~WebSocketClient() {
+    // The socket is destroyed after the members its signals would touch
+    socket.disconnect(this);
+    reconnectTimer.stop();
+    // The sealing task uses the sealer and posts back to this object
+    if (sealing.valid()) sealing.wait();
+    // The queued flush is dropped with this object, whatever it would have written goes out now
+    if (outboxStore) flushOutbox();
+    dropResumeToken();
+    OPENSSL_cleanse(sharedSecret.data(), sharedSecret.size());
   }
 
   void WebSocketClient::onConnected() {
-    std::cout << "Connected to server: " << serverUrl.toString().toStdString() << std::endl;
-    sendHandshakeData();
+    NET_LOG(Info, "WebSocketClient", "Connected to server: ", serverUrl.toString().toStdString());
+    ++connectionEpoch;
+
+    if (!resumeToken.isEmpty() && std::chrono::steady_clock::now() < resumeExpiry) {
+      sendResume();
+    } else {
+      dropResumeToken();
+      sendHandshakeData();
+    }
+  }
+
+  void WebSocketClient::onDisconnected() {
+    if (reconnectTimer.isActive()) return;
+
+    if (handshakeDone) {
+      NET_LOG(Warn, "WebSocketClient", "Connection to ", serverUrl.toString().toStdString(), " lost");
+    }
+    handshakeDone = false;
+    resuming = false;
+    requeueUnsent();
+    backpressured = false;
+    bytesWrittenTotal = 0;
+
+    scheduleReconnect();
+  }
+
+  void WebSocketClient::scheduleReconnect() {
+    // Half of the exponential delay is fixed and half random, so clients that lost the connection
+    // at the same time do not all come back at the same time
+    const int exponent = std::min(reconnectAttempt, 16);
+    const int delayCap = static_cast<int>(std::min<int64_t>(static_cast<int64_t>(reconnectBaseDelayMs) << exponent,
+                                                            reconnectMaxDelayMs));
+    const int delayMs = delayCap / 2 + static_cast<int>(QRandomGenerator::global()->bounded(delayCap / 2 + 1));
+    ++reconnectAttempt;
+
+    NET_LOG(Info, "WebSocketClient", "Reconnecting in ", delayMs, " ms (attempt ", reconnectAttempt, ")");
+    reconnectTimer.start(delayMs);
   }
 
   void WebSocketClient::sendHandshakeData() {
+    // Fresh key pair for every full handshake
+    keyPairEnv = std::make_unique<Crypto::KeyEnv>(Crypto::KeyType::X25519Keypair);
+    keyPairEnv->startKeyPairGeneration();
+
     auto base64ClientPubKey = keyPairEnv->getPublicBase64();
-    std::cout << "Client Key: " << base64ClientPubKey << std::endl;
 
     QJsonObject handshakePkg;
     handshakePkg["type"] = "Handshake";
     handshakePkg["pkg"] = QString::fromStdString(base64ClientPubKey);
+    handshakePkg["aead"] = Crypto::AeadRegistry::algorithmName(Crypto::AeadRegistry::getInstance().preferred());
+    handshakePkg["resume"] = true;
+    handshakePkg["acks"] = true;
+    if (!userId.isEmpty()) handshakePkg["userID"] = userId;
+    if (!jsonFramesForced()) {
+      handshakePkg["frames"] = "binary";
+      handshakePkg["batch"] = true;
+    }
 
     socket.sendTextMessage(Packages::convertPkgToJsonStr(handshakePkg));
   }
 
-  void WebSocketClient::testPacket() {
+  void WebSocketClient::sendResume() {
+    resumeNonce.resize(resumeNonceSize);
+    if (RAND_bytes(resumeNonce.data(), static_cast<int>(resumeNonce.size())) != 1) {
+      dropResumeToken();
+      sendHandshakeData();
+      return;
+    }
+
+    QJsonObject resumePkg;
+    resumePkg["type"] = "Resume";
+    resumePkg["token"] = resumeToken;
+    resumePkg["nonce"] = QString::fromLatin1(
+      QByteArray(reinterpret_cast<const char *>(resumeNonce.data()), resumeNonce.size()).toBase64());
+    resumePkg["aead"] = Crypto::AeadRegistry::algorithmName(aead);
+    resumePkg["acks"] = true;
+    if (!jsonFramesForced()) {
+      resumePkg["frames"] = "binary";
+      resumePkg["batch"] = true;
+    }
+
+    resuming = true;
+    socket.sendTextMessage(Packages::convertPkgToJsonStr(resumePkg));
+
+    // Servers without session resumption never answer, they get the full handshake instead
+    const uint64_t epoch = connectionEpoch;
+    QTimer::singleShot(resumeTimeoutMs, this, [this, epoch]() {
+      if (epoch != connectionEpoch || !resuming) return;
+      NET_LOG(Warn, "WebSocketClient", "Session resume timed out, doing a full handshake");
+      resuming = false;
+      dropResumeToken();
+      sendHandshakeData();
+    });
+  }
+
+  void WebSocketClient::onTextMessage(const QString &message) {
+    QJsonDocument doc = QJsonDocument::fromJson(message.toUtf8());
+    if (!doc.isObject()) return;
+    QJsonObject obj = doc.object();
+    const QString type = obj["type"].toString();
+
+    if (type == "HandshakeAck") {
+      onHandshakeAck(obj);
+    } else if (type == "ResumeAck" && resuming) {
+      onResumeAck(obj);
+    } else if (type == "MessageAck" && handshakeDone && relayAcks) {
+      onMessageAck(obj);
+    } else if (type == "MessagePkg" && handshakeDone) {
+      const QByteArray iv = QByteArray::fromBase64(obj["IV"].toString().toUtf8());
+      const QByteArray sealed = QByteArray::fromBase64(obj["pkg"].toString().toUtf8());
+      openMessage(std::span<const uint8_t>(reinterpret_cast<const uint8_t *>(iv.constData()), iv.size()),
+                  std::span<const uint8_t>(reinterpret_cast<const uint8_t *>(sealed.constData()), sealed.size()));
+    } else if (type == "ResumeReject" && resuming) {
+      NET_LOG(Info, "WebSocketClient", "Server rejected session resume, doing a full handshake");
+      resuming = false;
+      dropResumeToken();
+      sendHandshakeData();
+    } else {
+      NET_LOG(Warn, "WebSocketClient", "Received unknown message type: ", type.toStdString());
+    }
+  }
+
+  void WebSocketClient::onHandshakeAck(const QJsonObject &ack) {
+    QByteArray serverKeyBytes = QByteArray::fromBase64(ack["serverPubKey"].toString().toUtf8());
+    std::vector<uint8_t> serverKeyVec(serverKeyBytes.begin(), serverKeyBytes.end());
+
+    if (!keyPairEnv) return;
+    auto tmpSharedSecret = keyPairEnv->deriveSharedSecret(serverKeyVec);
+    keyPairEnv.reset();
+
+    // The hashing engine is shared, no secret stays behind in it
+    Crypto::HashingEnv &hashingEnv = engines->hashing();
+    hashingEnv.plainData = std::move(tmpSharedSecret);
+    hashingEnv.startHashing();
+    OPENSSL_cleanse(sharedSecret.data(), sharedSecret.size());
+    sharedSecret = hashingEnv.hashValue;
+    OPENSSL_cleanse(hashingEnv.plainData.data(), hashingEnv.plainData.size());
+    OPENSSL_cleanse(hashingEnv.hashValue.data(), hashingEnv.hashValue.size());
+    hashingEnv.plainData.clear();
+    hashingEnv.hashValue.clear();
+
+    // Servers that predate the aead field only speak AES-256-GCM
+    auto serverAead = Crypto::AeadRegistry::parseAlgorithm(ack["aead"].toString().toStdString());
+    auto agreedAead = Crypto::AeadRegistry::negotiate(Crypto::AeadRegistry::getInstance().preferred(),
+                                                      serverAead.value_or(Crypto::EncAlgorithm::AES256));
+    aead = agreedAead;
+    NET_LOG(Debug, "WebSocketClient", "Using ", Crypto::AeadRegistry::algorithmName(agreedAead), " for this connection");
+
+    NET_LOG(Info, "WebSocketClient", "Handshake acknowledged");
+
+    dropResumeToken();
+    resumeSecret = sharedSecret;
+    storeResumeToken(ack);
+
+    completeHandshake(ack);
+  }
+
+  void WebSocketClient::onResumeAck(const QJsonObject &ack) {
+    QByteArray serverNonce = QByteArray::fromBase64(ack["nonce"].toString().toUtf8());
+
+    // Both nonces go into the salt, so no two connections share a key and with it an IV space
+    std::vector<uint8_t> salt(resumeNonce);
+    salt.insert(salt.end(), serverNonce.begin(), serverNonce.end());
+    std::vector<uint8_t> connectionKey(resumeSecret.size());
+    Crypto::KDFEnv kdf(Crypto::KDFType::SHA3_256);
+
+    if (serverNonce.size() != resumeNonceSize || resumeSecret.empty() ||
+        !kdf.startKDF(resumeSecret, salt, "VentraSessionResume", connectionKey)) {
+      NET_LOG(Warn, "WebSocketClient", "Invalid ResumeAck, doing a full handshake");
+      resuming = false;
+      dropResumeToken();
+      sendHandshakeData();
+      return;
+    }
+
+    OPENSSL_cleanse(sharedSecret.data(), sharedSecret.size());
+    sharedSecret = std::move(connectionKey);
+    // The server may rotate the token on every resume
+    storeResumeToken(ack);
+
+    NET_LOG(Info, "WebSocketClient", "Session resumed without handshake");
+    completeHandshake(ack);
+  }
+
+  void WebSocketClient::completeHandshake(const QJsonObject &ack) {
+    binaryFrames = ack["frames"].toString() == "binary" && !jsonFramesForced();
+    batchFrames = binaryFrames && ack["batch"].toBool();
+    relayAcks = ack["acks"].toBool();
+    ackedMessages = 0;
+    NET_LOG(Debug, "WebSocketClient", "Using ", binaryFrames ? "binary" : "JSON", " message frames",
+            batchFrames ? " with batching" : "");
+
+    handshakeDone = true;
+    resuming = false;
+    reconnectAttempt = 0;
+    pumpOutbound();
+  }
+
+  void WebSocketClient::storeResumeToken(const QJsonObject &ack) {
+    const QString token = ack["resumeToken"].toString();
+    const int ttlSeconds = ack["resumeTtl"].toInt();
+    if (token.isEmpty() || ttlSeconds <= 0) return;
+
+    resumeToken = token;
+    resumeExpiry = std::chrono::steady_clock::now() + std::chrono::seconds(ttlSeconds);
+  }
+
+  void WebSocketClient::dropResumeToken() {
+    resumeToken.clear();
+    OPENSSL_cleanse(resumeSecret.data(), resumeSecret.size());
+    resumeSecret.clear();
+  }
+
+  bool WebSocketClient::sendMessage(const QJsonObject &message) {
+    QByteArray plaintext = QJsonDocument(message).toJson(QJsonDocument::Compact);
+
+    // Queued once it is stored, together with the other messages of this event loop pass
+    if (outboxStore) {
+      pendingAppends.push_back(std::move(plaintext));
+      queueOutboxFlush();
+      return true;
+    }
+
+    if (!outbound.push(std::move(plaintext))) {
+      NET_LOG(Warn, "WebSocketClient", "Outbound queue full, message rejected");
+      return false;
+    }
+
+    pumpOutbound();
+    return true;
+  }
+
+  OutboundStats WebSocketClient::outboundStats() const {
+    OutboundStats stats = outbound.stats();
+    stats.backpressured = backpressured;
+    return stats;
+  }
+
+  void WebSocketClient::pumpOutbound() {
+    if (!handshakeDone || inFlightBatch || backpressured) return;
+    if (outbound.empty() && outboxBacklog) refillFromOutbox();
+    if (outbound.empty()) return;
+
+    auto batch = std::make_shared<SealedBatch>();
+    batch->messages = outbound.takeBatch(maxBatchMessages, maxBatchBytes);
+    batch->key = sharedSecret;
+    batch->binary = binaryFrames;
+    batch->batch = batchFrames;
+    inFlightBatch = batch;
+
+    // Looked up here, the engine maps are only touched on this thread
+    Crypto::BatchAead *batchSealer = &engines->sealer(aead);
+    if (!ownEngines) {
+      // Queued, so the other clients of this thread get their turn between batches
+      sealBatch(*batchSealer, *batch);
+      QMetaObject::invokeMethod(this, [this, batch]() { onBatchSealed(batch); }, Qt::QueuedConnection);
+      return;
+    }
+
+    try {
+      sealing = Utils::ThreadPool::getInstance().addTask([this, batchSealer, batch]() {
+        sealBatch(*batchSealer, *batch);
+        QMetaObject::invokeMethod(this, [this, batch]() { onBatchSealed(batch); }, Qt::QueuedConnection);
+      });
+    } catch (const std::exception &e) {
+      NET_LOG(Warn, "WebSocketClient", "ThreadPool rejected outbound batch, sealing it inline: ", e.what());
+      sealBatch(*batchSealer, *batch);
+      onBatchSealed(batch);
+    }
+  }
+
+  void WebSocketClient::refillFromOutbox() {
+    std::vector<OutboxEntry> entries;
+    if (!outboxStore->loadPending(lastOutboxId, outboxPageSize, entries)) {
+      NET_LOG(Error, "WebSocketClient", "Could not load messages from the outbox");
+      return;
+    }
+
+    for (auto &entry: entries) {
+      if (!outbound.fits(entry.plaintext.size())) return;
+      outbound.push(std::move(entry.plaintext), entry.id);
+      lastOutboxId = entry.id;
+    }
+    if (entries.size() < outboxPageSize) outboxBacklog = false;
+  }
+
+  void WebSocketClient::queueOutboxFlush() {
+    if (outboxFlushQueued) return;
+    outboxFlushQueued = true;
+    QMetaObject::invokeMethod(this, [this]() {
+      flushOutbox();
+      pumpOutbound();
+    }, Qt::QueuedConnection);
+  }
+
+  void WebSocketClient::flushOutbox() {
+    outboxFlushQueued = false;
+    if (pendingAppends.empty() && pendingRemovals.empty()) return;
+
+    std::vector<QByteArray> appends = std::move(pendingAppends);
+    std::vector<int64_t> removals = std::move(pendingRemovals);
+    pendingAppends.clear();
+    pendingRemovals.clear();
+
+    std::vector<int64_t> ids;
+    if (!outboxStore->commit(appends, ids, removals)) {
+      if (!appends.empty()) {
+        NET_LOG(Error, "WebSocketClient", "Could not store ", appends.size(), " outbound messages in the outbox, messages rejected");
+      }
+      if (!removals.empty()) {
+        NET_LOG(Error, "WebSocketClient", "Could not remove sent messages from the outbox, they are sent again after a restart");
+      }
+      return;
+    }
+
+    for (size_t i = 0; i < appends.size(); ++i) {
+      // Older messages still wait in the outbox, these are loaded after them
+      if (outboxBacklog) break;
+      if (!outbound.fits(appends[i].size())) {
+        outboxBacklog = true;
+        break;
+      }
+      outbound.push(std::move(appends[i]), ids[i]);
+      lastOutboxId = ids[i];
+    }
+  }
+
+  void WebSocketClient::sealBatch(Crypto::BatchAead &sealer, SealedBatch &batch) {
+    const size_t count = batch.messages.size();
+    batch.frames.resize(count);
+    batch.sealed.assign(count, false);
+
+    // Every message gets its own frame with a fresh IV, sealed in place behind the frame header
+    std::vector<Crypto::AeadJob> jobs(count);
+    for (size_t i = 0; i < count; ++i) {
+      const QByteArray &plaintext = batch.messages[i].plaintext;
+      const size_t plainSize = plaintext.size();
+
+      uint8_t iv[Crypto::CipherContext::ivSize];
+      if (RAND_bytes(iv, sizeof(iv)) != 1) continue;
+
+      batch.frames[i] = Packages::makeBinaryFrame(FrameType::MessagePkg, iv,
+                                                  Crypto::EncryptionEnv::sealedSize(plainSize));
+      std::span<uint8_t> sealed = Packages::binaryFrameSealed(batch.frames[i]);
+      std::memcpy(sealed.data(), plaintext.constData(), plainSize);
+
+      jobs[i].key = batch.key;
+      jobs[i].nonce = std::span<const uint8_t>(
+        reinterpret_cast<const uint8_t *>(batch.frames[i].constData()) + Packages::frameHeaderSize, sizeof(iv));
+      jobs[i].in = sealed.first(plainSize);
+      jobs[i].out = sealed;
+    }
+
+    // Jobs without a frame have no key and fail the size check, they are dropped below
+    sealer.sealAll(jobs, 1);
+
+    std::vector<QByteArray> sealedFrames;
+    for (size_t i = 0; i < count; ++i) {
+      batch.sealed[i] = jobs[i].ok;
+      if (jobs[i].ok) sealedFrames.push_back(batch.frames[i]);
+    }
+
+    if (batch.binary && batch.batch && sealedFrames.size() > 1) {
+      batch.batchFrame = Packages::makeBatchFrame(sealedFrames);
+      batch.frames.clear();
+    } else if (batch.binary) {
+      batch.frames = std::move(sealedFrames);
+    } else {
+      for (auto &frame: sealedFrames) {
+        auto view = Packages::parseBinaryFrame(
+          std::span<const uint8_t>(reinterpret_cast<const uint8_t *>(frame.constData()), frame.size()));
+        batch.textFrames.push_back(Packages::convertPkgToJsonStr(Packages::makeJsonFrame(view->iv, view->sealed)));
+      }
+      batch.frames.clear();
+    }
+  }
+
+  void WebSocketClient::onBatchSealed(const std::shared_ptr<SealedBatch> &batch) {
+    // The connection dropped while sealing, requeueUnsent already put the messages back
+    if (batch != inFlightBatch) return;
+    inFlightBatch.reset();
+
+    size_t frames = 0;
+    if (!batch->batchFrame.isEmpty()) {
+      socket.sendBinaryMessage(batch->batchFrame);
+      frames = 1;
+    }
+    for (const auto &frame: batch->frames) {
+      socket.sendBinaryMessage(frame);
+      ++frames;
+    }
+    for (const auto &text: batch->textFrames) {
+      socket.sendTextMessage(text);
+      ++frames;
+    }
+    outbound.addSentFrames(frames);
+
+    std::vector<OutboundMessage> sent;
+    std::vector<int64_t> droppedIds;
+    for (size_t i = 0; i < batch->messages.size(); ++i) {
+      if (batch->sealed[i]) {
+        sent.push_back(std::move(batch->messages[i]));
+        continue;
+      }
+      NET_LOG(Error, "WebSocketClient", "Failed to encrypt outbound message, dropping it");
+      if (batch->messages[i].outboxId != OutboundQueue::noOutboxId) droppedIds.push_back(batch->messages[i].outboxId);
+      outbound.finish(batch->messages[i], false);
+    }
+    if (outboxStore && !droppedIds.empty()) {
+      pendingRemovals.insert(pendingRemovals.end(), droppedIds.begin(), droppedIds.end());
+      queueOutboxFlush();
+    }
+
+    // Counts as sent once the socket wrote everything queued up to here
+    if (!sent.empty()) {
+      unconfirmed.push_back({std::move(sent), bytesWrittenTotal + static_cast<uint64_t>(socket.bytesToWrite())});
+      confirmWritten();
+    }
+
+    if (socket.bytesToWrite() > highWatermark) {
+      backpressured = true;
+    }
+    pumpOutbound();
+  }
+
+  void WebSocketClient::onBytesWritten(qint64 bytes) {
+    bytesWrittenTotal += static_cast<uint64_t>(bytes);
+    confirmWritten();
+
+    if (backpressured && socket.bytesToWrite() <= lowWatermark) {
+      backpressured = false;
+      pumpOutbound();
+    }
+  }
+
+  void WebSocketClient::confirmWritten() {
+    // Written is not received, with acks only MessageAck finishes messages
+    if (relayAcks) return;
+
+    const size_t removalsBefore = pendingRemovals.size();
+    while (!unconfirmed.empty() && unconfirmed.front().writtenEnd <= bytesWrittenTotal) {
+      for (const auto &message: unconfirmed.front().messages) {
+        outbound.finish(message, true);
+        if (message.outboxId != OutboundQueue::noOutboxId) pendingRemovals.push_back(message.outboxId);
+      }
+      unconfirmed.pop_front();
+    }
+
+    if (outboxStore && pendingRemovals.size() > removalsBefore) queueOutboxFlush();
+  }
+
+  void WebSocketClient::onMessageAck(const QJsonObject &ack) {
+    const uint64_t received = static_cast<uint64_t>(ack["received"].toInteger());
+    const size_t removalsBefore = pendingRemovals.size();
+
+    // Frames arrive in the order they were sent, so the count maps onto the oldest unconfirmed ones
+    while (!unconfirmed.empty() && ackedMessages < received) {
+      auto &messages = unconfirmed.front().messages;
+      const size_t count = static_cast<size_t>(std::min<uint64_t>(messages.size(), received - ackedMessages));
+      for (size_t i = 0; i < count; ++i) {
+        outbound.finish(messages[i], true);
+        if (messages[i].outboxId != OutboundQueue::noOutboxId) pendingRemovals.push_back(messages[i].outboxId);
+      }
+      messages.erase(messages.begin(), messages.begin() + static_cast<std::ptrdiff_t>(count));
+      ackedMessages += count;
+      if (messages.empty()) unconfirmed.pop_front();
+    }
+
+    if (outboxStore && pendingRemovals.size() > removalsBefore) queueOutboxFlush();
+  }
+
+  void WebSocketClient::requeueUnsent() {
+    // The batch on the ThreadPool is newer than every unconfirmed one and older than the queue
+    if (sealing.valid()) sealing.wait();
+    if (inFlightBatch) {
+      outbound.requeue(std::move(inFlightBatch->messages));
+      inFlightBatch.reset();
+    }
+    while (!unconfirmed.empty()) {
+      outbound.requeue(std::move(unconfirmed.back().messages));
+      unconfirmed.pop_back();
+    }
+  }
+
+  void WebSocketClient::onBinaryMessage(const QByteArray &frame) {
     if (!handshakeDone) return;
-    Packages pack;
-    for (int i = 0; i < 1; ++i) {
-      std::cout << "Sending test packet " << i + 1 << std::endl;
-      QJsonObject messageData = pack.testMessage();
-
-      // Serialize messageData to JSON string (this is the plaintext)
-      QString messageJson = Packages::convertPkgToJsonStr(messageData);
-      std::string messageStr = messageJson.toStdString();
-      std::vector<uint8_t> messageVec(messageStr.begin(), messageStr.end());
-
-      // Generate IV
-      std::vector<uint8_t> key, iv;
-      ivEnv->setKeyIvSizes(1, 12);
-      ivEnv->startKeyIvGeneration(key, iv);
-
-      // Prepare encryption
-      std::vector<uint8_t> authTag(16, 0);
-      encEnv->iv = iv;
-      encEnv->authTag = authTag;
-      encEnv->key = sharedSecret;
-      encEnv->plaintext = messageVec;
-      encEnv->ciphertext.clear();
-
-      encEnv->startEncryption();
-
-      // Add Authtag to ciphertext for gos decryption
-      encEnv->ciphertext.insert(encEnv->ciphertext.end(), encEnv->authTag.begin(), encEnv->authTag.end());
-
-      QByteArray base64Ciphertext = QByteArray::fromStdString(
-        std::string(encEnv->ciphertext.begin(), encEnv->ciphertext.end())
-      ).toBase64();
-      QByteArray base64IV = QByteArray::fromStdString(
-        std::string(iv.begin(), iv.end())
-      ).toBase64();
-
-      // Build package: { "type": "MessagePkg", "pkg": "<base64-ciphertext>", "IV": "<base64-iv>" }
-      QJsonObject pkg;
-      pkg["type"] = "MessagePkg";
-      pkg["pkg"] = QString(base64Ciphertext);
-      pkg["IV"] = QString(base64IV);
-
-      socket.sendTextMessage(Packages::convertPkgToJsonStr(pkg));
-      sleep(1);
+
+    std::span<const uint8_t> bytes(reinterpret_cast<const uint8_t *>(frame.constData()), frame.size());
+    if (!bytes.empty() && bytes[0] == static_cast<uint8_t>(FrameType::MessageBatch)) {
+      std::vector<std::span<const uint8_t> > frames;
+      if (!Packages::parseBatchFrame(bytes, frames)) {
+        NET_LOG(Warn, "WebSocketClient", "Dropping malformed batch frame of ", frame.size(), " bytes");
+        return;
+      }
+      for (auto inner: frames) handleMessageFrame(inner);
+      return;
+    }
+    handleMessageFrame(bytes);
+  }
+
+  void WebSocketClient::handleMessageFrame(std::span<const uint8_t> frame) {
+    auto view = Packages::parseBinaryFrame(frame);
+    if (!view) {
+      NET_LOG(Warn, "WebSocketClient", "Dropping malformed binary frame of ", frame.size(), " bytes");
+      return;
     }
+    openMessage(view->iv, view->sealed);
+  }
+
+  void WebSocketClient::openMessage(std::span<const uint8_t> iv, std::span<const uint8_t> sealed) {
+    if (sealed.size() < Crypto::EncryptionEnv::tagSize) {
+      NET_LOG(Warn, "WebSocketClient", "Dropping message of ", sealed.size(), " bytes, shorter than its tag");
+      return;
+    }
+
+    QByteArray plaintext(static_cast<qsizetype>(sealed.size() - Crypto::EncryptionEnv::tagSize), Qt::Uninitialized);
+    std::span<uint8_t> out(reinterpret_cast<uint8_t *>(plaintext.data()), plaintext.size());
+    if (!engines->cipher(aead).openAppendedTag(sharedSecret, iv, sealed, out)) {
+      NET_LOG(Warn, "WebSocketClient", "Failed to decrypt message");
+      return;
+    }
+
+    if (messageHandler) {
+      messageHandler(plaintext);
+    } else {
+      NET_LOG(Debug, "WebSocketClient", "Received message: ", plaintext.toStdString());
+    }
+  }
+
+  bool WebSocketClient::jsonFramesForced() {
+    const char *value = std::getenv("VENTRA_JSON_FRAMES");
+    return value && std::string(value) == "1";
   }
 }
@@ -7,35 +7,192 @@
 
 #include <QWebSocket>
 #include <QObject>
+#include <QTimer>
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <future>
 #include <memory>
-#include "../Crypto/Encryption/EncryptionEnv.h"
-#include "../Crypto/Hash/HashingEnv.h"
+#include "../Crypto/Encryption/AeadRegistry.h"
 #include "../Crypto/KeyEnv/KeyEnv.h"
-#include "../Converter/HexConverter.h"
 #include <iostream>
 #include "Packages.h"
+#include "OutboundQueue.h"
+#include "OutboxStore.h"
+#include "CryptoEngines.h"
 
 namespace Network {
+  // Outgoing messages go through an OutboundQueue. Batches of up to maxBatchMessages are sealed one
+  // batch at a time and sent as one batch frame if the server supports it. A client with its own
+  // CryptoEngines seals on the ThreadPool, clients that share the engines of their thread (see
+  // ConnectionManager) seal on that thread, which is already one of a pool sized to the cores.
+  // Sending pauses while more than highWatermark bytes wait in the socket and resumes below
+  // lowWatermark, the queue limits bound memory in the meantime.
+  //
+  // A lost connection is reopened with jittered exponential backoff. If the server handed out a
+  // resume token, the reconnect skips the X25519 handshake and derives a fresh key from the old
+  // secret instead. Messages stay in the optional OutboxStore until the relay acknowledged them
+  // with a MessageAck, or, for relays without acks, until the socket wrote them. Messages not
+  // confirmed when the connection dropped are sent again in their order. Outbox writes
+  // of one event loop pass are collected and committed in one transaction at its end, so a burst
+  // of messages or written frames costs one database write instead of one per message.
   class WebSocketClient : public QObject {
   public:
-    WebSocketClient(const QUrl &url, QObject *parent = nullptr);
+    static constexpr qint64 highWatermark = 1024 * 1024;
+    static constexpr qint64 lowWatermark = 256 * 1024;
+    static constexpr size_t maxBatchMessages = 64;
+    static constexpr size_t maxBatchBytes = 256 * 1024;
+    static constexpr size_t outboxPageSize = 1024;
+    static constexpr int reconnectBaseDelayMs = 500;
+    static constexpr int reconnectMaxDelayMs = 30000;
+    static constexpr int resumeTimeoutMs = 5000;
+    static constexpr qsizetype resumeNonceSize = 32;
 
-    void testPacket();
+    // outbox has to outlive the client, nullptr keeps unsent messages in memory only. sharedEngines
+    // belong to the client's thread and have to outlive its clients, nullptr gives the client its own.
+    WebSocketClient(const QUrl &url, OutboxStore *outbox = nullptr, CryptoEngines *sharedEngines = nullptr,
+                    QObject *parent = nullptr);
+
+    ~WebSocketClient() override;
+
+    // Call from the client's thread, never blocks on the network. False if the message could not
+    // be queued. With an outbox the message is stored at the end of the event loop pass, if that
+    // fails it is rejected there and only logged.
+    bool sendMessage(const QJsonObject &message);
+
+    OutboundStats outboundStats() const;
+
+    // Handshake or resume completed, messages are being sent
+    bool isConnected() const { return handshakeDone; }
+
+    // Announced as userID in the handshake, the relay routes messages by their receiverID to it.
+    // Set it before control returns to the event loop, the handshake starts once connected.
+    void setUserId(const QString &id) { userId = id; }
+
+    using MessageHandler = std::function<void(const QByteArray &plaintext)>;
+
+    // Decrypted incoming messages go here instead of being printed
+    void setMessageHandler(MessageHandler handler) { messageHandler = std::move(handler); }
 
   private:
+    struct SealedBatch;
+
+    // Sent batch the relay has not confirmed yet, its frames may still sit in the socket's write buffer
+    struct UnconfirmedBatch {
+      std::vector<OutboundMessage> messages;
+      // bytesWrittenTotal at which the last frame of the batch left the socket
+      uint64_t writtenEnd;
+    };
+
+    void onConnected();
+
+    void onDisconnected();
+
+    void scheduleReconnect();
+
     void sendHandshakeData();
 
+    void sendResume();
+
+    void onTextMessage(const QString &message);
+
+    void onHandshakeAck(const QJsonObject &ack);
+
+    void onResumeAck(const QJsonObject &ack);
+
+    // Applies the frame options of a HandshakeAck or ResumeAck and starts sending
+    void completeHandshake(const QJsonObject &ack);
+
+    void storeResumeToken(const QJsonObject &ack);
+
+    void dropResumeToken();
+
+    void onBinaryMessage(const QByteArray &frame);
+
+    void handleMessageFrame(std::span<const uint8_t> frame);
+
+    void openMessage(std::span<const uint8_t> iv, std::span<const uint8_t> sealed);
+
+    // Starts sealing the next batch unless one is in flight, the socket is backed up or nothing waits
+    void pumpOutbound();
+
+    // Moves the next page of stored messages into the queue, keeps the outbox order intact
+    void refillFromOutbox();
+
+    // Runs flushOutbox once control returns to the event loop, however often it is called until then
+    void queueOutboxFlush();
+
+    // Commits the collected appends and removals and queues the appended messages, does not send
+    void flushOutbox();
+
+    static void sealBatch(Crypto::BatchAead &sealer, SealedBatch &batch);
+
+    void onBatchSealed(const std::shared_ptr<SealedBatch> &batch);
+
+    void onBytesWritten(qint64 bytes);
+
+    // Finishes every unconfirmed batch the socket wrote completely and removes it from the outbox,
+    // only for relays without acks
+    void confirmWritten();
+
+    // The relay counts the message frames it received on this connection, that many of the oldest
+    // unconfirmed messages are finished and removed from the outbox
+    void onMessageAck(const QJsonObject &ack);
+
+    // Puts the batch in flight and every unconfirmed batch back into the queue
+    void requeueUnsent();
+
+    // VENTRA_JSON_FRAMES=1 keeps messages in base64 JSON, readable in a proxy while debugging
+    static bool jsonFramesForced();
+
+    // Only exists between sending the handshake and its ack
     std::unique_ptr<Crypto::KeyEnv> keyPairEnv;
-    std::unique_ptr<Crypto::KeyEnv> ivEnv;
-    std::unique_ptr<Crypto::EncryptionEnv> encEnv;
-    std::unique_ptr<Crypto::HashingEnv> hashingEnv;
+    std::unique_ptr<CryptoEngines> ownEngines;
+    CryptoEngines *engines;
+    Crypto::EncAlgorithm aead = Crypto::EncAlgorithm::AES256;
     std::vector<uint8_t> sharedSecret;
 
-    void onConnected();
-
     QWebSocket socket;
     QUrl serverUrl;
+    QString userId;
+    MessageHandler messageHandler;
     bool handshakeDone;
+    // Set once the server acknowledged binary frames, older servers only read JSON
+    bool binaryFrames = false;
+    bool batchFrames = false;
+    // Set once the relay agreed to send MessageAcks, only they finish messages then
+    bool relayAcks = false;
+    // Messages the relay confirmed on the current connection
+    uint64_t ackedMessages = 0;
+
+    OutboundQueue outbound;
+    std::future<void> sealing;
+    std::shared_ptr<SealedBatch> inFlightBatch;
+    bool backpressured = false;
+    std::deque<UnconfirmedBatch> unconfirmed;
+    // Bytes the socket wrote on the current connection
+    uint64_t bytesWrittenTotal = 0;
+
+    OutboxStore *outboxStore;
+    // Stored messages newer than the queue's content wait in the outbox until the queue drained
+    bool outboxBacklog = false;
+    int64_t lastOutboxId = 0;
+    // Outbox writes of the current event loop pass
+    std::vector<QByteArray> pendingAppends;
+    std::vector<int64_t> pendingRemovals;
+    bool outboxFlushQueued = false;
+
+    QTimer reconnectTimer;
+    int reconnectAttempt = 0;
+
+    // Secret of the last full handshake, every resumed connection derives its key from it
+    std::vector<uint8_t> resumeSecret;
+    QString resumeToken;
+    std::chrono::steady_clock::time_point resumeExpiry;
+    std::vector<uint8_t> resumeNonce;
+    bool resuming = false;
+    // Tells timers of an older connection apart from the current one
+    uint64_t connectionEpoch = 0;
   };
 } // Network
 
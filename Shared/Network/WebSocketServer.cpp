@@ -3,53 +3,352 @@
 //
 
 #include "WebSocketServer.h"
-#include <iostream>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMetaObject>
+#include <openssl/crypto.h>
+#include <openssl/rand.h>
+#include "NetLog.h"
+#include "Packages.h"
+#include "../Crypto/Encryption/AeadRegistry.h"
+#include "../Crypto/Hash/HashingEnv.h"
+#include "../Crypto/KDF/KDFEnv.h"
+#include "../Crypto/KeyEnv/KeyEnv.h"
 
 namespace Network {
+  namespace {
+    std::span<const uint8_t> bytesOf(const QByteArray &data) {
+      return {reinterpret_cast<const uint8_t *>(data.constData()), static_cast<size_t>(data.size())};
+    }
+
+    QString toBase64(std::span<const uint8_t> bytes) {
+      return QString::fromLatin1(
+        QByteArray(reinterpret_cast<const char *>(bytes.data()), static_cast<qsizetype>(bytes.size())).toBase64());
+    }
+  }
+
   WebSocketServer::WebSocketServer(quint16 port, QObject *parent) : QObject(parent),
                                                                     m_server(new QWebSocketServer(
-                                                                      QStringLiteral("Test Server"),
+                                                                      QStringLiteral("Ventra Relay"),
                                                                       QWebSocketServer::NonSecureMode, this)) {
-    if (m_server->listen(QHostAddress::Any, port)) {
-      std::cout << "WebSocket Server started on port" << port << std::endl;
+    if (m_server->listen(QHostAddress::LocalHost, port)) {
+      NET_LOG(Info, "WebSocketServer", "WebSocket relay started on port ", m_server->serverPort());
       connect(m_server, &QWebSocketServer::newConnection,
               this, &WebSocketServer::onNewConnection);
     } else {
-      std::cout << "WebSocket Server could not start!" << std::endl;
+      NET_LOG(Error, "WebSocketServer", "WebSocket relay could not start: ", m_server->errorString().toStdString());
     }
   }
 
   WebSocketServer::~WebSocketServer() {
     m_server->close();
+    for (QWebSocket *client: m_clients) client->disconnect(this);
     qDeleteAll(m_clients);
+    for (auto &entry: resumeEntries) OPENSSL_cleanse(entry.secret.data(), entry.secret.size());
   }
 
-  void WebSocketServer::onNewConnection() {
-    QWebSocket *client = m_server->nextPendingConnection();
+  bool WebSocketServer::isListening() const {
+    return m_server->isListening();
+  }
+
+  quint16 WebSocketServer::port() const {
+    return m_server->serverPort();
+  }
 
-    connect(client, &QWebSocket::textMessageReceived, this, &WebSocketServer::processTextMessage);
-    connect(client, &QWebSocket::disconnected, this, &WebSocketServer::socketDisconnected);
+  void WebSocketServer::onNewConnection() {
+    while (QWebSocket *client = m_server->nextPendingConnection()) {
+      connect(client, &QWebSocket::textMessageReceived, this, &WebSocketServer::processTextMessage);
+      connect(client, &QWebSocket::binaryMessageReceived, this, &WebSocketServer::processBinaryMessage);
+      connect(client, &QWebSocket::disconnected, this, &WebSocketServer::socketDisconnected);
 
-    m_clients << client;
-    std::cout << "New client connected" << std::endl;
+      m_clients << client;
+      sessions[client] = std::make_unique<Session>();
+      ++relayStats.connections;
+    }
   }
 
   void WebSocketServer::processTextMessage(const QString &message) {
     QWebSocket *client = qobject_cast<QWebSocket *>(sender());
-    std::cout << "Message received:" << message.toStdString() << std::endl;
+    auto it = sessions.find(client);
+    if (it == sessions.end()) return;
+    Session &session = *it->second;
 
-    // Echo back
-    if (client) {
-      client->sendTextMessage(QString("Echo: ") + message);
+    QJsonDocument doc = QJsonDocument::fromJson(message.toUtf8());
+    if (!doc.isObject()) {
+      ++relayStats.malformed;
+      return;
+    }
+    QJsonObject pkg = doc.object();
+    const QString type = pkg["type"].toString();
+
+    if (type == "Handshake") {
+      handleHandshake(client, session, pkg);
+    } else if (type == "Resume") {
+      handleResume(client, session, pkg);
+    } else if (type == "MessagePkg" && session.ready) {
+      const QByteArray iv = QByteArray::fromBase64(pkg["IV"].toString().toUtf8());
+      const QByteArray sealed = QByteArray::fromBase64(pkg["pkg"].toString().toUtf8());
+      acknowledge(client, session, 1);
+      openAndRelay(session, client, bytesOf(iv), bytesOf(sealed));
+    } else {
+      ++relayStats.malformed;
+    }
+  }
+
+  void WebSocketServer::processBinaryMessage(const QByteArray &message) {
+    QWebSocket *client = qobject_cast<QWebSocket *>(sender());
+    auto it = sessions.find(client);
+    if (it == sessions.end() || !it->second->ready) return;
+    Session &session = *it->second;
+
+    std::span<const uint8_t> bytes = bytesOf(message);
+    std::vector<std::span<const uint8_t> > frames;
+    if (!bytes.empty() && bytes[0] == static_cast<uint8_t>(FrameType::MessageBatch)) {
+      if (!Packages::parseBatchFrame(bytes, frames)) {
+        ++relayStats.malformed;
+        // The number of messages in it is unknown, acks would no longer match the client's messages.
+        // Closing makes the client send everything unacknowledged again.
+        if (session.acks) client->close();
+        return;
+      }
+    } else {
+      frames.push_back(bytes);
+    }
+
+    acknowledge(client, session, frames.size());
+    for (auto frame: frames) {
+      auto view = Packages::parseBinaryFrame(frame);
+      if (!view) {
+        ++relayStats.malformed;
+        continue;
+      }
+      openAndRelay(session, client, view->iv, view->sealed);
+    }
+  }
+
+  void WebSocketServer::handleHandshake(QWebSocket *client, Session &session, const QJsonObject &pkg) {
+    QByteArray clientKey = QByteArray::fromBase64(pkg["pkg"].toString().toUtf8());
+    std::vector<uint8_t> clientKeyVec(clientKey.begin(), clientKey.end());
+
+    Crypto::KeyEnv keyPair(Crypto::KeyType::X25519Keypair);
+    keyPair.startKeyPairGeneration();
+    std::vector<uint8_t> rawSecret = keyPair.deriveSharedSecret(clientKeyVec);
+    if (rawSecret.empty()) {
+      ++relayStats.malformed;
+      client->close();
+      return;
+    }
+
+    // Same derivation as WebSocketClient, BLAKE2s-256 over the X25519 output
+    Crypto::HashingEnv hashingEnv(Crypto::HashAlgorithm::BLAKE2s256);
+    hashingEnv.plainData = rawSecret;
+    hashingEnv.startHashing();
+    OPENSSL_cleanse(rawSecret.data(), rawSecret.size());
+    OPENSSL_cleanse(hashingEnv.plainData.data(), hashingEnv.plainData.size());
+
+    auto clientAead = Crypto::AeadRegistry::parseAlgorithm(pkg["aead"].toString().toStdString());
+    auto agreedAead = Crypto::AeadRegistry::negotiate(Crypto::AeadRegistry::getInstance().preferred(),
+                                                      clientAead.value_or(Crypto::EncAlgorithm::AES256));
+
+    // A re-handshake on the same connection replaces the secret
+    OPENSSL_cleanse(session.sharedSecret.data(), session.sharedSecret.size());
+    session.sharedSecret = std::move(hashingEnv.hashValue);
+    session.encEnv = std::make_unique<Crypto::EncryptionEnv>(agreedAead);
+    session.binaryFrames = pkg["frames"].toString() == "binary";
+    session.batchFrames = session.binaryFrames && pkg["batch"].toBool();
+    session.acks = pkg["acks"].toBool();
+    session.receivedMessages = 0;
+    session.ready = true;
+    bindUser(client, session, pkg["userID"].toString());
+    ++relayStats.handshakes;
+
+    QJsonObject ack;
+    ack["type"] = "HandshakeAck";
+    ack["serverPubKey"] = QString::fromStdString(keyPair.getPublicBase64());
+    ack["aead"] = Crypto::AeadRegistry::algorithmName(agreedAead);
+    if (session.binaryFrames) ack["frames"] = "binary";
+    if (session.batchFrames) ack["batch"] = true;
+    if (session.acks) ack["acks"] = true;
+    if (pkg["resume"].toBool()) issueResumeToken(session, session.sharedSecret, ack);
+
+    client->sendTextMessage(Packages::convertPkgToJsonStr(ack));
+  }
+
+  void WebSocketServer::handleResume(QWebSocket *client, Session &session, const QJsonObject &pkg) {
+    const QString token = pkg["token"].toString();
+    const QByteArray clientNonce = QByteArray::fromBase64(pkg["nonce"].toString().toUtf8());
+
+    // Tokens are single use, a resumed session gets a new one below
+    auto it = resumeEntries.find(token);
+    if (it == resumeEntries.end() || it->expiry < std::chrono::steady_clock::now() || clientNonce.isEmpty()) {
+      if (it != resumeEntries.end()) eraseResumeEntry(it);
+      QJsonObject reject;
+      reject["type"] = "ResumeReject";
+      client->sendTextMessage(Packages::convertPkgToJsonStr(reject));
+      return;
     }
+    // Moved out, so the only copy of the secret is the one cleansed below
+    ResumeEntry entry = std::move(it.value());
+    resumeEntries.erase(it);
+
+    // A predictable nonce would hand out the same connection key again
+    uint8_t serverNonce[32];
+    std::vector<uint8_t> connectionKey(entry.secret.size());
+    bool derived = RAND_bytes(serverNonce, sizeof(serverNonce)) == 1;
+    if (derived) {
+      // Same derivation as WebSocketClient::onResumeAck
+      std::vector<uint8_t> salt(clientNonce.begin(), clientNonce.end());
+      salt.insert(salt.end(), serverNonce, serverNonce + sizeof(serverNonce));
+      Crypto::KDFEnv kdf(Crypto::KDFType::SHA3_256);
+      derived = kdf.startKDF(entry.secret, salt, "VentraSessionResume", connectionKey);
+    }
+    if (!derived) {
+      OPENSSL_cleanse(entry.secret.data(), entry.secret.size());
+      OPENSSL_cleanse(connectionKey.data(), connectionKey.size());
+      QJsonObject reject;
+      reject["type"] = "ResumeReject";
+      client->sendTextMessage(Packages::convertPkgToJsonStr(reject));
+      return;
+    }
+
+    OPENSSL_cleanse(session.sharedSecret.data(), session.sharedSecret.size());
+    session.sharedSecret = std::move(connectionKey);
+    session.encEnv = std::make_unique<Crypto::EncryptionEnv>(entry.aead);
+    session.binaryFrames = pkg["frames"].toString() == "binary";
+    session.batchFrames = session.binaryFrames && pkg["batch"].toBool();
+    session.acks = pkg["acks"].toBool();
+    session.receivedMessages = 0;
+    session.ready = true;
+    bindUser(client, session, entry.userId);
+    ++relayStats.resumes;
+
+    QJsonObject ack;
+    ack["type"] = "ResumeAck";
+    ack["nonce"] = toBase64(serverNonce);
+    if (session.binaryFrames) ack["frames"] = "binary";
+    if (session.batchFrames) ack["batch"] = true;
+    if (session.acks) ack["acks"] = true;
+    // The next resume derives from the same handshake secret again
+    issueResumeToken(session, entry.secret, ack);
+    OPENSSL_cleanse(entry.secret.data(), entry.secret.size());
+
+    client->sendTextMessage(Packages::convertPkgToJsonStr(ack));
+  }
+
+  void WebSocketServer::issueResumeToken(const Session &session, const std::vector<uint8_t> &secret,
+                                         QJsonObject &ack) {
+    uint8_t tokenBytes[32];
+    if (RAND_bytes(tokenBytes, sizeof(tokenBytes)) != 1) return;
+
+    pruneResumeEntries();
+
+    const QString token = toBase64(tokenBytes);
+    const auto expiry = std::chrono::steady_clock::now() + std::chrono::seconds(resumeTtlSeconds);
+    resumeEntries.insert(token, {secret, session.encEnv->getAlgorithm(), session.userId, expiry});
+    resumeExpiryOrder.emplace_back(expiry, token);
+    ack["resumeToken"] = token;
+    ack["resumeTtl"] = resumeTtlSeconds;
+  }
+
+  void WebSocketServer::pruneResumeEntries() {
+    const auto now = std::chrono::steady_clock::now();
+    while (!resumeExpiryOrder.empty() && resumeExpiryOrder.front().first < now) {
+      // Tokens used in the meantime are already gone from the hash
+      auto it = resumeEntries.find(resumeExpiryOrder.front().second);
+      if (it != resumeEntries.end()) eraseResumeEntry(it);
+      resumeExpiryOrder.pop_front();
+    }
+  }
+
+  void WebSocketServer::eraseResumeEntry(QHash<QString, ResumeEntry>::iterator it) {
+    OPENSSL_cleanse(it->secret.data(), it->secret.size());
+    resumeEntries.erase(it);
+  }
+
+  void WebSocketServer::bindUser(QWebSocket *client, Session &session, const QString &userId) {
+    session.userId = userId;
+    // The newest connection of a user receives its messages
+    if (!userId.isEmpty()) clientsByUser.insert(userId, client);
+  }
+
+  void WebSocketServer::openAndRelay(Session &from, QWebSocket *client, std::span<const uint8_t> iv,
+                                     std::span<const uint8_t> sealed) {
+    if (sealed.size() < Crypto::EncryptionEnv::tagSize) {
+      ++relayStats.malformed;
+      return;
+    }
+
+    QByteArray plaintext(static_cast<qsizetype>(sealed.size() - Crypto::EncryptionEnv::tagSize), Qt::Uninitialized);
+    std::span<uint8_t> out(reinterpret_cast<uint8_t *>(plaintext.data()), plaintext.size());
+    if (!from.encEnv->openAppendedTag(from.sharedSecret, iv, sealed, out)) {
+      ++relayStats.malformed;
+      return;
+    }
+    ++relayStats.messagesIn;
+
+    const QString receiver = QJsonDocument::fromJson(plaintext).object()["receiverID"].toString();
+    QWebSocket *target = client;
+    if (!receiver.isEmpty()) {
+      target = clientsByUser.value(receiver, nullptr);
+    }
+
+    auto it = target ? sessions.find(target) : sessions.end();
+    if (it == sessions.end() || !it->second->ready) {
+      ++relayStats.undeliverable;
+      return;
+    }
+    sendTo(target, *it->second, plaintext);
+  }
+
+  void WebSocketServer::sendTo(QWebSocket *client, Session &session, const QByteArray &plaintext) {
+    uint8_t iv[Crypto::CipherContext::ivSize];
+    if (RAND_bytes(iv, sizeof(iv)) != 1) return;
+
+    QByteArray frame = Packages::makeBinaryFrame(FrameType::MessagePkg, iv,
+                                                 Crypto::EncryptionEnv::sealedSize(plaintext.size()));
+    std::span<uint8_t> sealed = Packages::binaryFrameSealed(frame);
+    if (!session.encEnv->sealAppendedTag(session.sharedSecret, iv, bytesOf(plaintext), sealed)) return;
+
+    if (session.binaryFrames) {
+      client->sendBinaryMessage(frame);
+    } else {
+      client->sendTextMessage(Packages::convertPkgToJsonStr(Packages::makeJsonFrame(iv, sealed)));
+    }
+    ++relayStats.messagesRelayed;
+  }
+
+  void WebSocketServer::acknowledge(QWebSocket *client, Session &session, uint64_t messages) {
+    session.receivedMessages += messages;
+    if (!session.acks || session.ackQueued) return;
+
+    session.ackQueued = true;
+    QMetaObject::invokeMethod(client, [this, client]() {
+      auto it = sessions.find(client);
+      if (it == sessions.end()) return;
+      Session &current = *it->second;
+      current.ackQueued = false;
+
+      QJsonObject ack;
+      ack["type"] = "MessageAck";
+      ack["received"] = static_cast<qint64>(current.receivedMessages);
+      client->sendTextMessage(Packages::convertPkgToJsonStr(ack));
+    }, Qt::QueuedConnection);
   }
 
   void WebSocketServer::socketDisconnected() {
     QWebSocket *client = qobject_cast<QWebSocket *>(sender());
     if (client) {
+      auto it = sessions.find(client);
+      if (it != sessions.end()) {
+        Session &session = *it->second;
+        if (!session.userId.isEmpty() && clientsByUser.value(session.userId) == client) {
+          clientsByUser.remove(session.userId);
+        }
+        OPENSSL_cleanse(session.sharedSecret.data(), session.sharedSecret.size());
+        sessions.erase(it);
+      }
       m_clients.removeAll(client);
       client->deleteLater();
-      std::cout << "Client disconnected" << std::endl;
     }
   }
 } // Network
@@ -8,27 +8,99 @@
 #include <QObject>
 #include <QtWebSockets/QWebSocketServer>
 #include <QtWebSockets/QWebSocket>
+#include <QHash>
+#include <QJsonObject>
 #include <QList>
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <span>
+#include <unordered_map>
+#include <vector>
+#include "../Crypto/Encryption/EncryptionEnv.h"
 
 namespace Network {
+  struct RelayStats {
+    uint64_t connections = 0;
+    uint64_t handshakes = 0;
+    uint64_t resumes = 0;
+    uint64_t messagesIn = 0;
+    uint64_t messagesRelayed = 0;
+    // receiverID not connected, the relay keeps nothing for offline users
+    uint64_t undeliverable = 0;
+    uint64_t malformed = 0;
+  };
 
+  // Local stand-in for the messenger backend, speaks the same protocol as WebSocketClient:
+  // Handshake/HandshakeAck (X25519, AEAD negotiation, binary and batch frames), Resume/ResumeAck
+  // and MessagePkg as binary, batch or JSON frame. Clients that ask for acks get a MessageAck with
+  // the number of message frames received on the connection, at most one per event loop pass.
+  // Every message is decrypted with the sender's
+  // key and sent to the session that announced its receiverID as userID, re-encrypted with that
+  // session's key. Messages without receiverID go back to the sender. Runs on one event loop.
   class WebSocketServer : public QObject {
     Q_OBJECT
 
   public:
+    static constexpr int resumeTtlSeconds = 600;
+
+    // Listens on localhost only, port 0 picks a free port, see port()
     explicit WebSocketServer(quint16 port, QObject *parent = nullptr);
     ~WebSocketServer() override;
 
+    bool isListening() const;
+    quint16 port() const;
+    RelayStats stats() const { return relayStats; }
+
   private slots:
     void onNewConnection();
     void processTextMessage(const QString &message);
+    void processBinaryMessage(const QByteArray &message);
     void socketDisconnected();
 
   private:
+    struct Session {
+      QString userId;
+      std::vector<uint8_t> sharedSecret;
+      std::unique_ptr<Crypto::EncryptionEnv> encEnv;
+      bool binaryFrames = false;
+      bool batchFrames = false;
+      bool ready = false;
+      bool acks = false;
+      // Message frames received on this connection, malformed ones included
+      uint64_t receivedMessages = 0;
+      bool ackQueued = false;
+    };
+
+    struct ResumeEntry {
+      std::vector<uint8_t> secret;
+      Crypto::EncAlgorithm aead;
+      QString userId;
+      std::chrono::steady_clock::time_point expiry;
+    };
+
+    void handleHandshake(QWebSocket *client, Session &session, const QJsonObject &pkg);
+    void handleResume(QWebSocket *client, Session &session, const QJsonObject &pkg);
+    // Adds a fresh resume token for the session's secret to the ack
+    void issueResumeToken(const Session &session, const std::vector<uint8_t> &secret, QJsonObject &ack);
+    // Drops every expired token, tokens nobody came back for would otherwise pile up
+    void pruneResumeEntries();
+    void eraseResumeEntry(QHash<QString, ResumeEntry>::iterator it);
+    void bindUser(QWebSocket *client, Session &session, const QString &userId);
+    void openAndRelay(Session &from, QWebSocket *client, std::span<const uint8_t> iv, std::span<const uint8_t> sealed);
+    void sendTo(QWebSocket *client, Session &session, const QByteArray &plaintext);
+    // Counts received message frames, the MessageAck goes out once control returns to the event loop
+    void acknowledge(QWebSocket *client, Session &session, uint64_t messages);
+
     QWebSocketServer *m_server;
     QList<QWebSocket *> m_clients;
+    std::unordered_map<QWebSocket *, std::unique_ptr<Session> > sessions;
+    QHash<QString, QWebSocket *> clientsByUser;
+    QHash<QString, ResumeEntry> resumeEntries;
+    // Tokens in the order they were issued, which with a fixed ttl is also the order they expire in
+    std::deque<std::pair<std::chrono::steady_clock::time_point, QString> > resumeExpiryOrder;
+    RelayStats relayStats;
   };
-
 } // Network
 
 #endif //WEBSOCKETSERVER_H